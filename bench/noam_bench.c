@@ -0,0 +1,298 @@
+#include <time.h>
+
+#include "noam_parser.h"
+
+#define NOAM_BENCH_RUNS 20
+#define NOAM_BENCH_LARGE_FUNCS 2000
+#define NOAM_BENCH_LINE_LENGTH 256
+
+/* stages of loading a script, timed separately */
+typedef enum {
+    NOAM_BENCH_LEX,
+    NOAM_BENCH_PARSE,
+    NOAM_BENCH_RUN,
+    NOAM_BENCH_STAGES
+} noam_bench_stage;
+
+static const char* noam_bench_stage_names[] = {"lex", "parse", "run"};
+
+/* noam_bench_result struct: measurements of a script
+ *
+ * name: the script file name without the extension
+ * times: nanoseconds of each stage, a value per run
+ * allocs, bytes: allocations of each stage, counted on a separate run since counting slows the stages down
+ * */
+typedef struct {
+    const char* name;
+    double*     times[NOAM_BENCH_STAGES];
+    size_t      allocs[NOAM_BENCH_STAGES];
+    size_t      bytes[NOAM_BENCH_STAGES];
+} noam_bench_result;
+
+double noam_bench_now(){
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec * 1e9 + time.tv_nsec;
+}
+
+void noam_bench_discard(const char* str, size_t length, void* data){
+}
+
+/* noam_bench_read: reads a file into a C string ending with a space like noam_vm_load_file does,
+ * returns NULL if the file cannot be read */
+char* noam_bench_read(const char* path){
+    FILE* file = fopen(path, "r");
+
+    if(!file){
+        return NULL;
+    }
+
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    char* source = malloc((size_t)length + 2);
+    size_t read = fread(source, 1, (size_t)length, file);
+    fclose(file);
+
+    source[read] = ' ';
+    source[read + 1] = '\0';
+    return source;
+}
+
+/* noam_bench_generate: a large source of many small functions, mostly work for the lexer and the parser */
+char* noam_bench_generate(size_t funcs){
+    noam_buffer* source = noam_buffer_create(1);
+    char line[NOAM_BENCH_LINE_LENGTH];
+
+    for(size_t i = 0; i < funcs; ++i){
+        int length = snprintf(line, NOAM_BENCH_LINE_LENGTH,
+                              "func f%lu(a, b){\n"
+                              "    c = a * %lu + b\n"
+                              "    if c > %lu { c -= b } else { c += 1 }\n"
+                              "    return c\n"
+                              "}\n"
+                              "v%lu = f%lu(%lu, 2)\n",
+                              (unsigned long)i, (unsigned long)i, (unsigned long)i * 3,
+                              (unsigned long)i, (unsigned long)i, (unsigned long)i);
+        noam_buffer_append(source, line, (size_t)length);
+    }
+
+    char eof = ' ';
+    noam_buffer_push(source, &eof);
+    noam_buffer_terminate(source);
+
+    char* str = source->data;
+    free(source);
+    return str;
+}
+
+void noam_bench_count(noam_alloc_totals* totals, size_t* allocs, size_t* bytes){
+    noam_alloc_totals now;
+    noam_alloc_stats_totals(&now);
+    *allocs = now.count - totals->count;
+    *bytes = now.bytes - totals->bytes;
+    *totals = now;
+}
+
+/* noam_bench_lazy: set by --lazy, function bodies are parsed on their first call, so during the run */
+static int noam_bench_lazy = 0;
+
+/* noam_bench_once: lexes, parses and runs a source on a new vm, fills `times` in nanoseconds
+ * and the allocations of each stage if the statistics are on, returns 0 on an error */
+int noam_bench_once(const char* name, const char* source, double* times, size_t* allocs, size_t* bytes){
+    noam_vm* vm = noam_vm_create();
+    noam_alloc_totals totals;
+    jmp_buf recover;
+
+    noam_native_register_math(vm);
+    noam_vm_set_lazy(vm, noam_bench_lazy);
+    noam_vm_set_output(vm, &noam_bench_discard, NULL);
+    noam_alloc_stats_totals(&totals);
+    vm->recover = &recover;
+
+    if(setjmp(recover)){
+        fprintf(stderr, "noam_bench: %s: %s\n", name, noam_vm_error_message(vm));
+        vm->recover = NULL;
+        noam_vm_destroy(vm);
+        return 0;
+    }
+
+    noam_parser parser;
+    memset(&parser, 0, sizeof(noam_parser));
+    parser.vm = vm;
+
+    double start = noam_bench_now();
+    parser.tokens = noam_parse_tokens(source);
+    double lexed = noam_bench_now();
+    noam_bench_count(&totals, &allocs[NOAM_BENCH_LEX], &bytes[NOAM_BENCH_LEX]);
+
+    if(!parser.tokens){
+        noam_vm_syntax_error(vm, "unknown token");
+    }
+
+    double parsing = noam_bench_now();
+    noam_buffer* statements = noam_parse_statements(&parser, vm->symbol_table);
+    double parsed = noam_bench_now();
+    noam_tokens_release(parser.tokens);
+    noam_bench_count(&totals, &allocs[NOAM_BENCH_PARSE], &bytes[NOAM_BENCH_PARSE]);
+
+    noam_buffer_push(vm->symbol_table->main, &statements);
+    noam_stack_globals(vm->stack, vm->symbol_table->head->slots);
+
+    double running = noam_bench_now();
+    noam_statements_run(statements, vm);
+    double ran = noam_bench_now();
+    noam_bench_count(&totals, &allocs[NOAM_BENCH_RUN], &bytes[NOAM_BENCH_RUN]);
+
+    times[NOAM_BENCH_LEX] = lexed - start;
+    times[NOAM_BENCH_PARSE] = parsed - parsing;
+    times[NOAM_BENCH_RUN] = ran - running;
+
+    vm->recover = NULL;
+    noam_vm_destroy(vm);
+    return 1;
+}
+
+int noam_bench_cmp(const void* lhs, const void* rhs){
+    double l = *(const double*)lhs;
+    double r = *(const double*)rhs;
+    return l < r ? -1 : l > r;
+}
+
+/* noam_bench_script: measures a source over `runs` runs, returns 0 on an error */
+int noam_bench_script(noam_bench_result* result, const char* source, size_t runs){
+    double times[NOAM_BENCH_STAGES];
+
+    /* a warm-up run with the allocation counting on */
+    noam_alloc_stats_enable(1);
+    int ok = noam_bench_once(result->name, source, times, result->allocs, result->bytes);
+    noam_alloc_stats_enable(0);
+
+    for(size_t i = 0; ok && i < runs; ++i){
+        size_t allocs[NOAM_BENCH_STAGES];
+        size_t bytes[NOAM_BENCH_STAGES];
+        ok = noam_bench_once(result->name, source, times, allocs, bytes);
+
+        for(size_t stage = 0; stage < NOAM_BENCH_STAGES; ++stage){
+            result->times[stage][i] = times[stage];
+        }
+    }
+
+    return ok;
+}
+
+void noam_bench_write(FILE* stream, noam_bench_result* results, size_t length, size_t runs){
+    fprintf(stream, "{\n  \"runs\": %lu,\n  \"benchmarks\": [\n", (unsigned long)runs);
+
+    for(size_t i = 0; i < length; ++i){
+        noam_bench_result* result = &results[i];
+        fprintf(stream, "    {\"name\": \"%s\", \"stages\": {", result->name);
+
+        for(size_t stage = 0; stage < NOAM_BENCH_STAGES; ++stage){
+            double* times = result->times[stage];
+            qsort(times, runs, sizeof(double), &noam_bench_cmp);
+
+            double median = runs % 2 ? times[runs / 2] : (times[runs / 2 - 1] + times[runs / 2]) / 2;
+            double p99 = times[(runs * 99 + 99) / 100 - 1];
+
+            fprintf(stream, "%s\n      \"%s\": {\"median_ns\": %.0f, \"p99_ns\": %.0f, \"allocs\": %lu, \"bytes\": %lu}",
+                    stage ? "," : "", noam_bench_stage_names[stage], median, p99,
+                    (unsigned long)result->allocs[stage], (unsigned long)result->bytes[stage]);
+        }
+
+        fprintf(stream, "\n    }}%s\n", i + 1 < length ? "," : "");
+    }
+
+    fprintf(stream, "  ]\n}\n");
+}
+
+/* noam_bench_name: the file name of a path without the extension */
+const char* noam_bench_name(const char* path){
+    const char* slash = strrchr(path, '/');
+    const char* name = slash ? slash + 1 : path;
+    const char* dot = strrchr(name, '.');
+    size_t length = dot ? (size_t)(dot - name) : strlen(name);
+    char* str = malloc(length + 1);
+    memcpy(str, name, length);
+    str[length] = '\0';
+    return str;
+}
+
+int main(int argc, char** argv){
+    static const char* scripts[] = {"recursion", "calls", "strings", "globals", "branches"};
+    const size_t defaults = sizeof(scripts) / sizeof(const char*);
+    size_t runs = NOAM_BENCH_RUNS;
+    const char* output = NULL;
+    noam_buffer* paths = noam_buffer_create(sizeof(char*));
+
+    for(int i = 1; i < argc; ++i){
+        if(!strncmp(argv[i], "--runs=", 7)){
+            runs = (size_t)atol(argv[i] + 7);
+        } else if(!strncmp(argv[i], "--json=", 7)){
+            output = argv[i] + 7;
+        } else if(!strcmp(argv[i], "--lazy")){
+            noam_bench_lazy = 1;
+        } else {
+            noam_buffer_push(paths, &argv[i]);
+        }
+    }
+
+    if(!runs){
+        fprintf(stderr, "usage noam_bench [--runs=count] [--json=path] [--lazy] [script ...]\n");
+        return -1;
+    }
+
+    /* without scripts, the bundled ones and a generated large source */
+    int bundled = paths->length == 0;
+
+    for(size_t i = 0; bundled && i < defaults; ++i){
+        char* path = malloc(strlen(NOAM_BENCH_SCRIPTS) + strlen(scripts[i]) + sizeof("/.noam"));
+        sprintf(path, "%s/%s.noam", NOAM_BENCH_SCRIPTS, scripts[i]);
+        noam_buffer_push(paths, &path);
+    }
+
+    size_t length = paths->length + (bundled ? 1 : 0);
+    noam_bench_result* results = malloc(length * sizeof(noam_bench_result));
+    int status = 0;
+
+    for(size_t i = 0; i < length; ++i){
+        int large = i == paths->length;
+        const char* path = large ? NULL : *(char**)noam_buffer_at(paths, i);
+        char* source = large ? noam_bench_generate(NOAM_BENCH_LARGE_FUNCS) : noam_bench_read(path);
+
+        memset(&results[i], 0, sizeof(noam_bench_result));
+        results[i].name = large ? "large" : noam_bench_name(path);
+
+        for(size_t stage = 0; stage < NOAM_BENCH_STAGES; ++stage){
+            results[i].times[stage] = calloc(runs, sizeof(double));
+        }
+
+        if(!source){
+            fprintf(stderr, "noam_bench: cannot open the file %s\n", path);
+            status = -1;
+            continue;
+        }
+
+        if(!noam_bench_script(&results[i], source, runs)){
+            status = -1;
+        }
+
+        free(source);
+    }
+
+    FILE* stream = output ? fopen(output, "w") : stdout;
+
+    if(!stream){
+        fprintf(stderr, "noam_bench: cannot open the file %s\n", output);
+        return -1;
+    }
+
+    noam_bench_write(stream, results, length, runs);
+
+    if(output){
+        fclose(stream);
+    }
+
+    return status;
+}
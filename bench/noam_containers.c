@@ -0,0 +1,263 @@
+#include <time.h>
+
+#include "noam_dict.h"
+
+#define NOAM_CONTAINERS_MAX 1000000
+#define NOAM_CONTAINERS_OPS 2000000
+#define NOAM_CONTAINERS_KEY_LENGTH 32
+#define NOAM_CONTAINERS_APPEND 12
+#define NOAM_CONTAINERS_SCRATCH_SLOTS 2
+
+/* noam_containers_prefixes, noam_containers_words: pieces of identifier-like keys, `player_health`, `get_pos2` and so on */
+static const char* noam_containers_prefixes[] = {"", "", "get_", "set_", "is_", "on_", "_"};
+static const char* noam_containers_words[] = {"player", "pos", "health", "speed", "x", "y", "target", "count",
+                                              "item", "update", "i", "velocity", "name", "score", "enemy", "t"};
+
+static size_t noam_containers_seed = 88172645463325252u;
+
+size_t noam_containers_random(){
+    noam_containers_seed ^= noam_containers_seed << 13;
+    noam_containers_seed ^= noam_containers_seed >> 7;
+    noam_containers_seed ^= noam_containers_seed << 17;
+    return noam_containers_seed;
+}
+
+double noam_containers_now(){
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec * 1e9 + time.tv_nsec;
+}
+
+/* noam_containers_keys: `length` distinct identifier-like string keys, mostly short with a few long ones,
+ * keys of a `miss` set never equal keys of the other set */
+noam_buffer* noam_containers_keys(size_t length, int miss){
+    const size_t prefixes = sizeof(noam_containers_prefixes) / sizeof(const char*);
+    const size_t words = sizeof(noam_containers_words) / sizeof(const char*);
+    noam_buffer* keys = noam_buffer_create(sizeof(noam_buffer));
+    char str[NOAM_CONTAINERS_KEY_LENGTH];
+
+    for(size_t i = 0; i < length; ++i){
+        size_t r = noam_containers_random();
+        int size = snprintf(str, NOAM_CONTAINERS_KEY_LENGTH, "%s%s%s%s%lu", miss ? "m" : "",
+                            noam_containers_prefixes[r % prefixes], noam_containers_words[(r >> 8) % words],
+                            (r >> 16) % 4 ? "" : "_", (unsigned long)i);
+        noam_buffer* key = noam_buffer_create(1);
+        noam_buffer_append(key, str, (size_t)size);
+        noam_buffer_terminate(key);
+        noam_buffer_push(keys, key);
+        free(key);
+    }
+
+    return keys;
+}
+
+void noam_containers_keys_release(noam_buffer* keys){
+    for(size_t i = 0; i < keys->length; ++i){
+        free(((noam_buffer*)noam_buffer_at(keys, i))->data);
+    }
+    noam_buffer_release(keys);
+}
+
+noam_dict* noam_containers_dict(){
+    return noam_dict_createv(sizeof(noam_buffer), sizeof(size_t), (noam_hash_func)&noam_hash_string,
+                             (noam_cmp_func)&noam_cmp_string, NULL);
+}
+
+void noam_containers_print(const char* workload, size_t size, double ns, size_t ops, double bytes){
+    printf("%-22s %8lu %10.1f %12.1f\n", workload, (unsigned long)size, ns / ops, bytes);
+}
+
+/* noam_containers_repeats: repeats of a workload of `size` operations, so each one runs about the same time */
+size_t noam_containers_repeats(size_t size){
+    return size < NOAM_CONTAINERS_OPS ? NOAM_CONTAINERS_OPS / size : 1;
+}
+
+/* noam_containers_insert: inserts the keys into new dicts, bytes are the slots per entry with the two scratch slots */
+void noam_containers_insert(noam_buffer* keys){
+    size_t repeats = noam_containers_repeats(keys->length);
+    double bytes = 0;
+    double start = noam_containers_now();
+
+    for(size_t r = 0; r < repeats; ++r){
+        noam_dict* dict = noam_containers_dict();
+
+        for(size_t i = 0; i < keys->length; ++i){
+            noam_dict_insert(dict, noam_buffer_at(keys, i), &i);
+        }
+
+        bytes = (double)(dict->size + NOAM_CONTAINERS_SCRATCH_SLOTS) * dict->stride / dict->length;
+        noam_dict_release(dict);
+    }
+
+    noam_containers_print("dict_insert", keys->length, noam_containers_now() - start, repeats * keys->length, bytes);
+}
+
+/* noam_containers_find: looks keys up with `hits` percent of them present */
+void noam_containers_find(noam_buffer* keys, noam_buffer* misses, size_t hits){
+    noam_dict* dict = noam_containers_dict();
+    size_t length = keys->length;
+    noam_buffer* lookups = noam_buffer_create(sizeof(noam_buffer*));
+    char workload[NOAM_CONTAINERS_KEY_LENGTH];
+    size_t found = 0;
+    size_t expected = 0;
+
+    for(size_t i = 0; i < length; ++i){
+        noam_dict_insert(dict, noam_buffer_at(keys, i), &i);
+    }
+
+    /* the lookups are shuffled, so hits and misses are interleaved and keys come in no particular order */
+    for(size_t i = 0; i < length; ++i){
+        noam_buffer* key = noam_buffer_at(i * 100 < hits * length ? keys : misses, i);
+        expected += i * 100 < hits * length;
+        noam_buffer_push(lookups, &key);
+    }
+
+    for(size_t i = length; i > 1; --i){
+        size_t j = noam_containers_random() % i;
+        noam_buffer* swap = *(noam_buffer**)noam_buffer_at(lookups, i - 1);
+        *(noam_buffer**)noam_buffer_at(lookups, i - 1) = *(noam_buffer**)noam_buffer_at(lookups, j);
+        *(noam_buffer**)noam_buffer_at(lookups, j) = swap;
+    }
+
+    size_t repeats = noam_containers_repeats(length);
+    double start = noam_containers_now();
+
+    for(size_t r = 0; r < repeats; ++r){
+        for(size_t i = 0; i < length; ++i){
+            found += noam_dict_find(dict, *(noam_buffer**)noam_buffer_at(lookups, i)) != NULL;
+        }
+    }
+
+    double ns = noam_containers_now() - start;
+
+    snprintf(workload, NOAM_CONTAINERS_KEY_LENGTH, "dict_find_%lu%%_hit", (unsigned long)hits);
+    noam_containers_print(workload, length, ns, repeats * length,
+                          (double)(dict->size + NOAM_CONTAINERS_SCRATCH_SLOTS) * dict->stride / dict->length);
+
+    if(found != repeats * expected){
+        fprintf(stderr, "noam_containers: unexpected number of hits %lu\n", (unsigned long)found);
+    }
+
+    noam_buffer_release(lookups);
+    noam_dict_release(dict);
+}
+
+/* noam_containers_push: pushes ints one by one into new buffers */
+void noam_containers_push(size_t length){
+    size_t repeats = noam_containers_repeats(length);
+    double bytes = 0;
+    double start = noam_containers_now();
+
+    for(size_t r = 0; r < repeats; ++r){
+        noam_buffer* buffer = noam_buffer_create(sizeof(int));
+
+        for(size_t i = 0; i < length; ++i){
+            int value = (int)i;
+            noam_buffer_push(buffer, &value);
+        }
+
+        bytes = (double)buffer->size * buffer->chunk / buffer->length;
+        noam_buffer_release(buffer);
+    }
+
+    noam_containers_print("buffer_push", length, noam_containers_now() - start, repeats * length, bytes);
+}
+
+/* noam_containers_append: builds a string of `length` chars from short pieces, the way sources are read */
+void noam_containers_append(size_t length){
+    static const char piece[NOAM_CONTAINERS_APPEND] = "identifier_";
+    size_t repeats = noam_containers_repeats(length);
+    double bytes = 0;
+    double start = noam_containers_now();
+
+    for(size_t r = 0; r < repeats; ++r){
+        noam_buffer* buffer = noam_buffer_create(1);
+
+        for(size_t i = 0; i < length; i += NOAM_CONTAINERS_APPEND){
+            size_t count = length - i < NOAM_CONTAINERS_APPEND ? length - i : NOAM_CONTAINERS_APPEND;
+            noam_buffer_append(buffer, piece, count);
+        }
+
+        bytes = (double)buffer->size * buffer->chunk / buffer->length;
+        noam_buffer_release(buffer);
+    }
+
+    noam_containers_print("buffer_append", length, noam_containers_now() - start, repeats * length, bytes);
+}
+
+/* noam_containers_merge: merges a word-sized buffer into a growing one, the way the lexer builds tokens */
+void noam_containers_merge(size_t length){
+    noam_buffer* word = noam_buffer_create(1);
+    size_t repeats = noam_containers_repeats(length);
+    double bytes = 0;
+
+    noam_buffer_append(word, "velocity", 8);
+
+    double start = noam_containers_now();
+
+    for(size_t r = 0; r < repeats; ++r){
+        noam_buffer* buffer = noam_buffer_create(1);
+
+        for(size_t i = 0; i < length; ++i){
+            noam_buffer_merge(buffer, word);
+        }
+
+        bytes = (double)buffer->size * buffer->chunk / length;
+        noam_buffer_release(buffer);
+    }
+
+    noam_containers_print("buffer_merge", length, noam_containers_now() - start, repeats * length, bytes);
+    noam_buffer_release(word);
+}
+
+/* noam_containers_clear: fills and clears the same buffer over and over */
+void noam_containers_clear(size_t length){
+    noam_buffer* buffer = noam_buffer_create(1);
+    size_t repeats = noam_containers_repeats(length);
+    double bytes = 0;
+    double start = noam_containers_now();
+
+    for(size_t r = 0; r < repeats; ++r){
+        for(size_t i = 0; i < length; ++i){
+            char c = (char)('a' + i % 26);
+            noam_buffer_push(buffer, &c);
+        }
+
+        bytes = (double)buffer->size * buffer->chunk / buffer->length;
+        noam_buffer_clear(buffer);
+    }
+
+    noam_containers_print("buffer_clear_reuse", length, noam_containers_now() - start, repeats * length, bytes);
+    noam_buffer_release(buffer);
+}
+
+int main(int argc, char** argv){
+    size_t max = argc > 1 ? (size_t)atol(argv[1]) : NOAM_CONTAINERS_MAX;
+
+    if(!max){
+        fprintf(stderr, "usage noam_containers [max size]\n");
+        return -1;
+    }
+
+    printf("%-22s %8s %10s %12s\n", "workload", "size", "ns/op", "bytes/entry");
+
+    for(size_t size = 1; size <= max; size *= 10){
+        noam_buffer* keys = noam_containers_keys(size, 0);
+        noam_buffer* misses = noam_containers_keys(size, 1);
+
+        noam_containers_insert(keys);
+        noam_containers_find(keys, misses, 100);
+        noam_containers_find(keys, misses, 90);
+        noam_containers_find(keys, misses, 50);
+        noam_containers_find(keys, misses, 0);
+        noam_containers_push(size);
+        noam_containers_append(size);
+        noam_containers_merge(size);
+        noam_containers_clear(size);
+
+        noam_containers_keys_release(keys);
+        noam_containers_keys_release(misses);
+    }
+
+    return 0;
+}
@@ -0,0 +1,80 @@
+#ifndef NOAM_ALLOC_H
+#define NOAM_ALLOC_H
+
+#include <stdio.h>
+
+#include "noam_trace.h"
+
+#define NOAM_ALLOC_TOP_SITES 10
+
+/* noam_alloc_site struct: counters of an allocation or a release site, one static per use of the macros
+ *
+ * category: what is counted, a type name such as `noam_int_value`, `token`, `dict nodes` or `buffer growth`
+ * file, line: the site
+ * freed: set for release sites
+ * count, bytes: calls and bytes, updated atomically since pmap workers allocate too
+ * next: the sites seen so far are listed from noam_alloc_sites
+ * */
+typedef struct noam_alloc_site {
+    const char*             category;
+    const char*             file;
+    int                     line;
+    int                     freed;
+    size_t                  count;
+    size_t                  bytes;
+    int                     listed;
+    struct noam_alloc_site* next;
+} noam_alloc_site;
+
+/* noam_alloc_totals struct: totals of a category
+ *
+ * count, bytes: allocations and allocated bytes
+ * freed, freed_bytes: releases and released bytes
+ * live: allocations not released yet, values are never released, so they stay live
+ * */
+typedef struct {
+    size_t count;
+    size_t bytes;
+    size_t freed;
+    size_t freed_bytes;
+    size_t live;
+} noam_alloc_totals;
+
+/* noam_alloc_on: set by noam_alloc_stats_enable, process-wide */
+extern int noam_alloc_on;
+
+/* NOAM_ALLOC_STAT, NOAM_FREE_STAT: count an allocation or a release of `bytes` of a category,
+ * when the statistics are off they cost a load and a not taken branch like the tracing */
+#define NOAM_ALLOC_SITE(category, bytes, freed)                                                   \
+do {                                                                                              \
+    if(NOAM_UNLIKELY(noam_alloc_on)) {                                                            \
+        static noam_alloc_site noam_site_ = {category, __FILE__, __LINE__, freed, 0, 0, 0, NULL}; \
+        noam_alloc_count(&noam_site_, (bytes));                                                   \
+    }                                                                                             \
+} while(0)
+#define NOAM_ALLOC_STAT(category, bytes) NOAM_ALLOC_SITE(category, bytes, 0)
+#define NOAM_FREE_STAT(category, bytes) NOAM_ALLOC_SITE(category, bytes, 1)
+
+/* noam_alloc_stats_enable: turns the counting on or off, the counters are kept */
+void noam_alloc_stats_enable(int on);
+
+/* noam_alloc_count: adds a call of `bytes` to a site, lists the site on its first call */
+void noam_alloc_count(noam_alloc_site* site, size_t bytes);
+
+/* noam_alloc_stats_category: totals of a category, returns 0 if nothing of it was counted */
+int noam_alloc_stats_category(const char* category, noam_alloc_totals* totals);
+
+/* noam_alloc_stats_totals: totals of all the categories */
+void noam_alloc_stats_totals(noam_alloc_totals* totals);
+
+/* noam_alloc_stats_reset: zeroes all the counters */
+void noam_alloc_stats_reset();
+
+/* noam_alloc_peak_rss: peak resident set size of the process in bytes */
+size_t noam_alloc_peak_rss();
+
+/* noam_alloc_stats_report: writes the totals per category, the peak RSS
+ * and the `sites` allocation sites with the most bytes to `stream` */
+void noam_alloc_stats_report(FILE* stream, size_t sites);
+
+#endif //NOAM_ALLOC_H
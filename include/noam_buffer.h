@@ -54,6 +54,9 @@ int noam_buffer_empty(noam_buffer* buffer);
 /* noam_buffer_clear: calls a destructor for each complex element and reallocates the buffer */
 void noam_buffer_clear(noam_buffer* buffer);
 
+/* noam_buffer_terminate: puts a zero element right after the last one, so char buffers are valid C strings */
+void noam_buffer_terminate(noam_buffer* buffer);
+
 /* noam_buffer_copy: returns a copy of a buffer */
 noam_buffer* noam_buffer_copy(noam_buffer* buffer);
 
@@ -0,0 +1,43 @@
+#ifndef NOAM_BUILTIN_H
+#define NOAM_BUILTIN_H
+
+#include "noam_expression.h"
+
+#define NOAM_BUILTIN_MAX_ARGS 8
+
+/* noam_builtin_func: a function implemented in C, receives already evaluated arguments */
+typedef noam_value*(*noam_builtin_func)(noam_vm* vm, noam_value** args, size_t argc);
+
+/* noam_builtin struct: describes a built-in function
+ *
+ * name: name used in scripts
+ * arity: number of arguments
+ * func: implementation
+ * */
+typedef struct noam_builtin {
+    const char*       name;
+    size_t            arity;
+    noam_builtin_func func;
+} noam_builtin;
+
+/* noam_builtin_find: returns a built-in function by its name or NULL */
+const noam_builtin* noam_builtin_find(const noam_buffer* name);
+
+/* array built-ins, bulk ones run SIMD kernels from noam_simd.h
+ *
+ * array(n, v): a new array of `n` elements equal to `v`, its type defines the element type
+ * len(a), sum(a), min(a), max(a), dot(a, b): return a scalar
+ * scale(a, k), add(a, b), fill(a, v), sort(a): modify `a` in place and return it
+ * */
+noam_value* noam_builtin_array(noam_vm* vm, noam_value** args, size_t argc);
+noam_value* noam_builtin_len(noam_vm* vm, noam_value** args, size_t argc);
+noam_value* noam_builtin_sum(noam_vm* vm, noam_value** args, size_t argc);
+noam_value* noam_builtin_min(noam_vm* vm, noam_value** args, size_t argc);
+noam_value* noam_builtin_max(noam_vm* vm, noam_value** args, size_t argc);
+noam_value* noam_builtin_scale(noam_vm* vm, noam_value** args, size_t argc);
+noam_value* noam_builtin_add(noam_vm* vm, noam_value** args, size_t argc);
+noam_value* noam_builtin_dot(noam_vm* vm, noam_value** args, size_t argc);
+noam_value* noam_builtin_fill(noam_vm* vm, noam_value** args, size_t argc);
+noam_value* noam_builtin_sort(noam_vm* vm, noam_value** args, size_t argc);
+
+#endif //NOAM_BUILTIN_H
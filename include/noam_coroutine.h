@@ -0,0 +1,84 @@
+#ifndef NOAM_COROUTINE_H
+#define NOAM_COROUTINE_H
+
+#include "noam_statement.h"
+
+/* noam_resume_point struct: where a suspended coroutine goes on in one of its nested statements
+ *
+ * index: statement of a block, branch of an if statement or element of a for loop
+ * iterable, pairs: the value iterated by a for loop and the copied pairs of a map
+ * */
+typedef struct {
+    size_t       index;
+    noam_value*  iterable;
+    noam_buffer* pairs;
+} noam_resume_point;
+
+/* noam_coroutine_value struct: a call of a function with yield statements which runs step by step
+ *
+ * func: the function
+ * body, size: the body and the frame size of the function as the coroutine was created with,
+ *             a reloaded function leaves its suspended coroutines on the old body
+ * points: resume points of the last yield, innermost first, created on the first yield
+ * value: the last yielded value, the returned value once the coroutine is done
+ * frame: first slot of the frame while the coroutine runs
+ * caller: the coroutine which resumed this one while it runs, NULL otherwise
+ * running, done: state of the coroutine
+ * slots: the function frame saved between resumes
+ *
+ * no C stack is kept while a coroutine is suspended, its state is a single allocation with the frame
+ * and a few resume points, statements are entered again down to the yield statement on resume
+ * */
+typedef struct noam_coroutine_value {
+    noam_value_vtable_*          vtable_;
+    noam_func*                   func;
+    noam_buffer*                 body;
+    size_t                       size;
+    noam_buffer*                 points;
+    noam_value*                  value;
+    size_t                       frame;
+    struct noam_coroutine_value* caller;
+    int                          running;
+    int                          done;
+    noam_value*                  slots[];
+} noam_coroutine_value;
+
+/* noam_yield_statement struct: suspends the coroutine running the function
+ *
+ * expression: a value passed to the resuming side, nil if omitted
+ * */
+typedef struct {
+    noam_statement_vtable_* vtable_;
+    size_t                  line;
+    noam_expression*        expression;
+} noam_yield_statement;
+
+/* noam_coroutine_value_create: a suspended call, `args` are the first func->slots values of the frame */
+noam_coroutine_value* noam_coroutine_value_create(noam_func* func, noam_value** args);
+const char* noam_coroutine_value_to_string(noam_coroutine_value* value, noam_vm* vm);
+void noam_coroutine_value_release(noam_coroutine_value* value);
+noam_value* noam_coroutine_value_get(noam_coroutine_value* value, noam_vm* vm);
+
+/* noam_coroutine_resume: runs a coroutine up to the next yield or return, returns the yielded value,
+ * a coroutine which is done keeps returning its result */
+noam_value* noam_coroutine_resume(noam_coroutine_value* coroutine, noam_vm* vm);
+
+/* noam_coroutine_suspend, noam_coroutine_point: save a resume point while a yield unwinds the statements,
+ * noam_coroutine_point returns the outermost saved point on resume */
+void noam_coroutine_suspend(noam_vm* vm, size_t index, noam_value* iterable, noam_buffer* pairs);
+noam_resume_point noam_coroutine_point(noam_vm* vm);
+
+noam_yield_statement* noam_yield_statement_create(noam_expression* expression);
+noam_value* noam_yield_statement_run(noam_yield_statement* statement, noam_vm* vm);
+void noam_yield_statement_release(noam_yield_statement* statement);
+
+/* coroutine built-ins
+ *
+ * resume(c): runs the coroutine up to the next yield and returns the yielded value
+ * done(c): checks if the coroutine has returned
+ * calling a function with a yield statement creates a coroutine, for loops iterate over the yielded values
+ * */
+noam_value* noam_builtin_resume(noam_vm* vm, noam_value** args, size_t argc);
+noam_value* noam_builtin_done(noam_vm* vm, noam_value** args, size_t argc);
+
+#endif //NOAM_COROUTINE_H
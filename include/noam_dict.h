@@ -4,14 +4,16 @@
 #include "noam_utility.h"
 #include "noam_buffer.h"
 
-/* noam_dict_node: node of a dictionary in a chaining scheme
+/* noam_dict_node: slot of a dictionary in an open addressing (Robin Hood) scheme
  *
- * data: holds a key:value pair, where key starts at the beginning and value = data + key_chunk
- * next: pointer to the next node in a bin
+ * hash: cached hash of the key, compared before the key itself
+ * probe: distance from the home slot plus one, 0 marks an empty slot
+ * data: holds a key:value pair inline, where key starts at the beginning and value = data + key_chunk
  * */
 typedef struct noam_dict_node {
-    char*                  data;
-    struct noam_dict_node* next;
+    size_t hash;
+    size_t probe;
+    char   data[];
 } noam_dict_node;
 
 /* noam_hash_func: a prototype of a hash function used in dictionaries */
@@ -22,19 +24,24 @@ typedef int(*noam_cmp_func)(const void*, const void*);
 
 /* noam_dict struct: represents a hash map
  *
- * nodes: array of bins
+ * nodes: contiguous array of slots, `stride` bytes each, allocated on the first insertion
  * length: number of elements
- * size: number of bins
+ * size: number of slots, always a power of two
+ * stride: size of a slot in bytes
  * key_chunk: size of key in bytes
  * val_chunk: size of value in bytes
  * hash: hash function for keys
  * cmp: comparator for keys
  * release: destructor for complex types
+ *
+ * the table doubles its size once the load factor exceeds 3/4,
+ * so pointers to nodes are invalidated by any insertion or removal
  * */
 typedef struct {
-    noam_dict_node*   nodes;
+    char*             nodes;
     size_t            length;
     size_t            size;
+    size_t            stride;
     size_t            key_chunk;
     size_t            val_chunk;
     noam_hash_func    hash;
@@ -48,10 +55,20 @@ noam_dict* noam_dict_createv(size_t key_chunk, size_t val_chunk,
 
 noam_dict* noam_dict_create(size_t key_chunk, size_t val_chunk, noam_hash_func hash);
 
+/* noam_dict_insert: inserts a key:value pair, the value is overwritten if the key is already present */
 void noam_dict_insert(noam_dict* dict, void* key, void* value);
 
+/* noam_dict_find: returns a node holding the key or NULL */
 noam_dict_node* noam_dict_find(noam_dict* dict, void* key);
 
+/* noam_dict_remove: calls a destructor for the pair and removes it, returns 0 if the key is absent */
+int noam_dict_remove(noam_dict* dict, void* key);
+
+/* noam_dict_node_at: returns a slot at specific position, empty slots have zero `probe` */
+noam_dict_node* noam_dict_node_at(noam_dict* dict, size_t index);
+
+void* noam_dict_key(noam_dict_node* node);
+
 void* noam_dict_value(noam_dict* dict, noam_dict_node* node);
 
 void noam_dict_release(noam_dict* dict);
@@ -3,15 +3,17 @@
 
 #include "noam_lexer.h"
 #include "noam_symbol.h"
+#include "noam_vm.h"
 
 struct noam_value;
 struct noam_expression;
 
-/* noam_expression_get_func: evaluates an expression to a specific value */
-typedef struct noam_value*(*noam_expression_get_func)(struct noam_expression*);
+/* noam_expression_get_func: evaluates an expression to a specific value in the vm */
+typedef struct noam_value*(*noam_expression_get_func)(struct noam_expression*, noam_vm*);
 
-/* noam_value_to_string_func: converts a value to string */
-typedef const char*(*noam_value_to_string_func)(struct noam_value*);
+/* noam_value_to_string_func: converts a value to string, the result may live in the vm scratch space
+ * until the next conversion */
+typedef const char*(*noam_value_to_string_func)(struct noam_value*, noam_vm*);
 
 /* these vtables emulate virtual functions calls, because C doesn't support polymorphism by default
  * in order to be compliant with a specific call, object must have a pointer to a proper virtual table
@@ -43,25 +45,33 @@ typedef struct noam_expression {
 /* noam_variable_expression struct: variable referencing
  *
  * name: name of the variable
- * scope: scope in which it is defined
+ * slot: index of the variable in its frame resolved at parse time
+ * global: if the slot is in the global frame rather than in the frame of the running function
  * */
 typedef struct {
     noam_expression_vtable_* vtable_;
     noam_buffer*             name;
-    noam_scope*              scope;
+    size_t                   slot;
+    int                      global;
 } noam_variable_expression;
 
 /* noam_func_call_expression struct: function call
  *
  * name: name of the function
  * args: arguments passed to function as noam_expressions array
- * symbol_table: needed for function lookup and scope finding
+ * symbol_table: needed for function lookup
+ * func: the function linked at parse time, functions may be defined after the call site
+ * tail: set for `return f(...)` in a function, the call then reuses the frame of the caller
+ * unwind: a value returned by a tail call in place of the result, so the caller statements stop
  * */
 typedef struct {
     noam_expression_vtable_* vtable_;
     noam_buffer*             name;
     noam_buffer*             args;
     noam_symbol_table*       symbol_table;
+    noam_func*               func;
+    int                      tail;
+    struct noam_value*       unwind;
 } noam_func_call_expression;
 
 /* noam_value struct: in most cases a value of some internal type
@@ -71,19 +81,31 @@ typedef struct noam_value {
     noam_value_vtable_* vtable_;
 } noam_value;
 
+/* owned: set while the value is referred to only by the slot a compound assignment stored it to,
+ * the assignment then updates it in place, any read through a variable clears it */
 typedef struct {
     noam_value_vtable_* vtable_;
     int                 value;
+    int                 owned;
 } noam_int_value;
 
 typedef struct {
     noam_value_vtable_* vtable_;
     float               value;
+    int                 owned;
 } noam_float_value;
 
+/* noam_string_value struct: a string
+ *
+ * str: zero terminated characters
+ * hash: hash of `str` cached once the string is used as a map key, valid if `hashed` is set
+ * owned: set like `owned` of ints, `+=` appends to `str` then */
 typedef struct {
     noam_value_vtable_* vtable_;
     noam_buffer*        str;
+    size_t              hash;
+    int                 hashed;
+    int                 owned;
 } noam_string_value;
 
 typedef struct {
@@ -95,6 +117,50 @@ typedef struct {
     noam_value_vtable_* vtable_;
 } noam_nil_value;
 
+/* noam_array_value struct: a homogeneous array of unboxed numbers
+ *
+ * elem: NOAM_INT_TOKEN or NOAM_FLOAT_TOKEN, type of every element
+ * data: contiguous buffer of ints or floats
+ * repr: string representation built on demand
+ * frozen: set while pmap workers may read the array, changing or printing it is an error then */
+typedef struct {
+    noam_value_vtable_* vtable_;
+    noam_token          elem;
+    noam_buffer*        data;
+    noam_buffer*        repr;
+    int                 frozen;
+} noam_array_value;
+
+/* noam_array_expression struct: an array literal
+ *
+ * elements: noam_expressions evaluated into a new array each time */
+typedef struct {
+    noam_expression_vtable_* vtable_;
+    noam_buffer*             elements;
+} noam_array_expression;
+
+/* noam_index_expression struct: element access
+ *
+ * target: an expression evaluated to an array
+ * index: an expression evaluated to an int */
+typedef struct {
+    noam_expression_vtable_* vtable_;
+    noam_expression*         target;
+    noam_expression*         index;
+} noam_index_expression;
+
+struct noam_builtin;
+
+/* noam_builtin_call_expression struct: call of a function implemented in C, resolved at parse time
+ *
+ * builtin: the function descriptor
+ * args: arguments passed to function as noam_expressions array */
+typedef struct {
+    noam_expression_vtable_*   vtable_;
+    const struct noam_builtin* builtin;
+    noam_buffer*               args;
+} noam_builtin_call_expression;
+
 /* noam_op_expression struct: a binary operator
  *
  * op: string representation of operation
@@ -106,49 +172,99 @@ typedef struct {
     noam_expression*         rhs;
 } noam_op_expression;
 
-noam_value* noam_expression_get(noam_expression* expression);
-const char* noam_value_to_string(noam_value* value);
+noam_value* noam_expression_get(noam_expression* expression, noam_vm* vm);
+const char* noam_value_to_string(noam_value* value, noam_vm* vm);
 void noam_expression_release(noam_expression* expression);
 
 int noam_value_is_instance(const noam_value* value, noam_token type);
 
+/* noam_value_share: clears `owned` of a value which may get another reference */
+void noam_value_share(noam_value* value);
+
 noam_variable_expression* noam_variable_expression_create(noam_buffer* name, noam_scope* scope);
-noam_value* noam_variable_expression_get(noam_variable_expression* expression);
+noam_value* noam_variable_expression_get(noam_variable_expression* expression, noam_vm* vm);
 void noam_variable_expression_release(noam_variable_expression* expression);
 
 noam_func_call_expression* noam_func_call_expression_create(
         noam_buffer* name, noam_buffer* args, noam_symbol_table* symbol_table
 );
-noam_value* noam_func_call_expression_get(noam_func_call_expression* expression);
+noam_value* noam_func_call_expression_get(noam_func_call_expression* expression, noam_vm* vm);
+noam_func* noam_func_call_expression_func(noam_func_call_expression* expression, noam_vm* vm);
+
+/* noam_func_call_expression_link: sets `func` of the calls parsed before their function was defined */
+void noam_func_call_expression_link(noam_symbol_table* symbol_table);
+
+/* noam_func_call: runs a function in a frame pushed by the caller and filled with its arguments,
+ * pops the frame and returns the result */
+noam_value* noam_func_call(noam_func* func, size_t frame, noam_vm* vm);
+
+/* noam_func_body: runs a function body in the current frame, a coroutine function returns a new coroutine */
+noam_value* noam_func_body(noam_func* func, size_t frame, noam_vm* vm);
+
+/* noam_func_tail: runs the functions called in tail position by a body which returned `result` */
+noam_value* noam_func_tail(noam_value* result, size_t frame, noam_vm* vm);
+int noam_expression_is_func_call(const noam_expression* expression);
+
+/* noam_func_call_expression_tail: marks a call in tail position */
+void noam_func_call_expression_tail(noam_func_call_expression* expression);
 void noam_func_call_expression_release(noam_func_call_expression* expression);
 
 noam_int_value* noam_int_value_create(int value);
-const char* noam_int_value_to_string(noam_int_value* value);
-noam_value* noam_int_value_get(noam_int_value* value);
+const char* noam_int_value_to_string(noam_int_value* value, noam_vm* vm);
+noam_value* noam_int_value_get(noam_int_value* value, noam_vm* vm);
 
 noam_float_value* noam_float_value_create(float value);
-const char* noam_float_value_to_string(noam_float_value* value);
-noam_value* noam_float_value_get(noam_float_value* value);
+const char* noam_float_value_to_string(noam_float_value* value, noam_vm* vm);
+noam_value* noam_float_value_get(noam_float_value* value, noam_vm* vm);
 
 noam_string_value* noam_string_value_create(noam_buffer* str);
-const char* noam_string_value_to_string(noam_string_value* value);
+const char* noam_string_value_to_string(noam_string_value* value, noam_vm* vm);
 void noam_string_value_release(noam_string_value* value);
-noam_value* noam_string_value_get(noam_string_value* value);
+noam_value* noam_string_value_get(noam_string_value* value, noam_vm* vm);
 
 noam_bool_value* noam_bool_value_create(int value);
-const char* noam_bool_value_to_string(noam_bool_value* value);
-noam_value* noam_bool_value_get(noam_bool_value* value);
+const char* noam_bool_value_to_string(noam_bool_value* value, noam_vm* vm);
+noam_value* noam_bool_value_get(noam_bool_value* value, noam_vm* vm);
 
 noam_nil_value* noam_nil_value_create();
-const char* noam_nil_value_to_string(noam_nil_value* value);
-noam_value* noam_nil_value_get(noam_nil_value* value);
+const char* noam_nil_value_to_string(noam_nil_value* value, noam_vm* vm);
+noam_value* noam_nil_value_get(noam_nil_value* value, noam_vm* vm);
+
+noam_array_value* noam_array_value_create(noam_token elem, size_t length);
+
+/* noam_array_value_write: raises an error if the array is frozen, called before changing it */
+void noam_array_value_write(noam_array_value* value, noam_vm* vm);
+const char* noam_array_value_to_string(noam_array_value* value, noam_vm* vm);
+void noam_array_value_release(noam_array_value* value);
+noam_value* noam_array_value_get(noam_array_value* value, noam_vm* vm);
+void* noam_array_value_at(noam_array_value* value, size_t index);
+
+noam_array_expression* noam_array_expression_create(noam_buffer* elements);
+noam_value* noam_array_expression_get(noam_array_expression* expression, noam_vm* vm);
+void noam_array_expression_release(noam_array_expression* expression);
+
+noam_index_expression* noam_index_expression_create(noam_expression* target, noam_expression* index);
+noam_value* noam_index_expression_get(noam_index_expression* expression, noam_vm* vm);
+void noam_index_expression_release(noam_index_expression* expression);
+int noam_expression_is_index(const noam_expression* expression);
+int noam_index_value(noam_vm* vm, noam_value* index);
+size_t noam_array_index(noam_vm* vm, noam_value* target, noam_value* index, noam_array_value** array);
+
+noam_builtin_call_expression* noam_builtin_call_expression_create(const struct noam_builtin* builtin,
+                                                                  noam_buffer* args);
+noam_value* noam_builtin_call_expression_get(noam_builtin_call_expression* expression, noam_vm* vm);
+void noam_builtin_call_expression_release(noam_builtin_call_expression* expression);
 
 int noam_values_equal_type(const noam_value* lhs, const noam_value* rhs, noam_token type);
+int noam_op_compare(const char* op, double lhs, double rhs);
+
+/* noam_op_values: applies a binary operator to evaluated operands, the result is a new value */
+noam_value* noam_op_values(noam_vm* vm, const char* op, noam_value* lhs, noam_value* rhs);
 
 noam_op_expression* noam_op_expression_create(noam_expression* lhs, noam_buffer* op, noam_expression* rhs);
 void noam_op_expression_release(noam_op_expression* expression);
-noam_value* noam_op_expression_get(noam_op_expression* expression);
+noam_value* noam_op_expression_get(noam_op_expression* expression, noam_vm* vm);
 
-noam_value* noam_statements_run(noam_buffer* statements);
+noam_value* noam_statements_run(noam_buffer* statements, noam_vm* vm);
 
 #endif //NOAM_EXPRESSION_H
@@ -0,0 +1,73 @@
+#ifndef NOAM_IMAGE_H
+#define NOAM_IMAGE_H
+
+#include "noam_vm.h"
+
+#define NOAM_IMAGE_MAGIC "noamimg"
+#define NOAM_IMAGE_VERSION 3
+
+/* noam_image_header struct: start of an image file
+ *
+ * magic: NOAM_IMAGE_MAGIC with the terminating zero
+ * version: NOAM_IMAGE_VERSION of the layout
+ * word: sizeof(size_t) of the process which saved the image, ints and floats are stored in its byte order
+ * strings: number of entries of the string table following the header
+ * */
+typedef struct {
+    char   magic[8];
+    size_t version;
+    size_t word;
+    size_t strings;
+} noam_image_header;
+
+/* noam_image_writer struct: state of a save
+ *
+ * data: bytes of the functions, globals and values
+ * strings: bytes of the string table
+ * names: a mapping from a name to its index in the string table, names are stored once
+ * values: a mapping from a noam_value* to its index, a value referred to twice is stored once
+ * */
+typedef struct {
+    noam_vm*     vm;
+    noam_buffer* data;
+    noam_buffer* strings;
+    noam_dict*   names;
+    noam_dict*   values;
+} noam_image_writer;
+
+/* noam_image_reader struct: state of a load
+ *
+ * data, length, offset: the mapped file and the read position
+ * strings: names of the string table as noam_buffer*, shared by the nodes like the names of tokens
+ * values: noam_value* by their index
+ * scope: a scope for the create functions which resolve names, the saved slots replace what they resolve
+ * slots: slots of the function being read, its local slots are checked against them
+ * globals: one past the highest global slot used by the functions, checked once the global slots are read
+ * */
+typedef struct {
+    noam_vm*     vm;
+    const char*  data;
+    size_t       length;
+    size_t       offset;
+    noam_buffer* strings;
+    noam_buffer* values;
+    noam_scope*  scope;
+    size_t       slots;
+    size_t       globals;
+} noam_image_reader;
+
+/* noam_image_save: writes the functions, the global variables and their values of a vm to a file
+ *
+ * the top-level statements are not saved, the state they computed is,
+ * coroutines cannot be saved, host functions are saved by name, imported modules by their paths
+ * */
+noam_status noam_image_save(noam_vm* vm, const char* path);
+
+/* noam_image_load: maps an image into a new vm, which starts from the saved state without parsing
+ *
+ * host functions used by the image must be registered before, scripts may be loaded afterwards,
+ * a vm which failed to load an image holds a part of it and is only good to be destroyed
+ * */
+noam_status noam_image_load(noam_vm* vm, const char* path);
+
+#endif //NOAM_IMAGE_H
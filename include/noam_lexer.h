@@ -12,17 +12,33 @@
 #define NOAM_TRUE_STR "true"
 #define NOAM_FALSE_STR "false"
 #define NOAM_RETURN_STR "return"
+#define NOAM_FOR_STR "for"
+#define NOAM_IN_STR "in"
+#define NOAM_WHILE_STR "while"
+#define NOAM_YIELD_STR "yield"
+#define NOAM_IMPORT_STR "import"
 #define NOAM_EQ_STR "="
 #define NOAM_PLUS_STR "+"
 #define NOAM_MINUS_STR "-"
 #define NOAM_MULT_STR "*"
 #define NOAM_DIV_STR "/"
+#define NOAM_PLUS_EQ_STR "+="
+#define NOAM_MINUS_EQ_STR "-="
+#define NOAM_MULT_EQ_STR "*="
+#define NOAM_DIV_EQ_STR "/="
 #define NOAM_LESS_STR "<"
 #define NOAM_GREATER_STR ">"
+#define NOAM_LEQ_STR "<="
+#define NOAM_GEQ_STR ">="
 #define NOAM_LP_STR "("
 #define NOAM_RP_STR ")"
 #define NOAM_LB_STR "{"
 #define NOAM_RB_STR "}"
+#define NOAM_LS_STR "["
+#define NOAM_RS_STR "]"
+#define NOAM_DOT_STR "."
+#define NOAM_COLON_STR ":"
+#define NOAM_RANGE_STR ".."
 #define NOAM_EQ2_STR "=="
 #define NOAM_NEQ_STR "!="
 #define NOAM_COMMA_STR ","
@@ -50,13 +66,26 @@ typedef enum {
     NOAM_LINE_TOKEN,
     NOAM_EQ_TOKEN,
     NOAM_OP_TOKEN,
+    NOAM_OP_EQ_TOKEN,
     NOAM_LP_TOKEN,
     NOAM_RP_TOKEN,
     NOAM_LB_TOKEN,
     NOAM_RB_TOKEN,
     NOAM_COMMA_TOKEN,
     NOAM_NIL_TOKEN,
-    NOAM_EOF_TOKEN
+    NOAM_LS_TOKEN,
+    NOAM_RS_TOKEN,
+    NOAM_DOT_TOKEN,
+    NOAM_COLON_TOKEN,
+    NOAM_RANGE_TOKEN,
+    NOAM_EOF_TOKEN,
+
+    /* value types without a literal token of their own */
+    NOAM_ARRAY_TOKEN,
+    NOAM_VEC_TOKEN,
+    NOAM_MAT_TOKEN,
+    NOAM_MAP_TOKEN,
+    NOAM_COROUTINE_TOKEN
 } noam_token;
 
 /* noam_prefix_node struct: a prefix tree node for parsing keywords
@@ -76,15 +105,25 @@ typedef struct noam_prefix_node {
 /* noam_token_info struct: describes information corresponding to token
  *
  * name: string representation
- * token: token type */
+ * token: token type
+ * line: source line the token starts on, counted from 1 */
 typedef struct {
     noam_buffer* name;
     noam_token   token;
+    size_t       line;
 } noam_token_info;
 
-noam_token_info* noam_token_info_create(noam_buffer* name, noam_token token);
+/* noam_token_to_string: name of a token for traces */
+const char* noam_token_to_string(noam_token token);
+
+/* noam_token_push: appends a token with a copy of `name` */
+void noam_token_push(noam_buffer* tokens, noam_buffer* name, noam_token token, size_t line);
 void noam_token_info_release(noam_token_info* info);
 
+/* noam_tokens_release: releases the tokens once they are parsed,
+ * names of words and operators are kept since the parsed code refers to them */
+void noam_tokens_release(noam_buffer* tokens);
+
 
 noam_prefix_node* noam_prefix_node_create(char character);
 noam_prefix_node* noam_prefix_node_add_child(noam_prefix_node* parent, char character);
@@ -94,9 +133,15 @@ void noam_prefix_tree_insert(noam_prefix_node* root, const char* keyword, noam_t
 int noam_prefix_tree_contains(noam_prefix_node* root, noam_buffer* keyword);
 noam_token noam_prefix_tree_find(noam_prefix_node* root, noam_buffer* keyword);
 noam_prefix_node* noam_prefix_tree_build(const char** keywords, const noam_token* tokens, size_t length);
+/* noam_tokens_tree: the tree of keywords and operators, built once and shared by every vm */
 noam_prefix_node* noam_tokens_tree();
 
 void noam_state_reset(noam_buffer* token_name, noam_state* state);
+/* noam_parse_tokens: splits the source into noam_token_infos, returns NULL on an unknown token */
 noam_buffer* noam_parse_tokens(const char* source);
 
+/* noam_source_complete: returns 0 if the source ends inside a string or with unclosed brackets,
+ * so an interactive session waits for more lines */
+int noam_source_complete(const char* source);
+
 #endif //NOAM_LEXER_H
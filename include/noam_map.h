@@ -0,0 +1,61 @@
+#ifndef NOAM_MAP_H
+#define NOAM_MAP_H
+
+#include "noam_expression.h"
+
+/* noam_map_value struct: an associative container
+ *
+ * dict: a mapping from noam_value* to noam_value*, keys are hashed by their type and value,
+ * keys are copied on insertion, string keys cache their hash
+ * repr: string representation built on demand
+ * frozen: set while pmap workers may read the map, changing or printing it is an error then */
+typedef struct {
+    noam_value_vtable_* vtable_;
+    noam_dict*          dict;
+    noam_buffer*        repr;
+    int                 frozen;
+} noam_map_value;
+
+/* noam_map_expression struct: a map literal
+ *
+ * keys, values: noam_expressions evaluated into a new map each time */
+typedef struct {
+    noam_expression_vtable_* vtable_;
+    noam_buffer*             keys;
+    noam_buffer*             values;
+} noam_map_expression;
+
+/* noam_hash_value, noam_cmp_value: hash and comparator for noam_value* keys,
+ * containers are compared by identity */
+size_t noam_hash_value(noam_value* const* key);
+int noam_cmp_value(noam_value* const* lhs, noam_value* const* rhs);
+
+/* noam_string_value_hash: caches the hash of a string before other vms may read it, string literals are hashed when parsed */
+void noam_string_value_hash(noam_string_value* str);
+
+noam_map_value* noam_map_value_create();
+
+/* noam_map_value_write: raises an error if the map is frozen, called before changing it */
+void noam_map_value_write(noam_map_value* value, noam_vm* vm);
+const char* noam_map_value_to_string(noam_map_value* value, noam_vm* vm);
+void noam_map_value_release(noam_map_value* value);
+noam_value* noam_map_value_get(noam_map_value* value, noam_vm* vm);
+
+/* noam_map_get: returns a value by the key, NULL if it's absent */
+noam_value* noam_map_get(noam_map_value* map, noam_value* key, noam_vm* vm);
+void noam_map_set(noam_map_value* map, noam_value* key, noam_value* value);
+
+noam_map_expression* noam_map_expression_create(noam_buffer* keys, noam_buffer* values);
+noam_value* noam_map_expression_get(noam_map_expression* expression, noam_vm* vm);
+void noam_map_expression_release(noam_map_expression* expression);
+
+/* map built-ins
+ *
+ * has(m, k): checks if the key is present
+ * remove(m, k): removes the key, returns false if it was absent
+ * m[k] returns nil for absent keys, m[k] = v inserts or overwrites, len(m) counts pairs
+ * */
+noam_value* noam_builtin_has(noam_vm* vm, noam_value** args, size_t argc);
+noam_value* noam_builtin_remove(noam_vm* vm, noam_value** args, size_t argc);
+
+#endif //NOAM_MAP_H
@@ -0,0 +1,78 @@
+#ifndef NOAM_MATH_H
+#define NOAM_MATH_H
+
+#include "noam_expression.h"
+
+#define NOAM_VEC_MAX_SIZE 4
+#define NOAM_MAT_SIZE 16
+
+/* noam_vec_value struct: vec2, vec3 or vec4 stored unboxed
+ *
+ * size: number of components
+ * v: components, unused ones are kept zero so every vector is processed as a vec4 */
+typedef struct {
+    noam_value_vtable_* vtable_;
+    size_t              size;
+    float               v[NOAM_VEC_MAX_SIZE];
+} noam_vec_value;
+
+/* noam_mat_value struct: mat4 stored unboxed in column-major order */
+typedef struct {
+    noam_value_vtable_* vtable_;
+    float               m[NOAM_MAT_SIZE];
+} noam_mat_value;
+
+/* noam_component_expression struct: access to a vector component by name
+ *
+ * target: an expression evaluated to a vector
+ * component: index of x, y, z or w resolved at parse time */
+typedef struct {
+    noam_expression_vtable_* vtable_;
+    noam_expression*         target;
+    size_t                   component;
+} noam_component_expression;
+
+noam_vec_value* noam_vec_value_create(size_t size, const float* v);
+const char* noam_vec_value_to_string(noam_vec_value* value, noam_vm* vm);
+noam_value* noam_vec_value_get(noam_vec_value* value, noam_vm* vm);
+
+noam_mat_value* noam_mat_value_create(const float* m);
+const char* noam_mat_value_to_string(noam_mat_value* value, noam_vm* vm);
+noam_value* noam_mat_value_get(noam_mat_value* value, noam_vm* vm);
+
+/* noam_component_index: maps a component name to its index, returns -1 for unknown names */
+int noam_component_index(const noam_buffer* name);
+
+noam_component_expression* noam_component_expression_create(noam_expression* target, size_t component);
+noam_value* noam_component_expression_get(noam_component_expression* expression, noam_vm* vm);
+void noam_component_expression_release(noam_component_expression* expression);
+
+/* noam_math_is_instance: checks if a value is a vector or a matrix */
+int noam_math_is_instance(const noam_value* value);
+
+/* noam_math_op: evaluates +, -, *, / when one of the operands is a vector or a matrix */
+noam_value* noam_math_op(noam_vm* vm, const char* op, noam_value* lhs, noam_value* rhs);
+
+/* noam_math_index: v[i] returns a component, m[i] returns a column as a vec4 */
+noam_value* noam_math_index(noam_vm* vm, noam_value* target, int index);
+
+/* vector and matrix built-ins
+ *
+ * vec2(x, y), vec3(x, y, z), vec4(x, y, z, w): construct a vector
+ * mat4(d): a diagonal matrix, mat4(1) is the identity
+ * translation(x, y, z): a translation matrix
+ * length(v), normalize(v), cross(a, b), transpose(m)
+ * dot(a, b) of vectors is dispatched here from the array built-in
+ * */
+noam_value* noam_builtin_vec2(noam_vm* vm, noam_value** args, size_t argc);
+noam_value* noam_builtin_vec3(noam_vm* vm, noam_value** args, size_t argc);
+noam_value* noam_builtin_vec4(noam_vm* vm, noam_value** args, size_t argc);
+noam_value* noam_builtin_mat4(noam_vm* vm, noam_value** args, size_t argc);
+noam_value* noam_builtin_translation(noam_vm* vm, noam_value** args, size_t argc);
+noam_value* noam_builtin_length(noam_vm* vm, noam_value** args, size_t argc);
+noam_value* noam_builtin_normalize(noam_vm* vm, noam_value** args, size_t argc);
+noam_value* noam_builtin_cross(noam_vm* vm, noam_value** args, size_t argc);
+noam_value* noam_builtin_transpose(noam_vm* vm, noam_value** args, size_t argc);
+noam_value* noam_math_dot(noam_vm* vm, noam_value* lhs, noam_value* rhs);
+
+#endif //NOAM_MATH_H
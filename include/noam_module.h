@@ -0,0 +1,95 @@
+#ifndef NOAM_MODULE_H
+#define NOAM_MODULE_H
+
+#include <pthread.h>
+
+#include "noam_parser.h"
+
+/* states of a module, a module is lexed on a worker thread and parsed on the loading one */
+typedef enum {
+    NOAM_MODULE_NEW,
+    NOAM_MODULE_LEXING,
+    NOAM_MODULE_LEXED,
+    NOAM_MODULE_PARSING,
+    NOAM_MODULE_PARSED
+} noam_module_state;
+
+/* noam_module struct: a script loaded by `import "path"`
+ *
+ * name: the namespace of the module, the file name without the extension
+ * path: the resolved path of the file
+ * prefix: `name.`, functions and globals of the module are defined under their names with it
+ * funcs: names of the functions the module defines, its calls of them stay in the module
+ * names: a mapping from a name to its qualified noam_buffer*, each name is qualified once
+ * imports: resolved paths of the modules it imports as char*, found while lexing
+ * deps: the imported noam_module*, in the order of the imports
+ * tokens: the lexed file until the module is parsed
+ * state: progress of the load, a module of a failed load is new again
+ * error: set if the file cannot be read or lexed
+ *
+ * modules are kept by the symbol table, so a module imported by several scripts is parsed and run once
+ * and vms sharing the code share it
+ * */
+typedef struct noam_module {
+    noam_buffer*      name;
+    char*             path;
+    noam_buffer*      prefix;
+    noam_dict*        funcs;
+    noam_dict*        names;
+    noam_buffer*      imports;
+    noam_buffer*      deps;
+    noam_buffer*      tokens;
+    noam_module_state state;
+    char              error[NOAM_VM_ERROR_LENGTH];
+} noam_module;
+
+/* noam_module_batch struct: modules lexed by the threads of noam_module_lex
+ *
+ * modules: the noam_module* to lex
+ * next: index of the next module to take, guarded by `lock`
+ * */
+typedef struct {
+    noam_buffer*    modules;
+    size_t          next;
+    pthread_mutex_t lock;
+} noam_module_batch;
+
+/* noam_module_create: a module of the file at the resolved `path` */
+noam_module* noam_module_create(const char* path);
+void noam_module_release(noam_module* module);
+
+/* noam_module_find: the module loaded under the namespace `name`, NULL if there is none */
+noam_module* noam_module_find(noam_symbol_table* symbol_table, const noam_buffer* name);
+
+/* noam_module_at: the module of the file at the resolved `path`, NULL if it is not imported */
+noam_module* noam_module_at(noam_symbol_table* symbol_table, const char* path);
+
+/* noam_module_qualify: `name` in the namespace of the module */
+noam_buffer* noam_module_qualify(noam_module* module, noam_buffer* name);
+
+/* noam_module_resolve: the absolute path of an import relative to the directory of `importer`,
+ * to the working directory if `importer` is NULL, returns NULL if there is no such file */
+char* noam_module_resolve(const char* importer, const char* path);
+
+/* noam_module_scan: collects the imports and the function names of the top level of `tokens`,
+ * either may be NULL, returns 0 and fills `error` if an import cannot be resolved */
+int noam_module_scan(noam_buffer* tokens, const char* path, noam_buffer* imports, noam_dict* funcs, char* error);
+
+/* noam_module_read: reads a file into a C string ending with a space like noam_vm_load_file does,
+ * returns NULL if the file cannot be read */
+char* noam_module_read(const char* path);
+
+/* noam_module_lex: reads and lexes the modules in parallel, a thread per online CPU at most */
+void noam_module_lex(noam_buffer* modules);
+
+/* noam_module_parse: parses a module after the modules it imports,
+ * the top-level statements of each parsed module are queued to `main` */
+void noam_module_parse(noam_vm* vm, noam_module* module);
+
+/* noam_module_import: loads the modules imported by the lexed script at `path` and by the modules they import,
+ * each module graph level is lexed in parallel, the modules are then parsed dependencies first,
+ * a module loaded before is reused, `path` is NULL for a script which is not a file
+ * */
+void noam_module_import(noam_vm* vm, noam_buffer* tokens, const char* path);
+
+#endif //NOAM_MODULE_H
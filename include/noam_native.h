@@ -0,0 +1,94 @@
+#ifndef NOAM_NATIVE_H
+#define NOAM_NATIVE_H
+
+#include "noam_expression.h"
+
+#define NOAM_NATIVE_MAX_ARGS 8
+
+/* noam_native_func: a host function with the generic signature
+ *
+ * args: already evaluated arguments
+ * data: user data passed on registration
+ * the function must return a value, noam_nil_value_create() if it has nothing to return,
+ * noam_vm_error aborts the script with an error
+ * */
+typedef noam_value*(*noam_native_func)(noam_vm* vm, noam_value** args, size_t argc, void* data);
+
+/* fast-call signatures, arguments and results are passed unboxed */
+typedef float(*noam_native_f_f)(float);
+typedef float(*noam_native_f_ff)(float, float);
+typedef float(*noam_native_f_fff)(float, float, float);
+typedef int(*noam_native_i_i)(int);
+typedef int(*noam_native_i_ii)(int, int);
+
+/* noam_native_signature enum: calling convention of a host function */
+typedef enum {
+    NOAM_NATIVE_GENERIC,
+    NOAM_NATIVE_F_F,
+    NOAM_NATIVE_F_FF,
+    NOAM_NATIVE_F_FFF,
+    NOAM_NATIVE_I_I,
+    NOAM_NATIVE_I_II
+} noam_native_signature;
+
+/* noam_native struct: a host function registered in the symbol table
+ *
+ * signature: selects a member of `func`
+ * arity: number of arguments checked at parse time
+ * data: user data of the generic signature
+ * */
+typedef struct noam_native {
+    noam_native_signature signature;
+    size_t                arity;
+    union {
+        noam_native_func  generic;
+        noam_native_f_f   f_f;
+        noam_native_f_ff  f_ff;
+        noam_native_f_fff f_fff;
+        noam_native_i_i   i_i;
+        noam_native_i_ii  i_ii;
+    } func;
+    void*                 data;
+} noam_native;
+
+/* noam_native_call_expression struct: call of a host function resolved at parse time
+ *
+ * native: the registered function
+ * args: arguments passed to function as noam_expressions array
+ * */
+typedef struct {
+    noam_expression_vtable_* vtable_;
+    const noam_native*       native;
+    noam_buffer*             args;
+} noam_native_call_expression;
+
+/* noam_native_register: registers a host function with the generic signature,
+ * registering a name again replaces the function for scripts parsed afterwards,
+ * returns NOAM_RUNTIME_ERROR with the message in the vm if `arity` exceeds NOAM_NATIVE_MAX_ARGS */
+noam_status noam_native_register(noam_vm* vm, const char* name, size_t arity,
+                                 noam_native_func func, void* data);
+
+/* noam_native_register_*: registers a host function with a fast-call signature,
+ * int arguments are converted for float parameters */
+noam_status noam_native_register_f_f(noam_vm* vm, const char* name, noam_native_f_f func);
+noam_status noam_native_register_f_ff(noam_vm* vm, const char* name, noam_native_f_ff func);
+noam_status noam_native_register_f_fff(noam_vm* vm, const char* name, noam_native_f_fff func);
+noam_status noam_native_register_i_i(noam_vm* vm, const char* name, noam_native_i_i func);
+noam_status noam_native_register_i_ii(noam_vm* vm, const char* name, noam_native_i_ii func);
+
+/* noam_native_register_math: sqrt, sin, cos, tan, floor, abs, pow and atan2 from libm */
+noam_status noam_native_register_math(noam_vm* vm);
+
+/* noam_native_find: returns a host function by its name or NULL */
+const noam_native* noam_native_find(noam_symbol_table* symbol_table, noam_buffer* name);
+
+noam_native_call_expression* noam_native_call_expression_create(const noam_native* native, noam_buffer* args);
+noam_value* noam_native_call_expression_get(noam_native_call_expression* expression, noam_vm* vm);
+void noam_native_call_expression_release(noam_native_call_expression* expression);
+
+/* noam_native_float, noam_native_int: evaluate an argument unboxed,
+ * a nested fast call with the matching result type doesn't create a noam_value at all */
+float noam_native_float(noam_expression* expression, noam_vm* vm);
+int noam_native_int(noam_expression* expression, noam_vm* vm);
+
+#endif //NOAM_NATIVE_H
@@ -2,14 +2,32 @@
 #define NOAM_PARSER_H
 
 #include "noam_statement.h"
+#include "noam_builtin.h"
+#include "noam_math.h"
+#include "noam_map.h"
+#include "noam_native.h"
+#include "noam_coroutine.h"
 
 /* noam_parser struct: iterates over tokens and preserves the state of parsing
  *
  * tokens: array of noam_token_info
- * index: position of the currently parsing token */
+ * index: position of the currently parsing token
+ * vm: receives syntax errors
+ * yields: set once a yield statement is parsed in the current function
+ * module: the module being parsed, NULL for a script
+ * reload: new definitions of the functions of a reloaded file, defined once the whole file is parsed,
+ *         NULL for a load
+ * funcs: names of the functions the parsed script defines, so calls before a definition don't go to a built-in
+ *        or a host function of the same name, NULL outside of noam_parse_statements and for modules,
+ *        whose calls are qualified instead */
 typedef struct {
-    noam_buffer* tokens;
-    size_t       index;
+    noam_buffer*        tokens;
+    size_t              index;
+    noam_vm*            vm;
+    int                 yields;
+    struct noam_module* module;
+    noam_buffer*        reload;
+    noam_dict*          funcs;
 } noam_parser;
 
 noam_token_info* noam_get_token_info(noam_parser* parser, int offset);
@@ -18,16 +36,76 @@ int noam_match_tokens(noam_parser* parser, noam_token first_token, noam_token se
 int noam_match_token_str(noam_parser* parser, const char* name);
 noam_token_info* noam_consume_token(noam_parser* parser, noam_token token);
 noam_token_info* noam_consume_token_str(noam_parser* parser, const char* name);
+noam_buffer* noam_parse_list(noam_parser* parser, noam_symbol_table* symbol_table, noam_scope* current_scope,
+                             noam_token end_token);
 noam_buffer* noam_parse_func_args(noam_parser* parser, noam_symbol_table* symbol_table, noam_scope* current_scope);
+noam_expression* noam_parse_builtin_call(noam_parser* parser, noam_symbol_table* symbol_table, noam_scope* current_scope,
+                                         const noam_builtin* builtin);
+noam_expression* noam_parse_native_call(noam_parser* parser, noam_symbol_table* symbol_table, noam_scope* current_scope,
+                                        const noam_native* native);
+/* noam_parse_name: the name a variable is known by in the parsed code,
+ * the globals of a module are in its namespace, while the locals of its functions keep their names */
+noam_buffer* noam_parse_name(noam_parser* parser, noam_scope* scope, noam_buffer* name);
+
+/* noam_parse_call_name: the name of a called function, the module functions called from the module are qualified */
+noam_buffer* noam_parse_call_name(noam_parser* parser, noam_buffer* name);
+noam_expression* noam_parse_map(noam_parser* parser, noam_symbol_table* symbol_table, noam_scope* current_scope);
+noam_expression* noam_parse_primary(noam_parser* parser, noam_symbol_table* symbol_table, noam_scope* current_scope);
 noam_expression* noam_parse_atomic(noam_parser* parser, noam_symbol_table* symbol_table, noam_scope* current_scope);
+/* noam_op_precedence: binding power of a binary operator, * and / bind tighter than + and -,
+ * then go comparisons, == and != */
+int noam_op_precedence(const noam_buffer* op);
+
+/* noam_parse_binary: parses operators of at least `precedence` by precedence climbing */
+noam_expression* noam_parse_binary(noam_parser* parser, noam_symbol_table* symbol_table, noam_scope* current_scope,
+                                   int precedence);
 noam_expression* noam_parse_op(noam_parser* parser, noam_symbol_table* symbol_table, noam_scope* current_scope);
 noam_expression* noam_parse_expression(noam_parser* parser, noam_symbol_table* symbol_table, noam_scope* current_scope);
 noam_cond_statement* noam_parse_cond(noam_parser* parser, noam_symbol_table* symbol_table, noam_scope* scope);
+/* noam_parser_mentions: returns 1 if the tokens from `begin` up to the current one have the word `name` */
+int noam_parser_mentions(noam_parser* parser, size_t begin, const noam_buffer* name);
+
+/* noam_parser_escapes: returns 1 if a mention of `name` in the tokens from `begin` up to the current one
+ * may keep a reference to its value, any use but an operand, an index, a range limit or a print */
+int noam_parser_escapes(noam_parser* parser, size_t begin, const noam_buffer* name);
+
+/* noam_parse_range: parses the rest of `for key in from..to { }` after the `..` */
+noam_range_statement* noam_parse_range(noam_parser* parser, noam_symbol_table* symbol_table, noam_scope* scope,
+                                       noam_token_info* key, noam_expression* from);
+
+/* noam_parse_for: parses a loop over an iterable or a range */
+noam_statement* noam_parse_for(noam_parser* parser, noam_symbol_table* symbol_table, noam_scope* scope);
+noam_while_statement* noam_parse_while(noam_parser* parser, noam_symbol_table* symbol_table, noam_scope* scope);
+/* noam_parse_push: appends a statement starting on `line` to a block */
+void noam_parse_push(noam_buffer* statements, noam_statement* statement, size_t line);
 noam_buffer* noam_parse_block(noam_parser* parser, noam_symbol_table* symbol_table, noam_scope* current_scope);
+/* noam_parse_unexpected: reports a token no statement starts with, called when a block consumes nothing */
+void noam_parse_unexpected(noam_parser* parser);
+void noam_parse_body(noam_parser* parser, noam_symbol_table* symbol_table, noam_scope* scope, noam_func* func);
+int noam_parse_keyword(const noam_buffer* name);
+
+/* noam_parse_skip: takes the tokens of a function body up to the matching } for noam_func_compile,
+ * the globals the body may read are declared now, so the global frame doesn't grow once the script runs */
+void noam_parse_skip(noam_parser* parser, noam_symbol_table* symbol_table, noam_scope* scope, noam_func* func);
+
+/* noam_func_compile: parses the body of a function skipped by a lazy vm, called before its first call */
+void noam_func_compile(noam_func* func, noam_vm* vm);
+
+/* noam_parse_pending: parses every body left for its first call */
+void noam_parse_pending(noam_vm* vm);
+/* noam_parse_hash: hashes the tokens of a function definition from its name at `begin` to its closing },
+ * `end` is set past the } */
+size_t noam_parse_hash(noam_parser* parser, size_t begin, size_t* end);
+
+/* noam_parse_define: adds a function to the symbol table or redefines the one with its name */
+void noam_parse_define(noam_symbol_table* symbol_table, noam_func* func);
+
+/* noam_parse_skip_statements: passes the top-level statements up to the next function definition */
+void noam_parse_skip_statements(noam_parser* parser);
 void noam_parse_func(noam_parser* parser, noam_symbol_table* symbol_table, noam_scope** scope);
 noam_buffer* noam_parse_statements(noam_parser* parser, noam_symbol_table* symbol_table);
 
-void noam_parser_init(noam_parser* parser, const char* source);
+void noam_parser_init(noam_parser* parser, noam_vm* vm, const char* source);
 int noam_parser_end(noam_parser* parser);
 
 #endif //NOAM_PARSER_H
@@ -0,0 +1,89 @@
+#ifndef NOAM_POOL_H
+#define NOAM_POOL_H
+
+#include <pthread.h>
+
+#include "noam_expression.h"
+
+struct noam_pool;
+
+/* noam_pool_job struct: a function mapped over an array
+ *
+ * func: called as func(element) or func(index, element)
+ * array: the mapped array
+ * results: a value per element
+ * globals, globals_length: a snapshot of the globals of the calling vm
+ * failed, error: the first error of the workers, guarded by the pool lock
+ * */
+typedef struct {
+    noam_func*        func;
+    noam_array_value* array;
+    noam_value**      results;
+    noam_value**      globals;
+    size_t            globals_length;
+    int               failed;
+    char              error[NOAM_VM_ERROR_LENGTH];
+} noam_pool_job;
+
+/* noam_pool_worker struct: a thread of the pool with its own execution state
+ *
+ * lock: guards the range, taken by the worker itself and by thieves
+ * begin, end: indices of the elements left to the worker
+ * vm: shares the code of the pool owner, has its own stack and globals
+ * pool: the pool of the worker
+ * thread: not started for the worker 0, the thread calling pmap
+ * */
+typedef struct {
+    pthread_mutex_t   lock;
+    size_t            begin;
+    size_t            end;
+    noam_vm*          vm;
+    struct noam_pool* pool;
+    pthread_t         thread;
+} noam_pool_worker;
+
+/* noam_pool struct: a work-stealing thread pool sized to the machine
+ *
+ * workers, length: worker 0 runs on the calling thread
+ * lock, start, finish: wake the workers for a job and wait for the last one
+ * generation: number of jobs started, a worker runs a job once it sees a new generation
+ * active: number of the threads still running the job
+ * quit: set to stop the threads
+ * job: the running job
+ * running: set while noam_pool_run runs a job, a pmap called by a mapped function on the calling thread maps serially
+ *
+ * a worker takes chunks from the front of its range, a quarter of what is left each time,
+ * so chunks get smaller towards the end, once the range is empty it steals the back half
+ * of the range of another worker
+ * */
+typedef struct noam_pool {
+    noam_pool_worker* workers;
+    size_t            length;
+    pthread_mutex_t   lock;
+    pthread_cond_t    start;
+    pthread_cond_t    finish;
+    size_t            generation;
+    size_t            active;
+    int               quit;
+    noam_pool_job*    job;
+    int               running;
+} noam_pool;
+
+/* noam_pool_create: starts a worker per online CPU, `vm` is shared with the workers */
+noam_pool* noam_pool_create(noam_vm* vm);
+void noam_pool_destroy(noam_pool* pool);
+
+/* noam_pool_run: runs a job on all the workers and returns once every element is mapped */
+void noam_pool_run(noam_pool* pool, noam_vm* vm, noam_pool_job* job);
+
+/* pmap(name, a): maps the script function `name` over the int or float array `a` in parallel
+ *
+ * the function gets an element, or an index and an element if it has two params,
+ * and returns an int or a float, the result is a new array,
+ * workers see the globals as they are on the call, their assignments are not visible to the caller,
+ * the maps and arrays reachable from the globals and `a` are frozen while the workers run,
+ * changing or printing them inside the function is an error
+ * */
+noam_value* noam_builtin_pmap(noam_vm* vm, noam_value** args, size_t argc);
+
+#endif //NOAM_POOL_H
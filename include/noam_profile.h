@@ -0,0 +1,61 @@
+#ifndef NOAM_PROFILE_H
+#define NOAM_PROFILE_H
+
+#include "noam_vm.h"
+
+#define NOAM_PROFILE_HZ 1000
+#define NOAM_PROFILE_STACKS 16384
+#define NOAM_PROFILE_SITES 262144
+
+/* noam_profile_stack struct: a distinct call stack seen by the profiler
+ *
+ * hash: hash of the call sites
+ * count: number of samples of the stack
+ * offset, length: call sites of the stack in the sites arena, outermost first
+ * */
+typedef struct {
+    size_t hash;
+    size_t count;
+    size_t offset;
+    size_t length;
+} noam_profile_stack;
+
+/* noam_profile struct: state of the sampling profiler, there is one per process since the timer is
+ *
+ * vm: the sampled vm
+ * hz: samples a second of CPU time
+ * stacks: open addressing table of NOAM_PROFILE_STACKS distinct stacks, empty ones have zero `count`
+ * sites, used: arena of NOAM_PROFILE_SITES call sites of the distinct stacks
+ * samples: number of samples taken
+ * dropped: samples lost because the table or the arena was full
+ *
+ * the SIGPROF handler copies the shadow stack of the vm and counts it in the table,
+ * it doesn't allocate, so the profiler may stay on for long runs
+ * */
+typedef struct {
+    noam_vm*            vm;
+    unsigned            hz;
+    noam_profile_stack* stacks;
+    noam_call_site*     sites;
+    size_t              used;
+    size_t              samples;
+    size_t              dropped;
+} noam_profile;
+
+/* noam_profile_start: samples the calls of `vm` `hz` times a second of CPU time, returns 0 on failure */
+int noam_profile_start(noam_vm* vm, unsigned hz);
+
+/* noam_profile_stop: stops sampling, the samples are kept for the report */
+void noam_profile_stop();
+
+/* noam_profile_report: writes the samples as folded stacks for flamegraph tools to `folded`
+ * and tables of self and total time per function and of self time per line to `table`, both may be NULL
+ *
+ * frames are named `function:line`, the top-level code is `main`
+ * */
+void noam_profile_report(FILE* folded, FILE* table);
+
+/* noam_profile_release: stops sampling and drops the samples */
+void noam_profile_release();
+
+#endif //NOAM_PROFILE_H
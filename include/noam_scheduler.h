@@ -0,0 +1,98 @@
+#ifndef NOAM_SCHEDULER_H
+#define NOAM_SCHEDULER_H
+
+#include <stdint.h>
+
+#include "noam_coroutine.h"
+
+#define NOAM_TASK_PRIORITIES 32
+
+/* noam_task_state enum: where a task is in its life */
+typedef enum {
+    NOAM_TASK_READY,
+    NOAM_TASK_DONE,
+    NOAM_TASK_FAILED
+} noam_task_state;
+
+/* noam_task struct: a coroutine run by a scheduler
+ *
+ * coroutine: the script code of the task
+ * priority: 0 is the highest, tasks of the same priority run round-robin
+ * state: set to done or failed before the finish callback
+ * cpu_ns, resumes: cpu time of the thread spent in the task and the number of its resumes
+ * tick: the last tick the task ran in
+ * data: host data, e.g. the entity running the script
+ * prev, next: neighbours in the ready queue of the priority
+ * */
+typedef struct noam_task {
+    noam_coroutine_value* coroutine;
+    unsigned              priority;
+    noam_task_state       state;
+    uint64_t              cpu_ns;
+    size_t                resumes;
+    size_t                tick;
+    void*                 data;
+    struct noam_task*     prev;
+    struct noam_task*     next;
+} noam_task;
+
+struct noam_scheduler;
+
+/* noam_task_finish_func: called once a task returns or fails, the error is in the vm then,
+ * the task is released right after the call */
+typedef void(*noam_task_finish_func)(struct noam_scheduler* scheduler, noam_task* task, noam_status status);
+
+/* noam_scheduler struct: cooperative scheduler of script tasks
+ *
+ * vm: runs the tasks
+ * heads, tails: a ready queue per priority
+ * ready: bit i is set when the queue of priority i isn't empty
+ * length: number of tasks
+ * tick: number of ticks run
+ * cpu_ns: cpu time spent in tasks by the last tick
+ * finish: optional callback of finished tasks
+ *
+ * a scheduling decision finds the highest priority queue with a bit scan and pops its head,
+ * so its cost doesn't depend on the number of tasks
+ * */
+typedef struct noam_scheduler {
+    noam_vm*              vm;
+    noam_task*            heads[NOAM_TASK_PRIORITIES];
+    noam_task*            tails[NOAM_TASK_PRIORITIES];
+    uint32_t              ready;
+    size_t                length;
+    size_t                tick;
+    uint64_t              cpu_ns;
+    noam_task_finish_func finish;
+} noam_scheduler;
+
+noam_scheduler* noam_scheduler_create(noam_vm* vm);
+void noam_scheduler_destroy(noam_scheduler* scheduler);
+
+/* noam_scheduler_add: schedules a coroutine, priorities past the lowest one are clamped */
+noam_task* noam_scheduler_add(noam_scheduler* scheduler, noam_coroutine_value* coroutine, unsigned priority);
+
+/* noam_scheduler_spawn: calls a script function with yield statements and schedules the coroutine,
+ * returns NULL and leaves the error in the vm if the call fails */
+noam_task* noam_scheduler_spawn(noam_scheduler* scheduler, const char* name, noam_value** args, size_t argc,
+                                unsigned priority);
+
+/* noam_scheduler_cancel: removes a task without running it again and releases it */
+void noam_scheduler_cancel(noam_scheduler* scheduler, noam_task* task);
+
+void noam_scheduler_set_priority(noam_scheduler* scheduler, noam_task* task, unsigned priority);
+
+/* noam_scheduler_tick: resumes ready tasks by priority until the budget runs out
+ *
+ * a task runs up to its next yield and at most once a tick, tasks left over run first on the next tick,
+ * returns the number of resumes
+ * */
+size_t noam_scheduler_tick(noam_scheduler* scheduler, uint64_t budget_ns);
+
+/* noam_scheduler_now: monotonic time in nanoseconds, the budget of a tick is measured with it */
+uint64_t noam_scheduler_now();
+
+/* noam_scheduler_cpu_now: cpu time of the calling thread in nanoseconds, the tasks are charged with it */
+uint64_t noam_scheduler_cpu_now();
+
+#endif //NOAM_SCHEDULER_H
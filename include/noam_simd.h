@@ -0,0 +1,49 @@
+#ifndef NOAM_SIMD_H
+#define NOAM_SIMD_H
+
+#include "noam_utility.h"
+
+/* bulk kernels over contiguous int and float arrays
+ *
+ * every kernel has an AVX or SSE path picked at compile time (see NOAM_NATIVE in CMakeLists.txt)
+ * and a scalar loop which handles the tail and targets without SIMD support
+ * */
+
+int noam_simd_sum_int(const int* data, size_t length);
+float noam_simd_sum_float(const float* data, size_t length);
+
+/* noam_simd_min_*, noam_simd_max_*: `length` must be positive */
+int noam_simd_min_int(const int* data, size_t length);
+float noam_simd_min_float(const float* data, size_t length);
+int noam_simd_max_int(const int* data, size_t length);
+float noam_simd_max_float(const float* data, size_t length);
+
+/* noam_simd_scale_*: multiplies each element by `factor` in place */
+void noam_simd_scale_int(int* data, size_t length, int factor);
+void noam_simd_scale_float(float* data, size_t length, float factor);
+
+/* noam_simd_add_*: adds `other` to `data` element-wise in place */
+void noam_simd_add_int(int* data, const int* other, size_t length);
+void noam_simd_add_float(float* data, const float* other, size_t length);
+
+int noam_simd_dot_int(const int* lhs, const int* rhs, size_t length);
+float noam_simd_dot_float(const float* lhs, const float* rhs, size_t length);
+
+void noam_simd_fill_int(int* data, size_t length, int value);
+void noam_simd_fill_float(float* data, size_t length, float value);
+
+/* noam_simd_sort_*: ascending LSD radix sort, stable and linear in `length` */
+void noam_simd_sort_int(int* data, size_t length);
+void noam_simd_sort_float(float* data, size_t length);
+
+/* vec4 and mat4 kernels, vectors are 4 floats, matrices are 16 floats in column-major order,
+ * every vector fits one SSE register */
+void noam_simd_vec4_add(float* out, const float* lhs, const float* rhs);
+void noam_simd_vec4_sub(float* out, const float* lhs, const float* rhs);
+void noam_simd_vec4_mul(float* out, const float* lhs, const float* rhs);
+void noam_simd_vec4_scale(float* out, const float* vec, float factor);
+float noam_simd_vec4_dot(const float* lhs, const float* rhs);
+void noam_simd_mat4_mul(float* out, const float* lhs, const float* rhs);
+void noam_simd_mat4_mul_vec4(float* out, const float* mat, const float* vec);
+
+#endif //NOAM_SIMD_H
@@ -6,20 +6,19 @@
 struct noam_statement;
 
 /* noam_statement_run_func: called when a statement is processed */
-typedef noam_value*(*noam_statement_run_func)(struct noam_statement*);
-
-/* noam_statement_is_returned: if a statement returns */
-typedef int*(*noam_statement_is_returned_func)(struct noam_statement*);
+typedef noam_value*(*noam_statement_run_func)(struct noam_statement*, noam_vm*);
 
 typedef struct {
-    noam_statement_run_func         run;
-    noam_statement_is_returned_func is_returned;
-    noam_release_func               release;
+    noam_statement_run_func run;
+    noam_release_func       release;
 } noam_statement_vtable_;
 
-/* noam_statement struct: a base for all runnable statements */
+/* noam_statement struct: a base for all runnable statements
+ *
+ * line: source line of the statement, set by the parser for profiles */
 typedef struct noam_statement {
     const noam_statement_vtable_* vtable_;
+    size_t                        line;
 } noam_statement;
 
 /* noam_print_statement struct: evaluates an expression and prints it to the stdout
@@ -27,6 +26,7 @@ typedef struct noam_statement {
  * expr: expression to be evaluated */
 typedef struct {
     noam_statement_vtable_* vtable_;
+    size_t                  line;
     struct noam_expression* expr;
 } noam_print_statement;
 
@@ -34,74 +34,192 @@ typedef struct {
  *
  * name: name of the variable
  * expr: right hand side expression
- * scope: scope for variable pushing
+ * slot, global: slot of the variable declared in the scope at parse time
  *
- * once a statement is run variable and its value is pushed to the scope
+ * once a statement is run the expression is evaluated and its value is stored to the slot of the current frame
  * */
 typedef struct {
     noam_statement_vtable_* vtable_;
+    size_t                  line;
     noam_buffer*            name;
     struct noam_expression* expr;
-    noam_scope*             scope;
+    size_t                  slot;
+    int                     global;
 } noam_assignment_statement;
 
+/* noam_compound_assignment_statement struct: `name += expr` and the same for -, * and /
+ *
+ * name: name of the variable
+ * op: the operator without =
+ * expr: right hand side expression
+ * slot, global: slot of the variable resolved like a read at parse time
+ *
+ * ints, floats and strings owned by the statement are updated in place, `+=` appends to a string,
+ * other results are stored as new values owned by the statement, so a counter is allocated once until it is read
+ * */
+typedef struct {
+    noam_statement_vtable_* vtable_;
+    size_t                  line;
+    noam_buffer*            name;
+    char                    op;
+    struct noam_expression* expr;
+    size_t                  slot;
+    int                     global;
+} noam_compound_assignment_statement;
+
+/* noam_index_assignment_statement struct: array element assignment
+ *
+ * target: element access on the left hand side
+ * expr: right hand side expression, converted to the element type
+ * */
+typedef struct {
+    noam_statement_vtable_* vtable_;
+    size_t                  line;
+    noam_index_expression*  target;
+    struct noam_expression* expr;
+} noam_index_assignment_statement;
+
 /* noam_expression_statement struct: an expression that discards its value
  *
  * func_call: an expression to be called, returned value is escaped
  * */
 typedef struct {
     noam_statement_vtable_*    vtable_;
+    size_t                     line;
     noam_expression *          expression;
 } noam_expression_statement;
 
 /* noam_return_statement struct: returns from the function or main program
  *
- * expression: an expression to be evaluated on return */
+ * expression: an expression to be evaluated on return
+ *
+ * the statement sets `returning` of the stack, so the enclosing blocks stop up to the function call */
 typedef struct {
     noam_statement_vtable_* vtable_;
+    size_t                  line;
     noam_expression*        expression;
 } noam_return_statement;
 
 /* noam_cond_statement struct: an if/else statement */
 typedef struct {
     noam_statement_vtable_* vtable_;
+    size_t                  line;
     noam_buffer*            conditions;
     noam_buffer*            blocks;
     int                     with_else;
-    int                     is_returned;
 } noam_cond_statement;
 
-noam_value* noam_statement_run(noam_statement* statement);
-int noam_statement_is_returned(noam_statement* statement);
+/* noam_for_statement struct: iteration over a map or an array
+ *
+ * key: name bound to a key of a map or an element of an array
+ * value: optional name bound to a value of a map, `key` gets an index of an array then
+ * key_slot, value_slot, global: slots of the loop variables declared in the scope at parse time
+ * iterable: an expression evaluated once before the loop
+ * block: body of the loop
+ *
+ * map pairs are copied before the loop, so the body may modify the map
+ * */
+typedef struct {
+    noam_statement_vtable_* vtable_;
+    size_t                  line;
+    noam_buffer*            key;
+    noam_buffer*            value;
+    size_t                  key_slot;
+    size_t                  value_slot;
+    int                     global;
+    noam_expression*        iterable;
+    noam_buffer*            block;
+} noam_for_statement;
+
+/* noam_while_statement struct: runs the block while the condition is true
+ *
+ * condition: a boolean expression checked before each iteration
+ * block: body of the loop
+ * */
+typedef struct {
+    noam_statement_vtable_* vtable_;
+    size_t                  line;
+    noam_expression*        condition;
+    noam_buffer*            block;
+} noam_while_statement;
+
+/* noam_range_statement struct: a counted loop `for i in from..to` over the ints from `from` up to `to` exclusive
+ *
+ * key: name of the loop variable, local to the loop
+ * slot, global: slot of the loop variable
+ * from, to: int expressions evaluated once before the loop
+ * block: body of the loop
+ * bound: set if the body mentions the loop variable
+ * escapes: set if the body may keep a reference to the loop variable, it assigns, passes, returns, yields or stores it
+ *
+ * the counter and the bound are C ints, so an iteration is an int compare and an increment,
+ * the counter is boxed into the slot only if the body reads it, once per loop unless the variable escapes,
+ * assigning the variable doesn't change the counter
+ * */
+typedef struct {
+    noam_statement_vtable_* vtable_;
+    size_t                  line;
+    noam_buffer*            key;
+    size_t                  slot;
+    int                     global;
+    noam_expression*        from;
+    noam_expression*        to;
+    noam_buffer*            block;
+    int                     bound;
+    int                     escapes;
+} noam_range_statement;
+
+noam_value* noam_statement_run(noam_statement* statement, noam_vm* vm);
 void noam_statement_release(noam_statement* statement);
 
 noam_print_statement* noam_print_statement_create(noam_expression* expression);
-noam_value* noam_print_statement_run(noam_print_statement* statement);
-int noam_print_statement_is_returned(noam_print_statement* statement);
+noam_value* noam_print_statement_run(noam_print_statement* statement, noam_vm* vm);
 void noam_print_statement_release(noam_print_statement* statement);
 
 noam_assignment_statement* noam_assignment_statement_create(noam_buffer* name,
                                                             noam_expression* expression,
                                                             noam_scope* scope);
-noam_value* noam_assignment_statement_run(noam_assignment_statement* statement);
-int noam_assignment_statement_is_returned(noam_assignment_statement* statement);
+noam_value* noam_assignment_statement_run(noam_assignment_statement* statement, noam_vm* vm);
 void noam_assignment_statement_release(noam_assignment_statement* statement);
 
+noam_compound_assignment_statement* noam_compound_assignment_statement_create(noam_buffer* name, char op,
+                                                                              noam_expression* expression,
+                                                                              noam_scope* scope);
+noam_value* noam_compound_assignment_statement_run(noam_compound_assignment_statement* statement, noam_vm* vm);
+void noam_compound_assignment_statement_release(noam_compound_assignment_statement* statement);
+
+noam_index_assignment_statement* noam_index_assignment_statement_create(noam_index_expression* target,
+                                                                        noam_expression* expression);
+noam_value* noam_index_assignment_statement_run(noam_index_assignment_statement* statement, noam_vm* vm);
+void noam_index_assignment_statement_release(noam_index_assignment_statement* statement);
+
 noam_expression_statement* noam_expression_statement_create(noam_expression* expression);
-noam_value* noam_expression_statement_run(noam_expression_statement* statement);
-int noam_expression_statement_is_returned(noam_expression_statement* statement);
+noam_value* noam_expression_statement_run(noam_expression_statement* statement, noam_vm* vm);
 void noam_expression_statement_release(noam_expression_statement* statement);
 
 noam_return_statement* noam_return_statement_create(noam_expression* expression);
-noam_value* noam_return_statement_run(noam_return_statement* statement);
-int noam_return_statement_is_returned(noam_return_statement* statement);
+noam_value* noam_return_statement_run(noam_return_statement* statement, noam_vm* vm);
 void noam_return_statement_release(noam_return_statement* statement);
 
 noam_cond_statement* noam_cond_statement_create(noam_buffer* conditions, noam_buffer* blocks, int with_else);
-noam_value* noam_cond_statement_run(noam_cond_statement* statement);
-int noam_cond_statement_is_returned(noam_cond_statement* statement);
+noam_value* noam_cond_statement_run(noam_cond_statement* statement, noam_vm* vm);
 void noam_cond_statement_release(noam_cond_statement* statement);
 
-noam_value* noam_statements_run(noam_buffer* statements);
+noam_for_statement* noam_for_statement_create(noam_buffer* key, noam_buffer* value, noam_expression* iterable,
+                                              noam_buffer* block, noam_scope* scope);
+noam_value* noam_for_statement_run(noam_for_statement* statement, noam_vm* vm);
+void noam_for_statement_release(noam_for_statement* statement);
+
+noam_while_statement* noam_while_statement_create(noam_expression* condition, noam_buffer* block);
+noam_value* noam_while_statement_run(noam_while_statement* statement, noam_vm* vm);
+void noam_while_statement_release(noam_while_statement* statement);
+
+noam_range_statement* noam_range_statement_create(noam_buffer* key, noam_expression* from, noam_expression* to,
+                                                  noam_buffer* block, int bound, int escapes, noam_scope* scope);
+noam_value* noam_range_statement_run(noam_range_statement* statement, noam_vm* vm);
+void noam_range_statement_release(noam_range_statement* statement);
+
+/* noam_statements_run: runs statements until a return statement, returns its value or NULL */
+noam_value* noam_statements_run(noam_buffer* statements, noam_vm* vm);
 
 #endif //NOAM_STATEMENT_H
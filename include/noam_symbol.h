@@ -4,18 +4,25 @@
 #include "noam_buffer.h"
 #include "noam_dict.h"
 
+struct noam_value;
+struct noam_coroutine_value;
+struct noam_module;
+
 /* noam_scope struct: scope of the program which can be a function scope or a block scope
  *
- * vars: variables dictionary or a mapping from string to noam_expression
+ * vars: variables dictionary or a mapping from string to a slot index in the frame
  * name: NULL is used for ordinary scopes, function name for functions
+ * slots: number of slots in the frame, counted for function scopes and the main scope only
  * parent, next, child: neighbour nodes in order to traverse the scopes tree
  *
  * root of the tree is a main scope, all functions params are on the first level scope,
- * variables in blocks are placed down to the bottom of the tree
+ * variables in blocks are placed down to the bottom of the tree,
+ * block scopes allocate their slots in the frame of the enclosing function or the main scope
  * */
 typedef struct noam_scope {
     noam_dict*         vars;
     noam_buffer*       name;
+    size_t             slots;
     struct noam_scope* parent;
     struct noam_scope* next;
     struct noam_scope* child;
@@ -25,23 +32,94 @@ typedef struct noam_scope {
 /* noam_func struct: a function
  *
  * name: function name
- * params: plain params strings
+ * params: plain params strings, param i is bound to slot i
  * body: array of noam_statements
+ * slots: size of the function frame
+ * coroutine: set if the body has a yield statement, a call then creates a coroutine instead of running it
+ * tokens: tokens of a body left for its first call by a lazy vm, NULL once `body` is parsed
+ * scope: the function scope the body is parsed in
+ * module: the module defining the function, NULL for functions of scripts
+ * hash: hash of the tokens of the definition, a reload keeps the function if it is the same
  * */
 typedef struct {
-    noam_buffer* name;
-    noam_buffer* params;
-    noam_buffer* body;
+    noam_buffer*        name;
+    noam_buffer*        params;
+    noam_buffer*        body;
+    size_t              slots;
+    int                 coroutine;
+    noam_buffer*        tokens;
+    noam_scope*         scope;
+    struct noam_module* module;
+    size_t              hash;
 } noam_func;
 
+#define NOAM_STACK_CALLS 128
+
+/* noam_call_site struct: an active call as seen by the profiler
+ *
+ * func: the called function, NULL for the top-level statements
+ * line: line of the statement the call is running
+ * */
+typedef struct {
+    noam_func* func;
+    size_t     line;
+} noam_call_site;
+
+/* noam_stack struct: a call stack of variable slots
+ *
+ * slots: contiguous array of noam_values, frames are laid out one after another
+ * length: number of slots in use
+ * size: capacity of the array
+ * base: index of the first slot of the running function frame
+ * tail: a function called in tail position which takes over the frame of its caller, NULL otherwise
+ * tail_frame: index of the first evaluated argument of the `tail` call
+ * returning: set by a return statement until the statements of the running function unwind
+ * coroutine: the running coroutine, NULL outside of coroutines
+ * resuming: set while the statements of a resumed coroutine are entered down to its last yield
+ * yielding: set with `returning` by a yield statement, the statements save their resume points then
+ * calls, depth: shadow stack of the active calls, calls[0] is the top-level code,
+ * calls deeper than NOAM_STACK_CALLS are counted but not recorded
+ *
+ * the global frame starts at 0, a call pushes a frame on top and pops it on return,
+ * the stack is the state of one execution, while the parsed program doesn't change when run
+ * */
+typedef struct {
+    struct noam_value**          slots;
+    size_t                       length;
+    size_t                       size;
+    size_t                       base;
+    noam_func*                   tail;
+    size_t                       tail_frame;
+    int                          returning;
+    struct noam_coroutine_value* coroutine;
+    int                          resuming;
+    int                          yielding;
+    noam_call_site               calls[NOAM_STACK_CALLS];
+    size_t                       depth;
+} noam_stack;
+
 /* noam_symbol_table: symbol table for the program
  *
- * funcs: a mapping from function name to function struct
+ * funcs: a mapping from function name to a pointer to function struct
+ * natives: a mapping from function name to a pointer to a host function registered by noam_native_register
  * head: a root of the scopes tree
+ * main: top-level statements of every loaded script as arrays of noam_statements
+ * calls: call expressions parsed before their function is defined, linked once it is
+ * last: scope of the last parsed function, the next one is added as its sibling,
+ *       so every script loaded into the vm extends the same scopes tree
+ * modules: a mapping from a namespace to a pointer to the noam_module imported under it
+ *
+ * the symbol table together with the statements is the code of a program,
+ * it is only written while a script is parsed and may be shared by vms running at once
  * */
 typedef struct {
-    noam_dict* funcs;
-    noam_scope* head;
+    noam_dict*   funcs;
+    noam_dict*   natives;
+    noam_scope*  head;
+    noam_buffer* main;
+    noam_buffer* calls;
+    noam_scope*  last;
+    noam_dict*   modules;
 } noam_symbol_table;
 
 void noam_scope_vars_release(void* data);
@@ -51,9 +129,47 @@ noam_scope* noam_scope_add_child(noam_buffer* name, noam_scope* parent);
 noam_scope* noam_scope_add_sibling(noam_buffer* name, noam_scope* prev);
 void noam_scope_release(noam_scope* head);
 
+/* noam_scope_frame: returns the function scope or the main scope owning the frame of `scope` */
+noam_scope* noam_scope_frame(noam_scope* scope);
+
+/* noam_scope_find: looks for a variable up to the frame owner, returns 1 and its slot if found */
+int noam_scope_find(noam_scope* scope, noam_buffer* name, size_t* slot);
+
+/* noam_scope_declare: returns a slot of the variable visible in the frame, allocates it in `scope` otherwise
+ *
+ * global: set if the slot belongs to the global frame
+ * */
+size_t noam_scope_declare(noam_scope* scope, noam_buffer* name, int* global);
+
+/* noam_scope_lookup: resolves a variable read, names unknown to a function are taken as globals
+ * which may be assigned later */
+size_t noam_scope_lookup(noam_scope* scope, noam_buffer* name, int* global);
+
 noam_func* noam_func_create(noam_buffer* name, noam_buffer* params, noam_buffer* body);
 void noam_func_release(noam_func* func);
 void noam_symbol_table_funcs_release(void* data);
+void noam_symbol_table_natives_release(void* data);
+void noam_symbol_table_modules_release(void* data);
+
+noam_stack* noam_stack_create();
+void noam_stack_release(noam_stack* stack);
+
+/* noam_stack_push: puts a frame of `size` empty slots on top of the stack, returns its first slot index
+ *
+ * the frame becomes current only once `base` is set, so the arguments can be evaluated in the caller frame
+ * */
+size_t noam_stack_push(noam_stack* stack, size_t size);
+
+/* noam_stack_pop: drops the frame starting at `frame` and all the frames above it */
+void noam_stack_pop(noam_stack* stack, size_t frame);
+
+/* noam_stack_enter, noam_stack_leave: push and pop a call of the shadow stack,
+ * a signal handler may read it at any point in between */
+void noam_stack_enter(noam_stack* stack, noam_func* func);
+void noam_stack_leave(noam_stack* stack);
+
+/* noam_stack_globals: grows the global frame up to `size` slots, valid only when no function is running */
+void noam_stack_globals(noam_stack* stack, size_t size);
 
 noam_symbol_table* noam_symbol_table_create();
 void noam_symbol_table_release(noam_symbol_table* symbol_table);
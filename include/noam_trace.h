@@ -0,0 +1,58 @@
+#ifndef NOAM_TRACE_H
+#define NOAM_TRACE_H
+
+#include <stdio.h>
+
+/* trace categories, enabled at runtime with `--trace=parser,calls`, NOAM_TRACE=all or noam_trace_enable
+ *
+ * lexer: tokens of every loaded source
+ * parser: expressions, statements and functions created by the parser
+ * alloc: values created while running
+ * exec: vms, pools and schedulers, blocks of statements being run
+ * calls: script function calls and coroutine resumes
+ * */
+#define NOAM_TRACE_LEXER  0x01u
+#define NOAM_TRACE_PARSER 0x02u
+#define NOAM_TRACE_ALLOC  0x04u
+#define NOAM_TRACE_EXEC   0x08u
+#define NOAM_TRACE_CALLS  0x10u
+#define NOAM_TRACE_ALL    0x1fu
+
+/* noam_trace_mask: enabled categories, process-wide, meant to be set before any vm starts running */
+extern unsigned noam_trace_mask;
+
+#if defined(__GNUC__)
+#define NOAM_UNLIKELY(cond) __builtin_expect(!!(cond), 0)
+#else
+#define NOAM_UNLIKELY(cond) (cond)
+#endif
+
+/* NOAM_TRACE: writes a trace line of a category, a disabled category costs a load and a not taken branch,
+ * building with NOAM_NO_TRACE removes the tracing entirely */
+#ifdef NOAM_NO_TRACE
+#define NOAM_TRACE(category, ...) ((void)0)
+#define NOAM_TRACE_ON(category) 0
+#else
+#define NOAM_TRACE(category, ...)                         \
+do {                                                      \
+    if(NOAM_UNLIKELY(noam_trace_mask & (category))) {     \
+        noam_trace_write((category), __VA_ARGS__);        \
+    }                                                     \
+} while(0)
+#define NOAM_TRACE_ON(category) NOAM_UNLIKELY(noam_trace_mask & (category))
+#endif
+
+/* noam_trace_enable: enables comma separated category names or `all`, returns 0 on an unknown name */
+int noam_trace_enable(const char* categories);
+
+/* noam_trace_init: enables the categories of the NOAM_TRACE environment variable,
+ * NOAM_TRACE_FILE redirects the output from stderr to a file */
+int noam_trace_init();
+
+/* noam_trace_sink: sets the stream of the trace output, stderr by default so scripts output stays clean */
+void noam_trace_sink(FILE* sink);
+
+/* noam_trace_write: writes a line prefixed with the category name */
+void noam_trace_write(unsigned category, const char* format, ...);
+
+#endif //NOAM_TRACE_H
@@ -5,11 +5,19 @@
 #include <string.h>
 #include <stdio.h>
 
-#define NOAM_DEBUG
+#include "noam_trace.h"
+#include "noam_alloc.h"
 
 /* noam_release_func: used in all noam data structures to release memory */
 typedef void(*noam_release_func)(void*);
 
+/* NOAM_BARRIER: keeps the compiler from moving memory accesses across it, for state read by signal handlers */
+#if defined(__GNUC__)
+#define NOAM_BARRIER() __asm__ __volatile__("" ::: "memory")
+#else
+#define NOAM_BARRIER()
+#endif
+
 /* noam_atob: converts a C string representation of a boolean to an int */
 int noam_atob(const char* str);
 
@@ -0,0 +1,140 @@
+#ifndef NOAM_VM_H
+#define NOAM_VM_H
+
+#include <setjmp.h>
+#include <stdarg.h>
+
+#include "noam_symbol.h"
+
+#define NOAM_VM_ERROR_LENGTH 256
+#define NOAM_VM_SCRATCH_LENGTH 1024
+
+struct noam_value;
+struct noam_pool;
+
+/* noam_status enum: result of the vm entry points */
+typedef enum {
+    NOAM_OK,
+    NOAM_SYNTAX_ERROR,
+    NOAM_RUNTIME_ERROR,
+    NOAM_IO_ERROR
+} noam_status;
+
+/* noam_output_func: receives everything printed by scripts */
+typedef void(*noam_output_func)(const char* str, size_t length, void* data);
+
+/* noam_vm struct: an independent interpreter instance
+ *
+ * symbol_table: the loaded code, functions, host functions and scopes
+ * stack: global variables and frames of the running functions
+ * shared: set if the code belongs to another vm
+ * pool, worker: threads of the pmap built-in started on the first call, set for vms of the pool threads
+ * lazy: function bodies are parsed on their first call rather than when a script is loaded
+ * output, output_data: sink for print statements, stdout by default
+ * status, error: result and message of the last failed entry point
+ * recover: where an error raised during load or call returns to
+ * scratch: space for string representations of numbers and vectors
+ *
+ * all the runtime state lives here, so separate vms may run on separate threads without locks,
+ * a single vm is not meant to be used by two threads at once
+ * */
+typedef struct noam_vm {
+    noam_symbol_table* symbol_table;
+    noam_stack*        stack;
+    int                shared;
+    struct noam_pool*  pool;
+    int                worker;
+    int                lazy;
+    noam_output_func   output;
+    void*              output_data;
+    noam_status        status;
+    char               error[NOAM_VM_ERROR_LENGTH];
+    jmp_buf*           recover;
+    char               scratch[NOAM_VM_SCRATCH_LENGTH];
+} noam_vm;
+
+noam_vm* noam_vm_create();
+
+/* noam_vm_share: creates a vm running the code loaded into `vm` with its own globals and call stack
+ *
+ * the code is parsed once and read only by the shared vms, so each of them may run on its own thread,
+ * `vm` must not load scripts or register host functions while they run and must outlive them
+ * */
+noam_vm* noam_vm_share(noam_vm* vm);
+void noam_vm_destroy(noam_vm* vm);
+
+/* noam_vm_set_output: redirects print statements */
+void noam_vm_set_output(noam_vm* vm, noam_output_func output, void* data);
+
+/* noam_vm_set_lazy: turns lazy parsing of the function bodies of the following loads on or off
+ *
+ * a body is parsed on the first call of its function then, a load only matches its braces,
+ * so functions which are never called cost their tokens only, syntax errors in them are reported on the call
+ * */
+void noam_vm_set_lazy(noam_vm* vm, int lazy);
+
+/* noam_vm_compile: parses the function bodies left for their first call and reports their syntax errors,
+ * noam_vm_share does it as well since shared vms don't parse */
+noam_status noam_vm_compile(noam_vm* vm);
+
+/* noam_vm_load, noam_vm_load_file: parses a script, defines its functions and runs its top-level statements
+ *
+ * functions and globals stay defined for the following loads and calls,
+ * a shared vm cannot load scripts
+ * */
+noam_status noam_vm_load(noam_vm* vm, const char* source);
+noam_status noam_vm_load_file(noam_vm* vm, const char* filename);
+
+/* noam_vm_load_path: noam_vm_load of a source read from `path`, its imports are relative to the directory of `path`,
+ * the imports of a source without a path are relative to the working directory
+ *
+ * `import "path"` loads another script as a module, once per vm, its functions and globals
+ * are known to the importers as `name.f` and `name.x`, where `name` is the file name without the extension
+ * */
+noam_status noam_vm_load_path(noam_vm* vm, const char* source, const char* path);
+
+/* noam_vm_reload: parses a changed script or module file again and swaps in the functions whose definitions differ
+ *
+ * changed: set to the number of functions added or redefined, may be NULL
+ *
+ * unchanged functions keep their parsed bodies, so the cost follows the size of the file,
+ * calls keep pointing to the redefined functions, top-level statements are not run again,
+ * so globals keep their values, a function removed from the file stays defined,
+ * suspended coroutines go on with the body they were created with,
+ * like a load, a reload happens while no script runs and not while vms share the code
+ * */
+noam_status noam_vm_reload(noam_vm* vm, const char* filename, size_t* changed);
+
+/* noam_vm_run: runs top-level statements of the loaded scripts again, a shared vm sets its globals this way */
+noam_status noam_vm_run(noam_vm* vm);
+
+/* noam_vm_call: calls a script function by name
+ *
+ * result: set to the returned value, NULL if the function doesn't return one
+ * */
+noam_status noam_vm_call(noam_vm* vm, const char* name, struct noam_value** args, size_t argc,
+                         struct noam_value** result);
+
+/* noam_vm_call_func: calls a function found in the symbol table of the vm */
+noam_status noam_vm_call_func(noam_vm* vm, noam_func* func, struct noam_value** args, size_t argc,
+                              struct noam_value** result);
+
+/* noam_vm_resume: runs a coroutine returned by a call up to its next yield
+ *
+ * result: set to the yielded value, to the returned one once the coroutine is done
+ * */
+noam_status noam_vm_resume(noam_vm* vm, struct noam_value* coroutine, struct noam_value** result);
+
+/* noam_vm_error_message: describes the last error */
+const char* noam_vm_error_message(noam_vm* vm);
+
+/* noam_vm_error, noam_vm_syntax_error: abort the running entry point with a formatted message,
+ * they don't return */
+void noam_vm_error(noam_vm* vm, const char* format, ...);
+void noam_vm_syntax_error(noam_vm* vm, const char* format, ...);
+void noam_vm_raise(noam_vm* vm, noam_status status, const char* format, va_list args);
+
+/* noam_vm_write: passes a string to the output sink */
+void noam_vm_write(noam_vm* vm, const char* str, size_t length);
+
+#endif //NOAM_VM_H
@@ -0,0 +1,49 @@
+#ifndef NOAM_WATCH_H
+#define NOAM_WATCH_H
+
+#include "noam_vm.h"
+
+/* noam_watch_func: told about each reload, the vm error describes a failed one */
+typedef void(*noam_watch_func)(noam_vm* vm, const char* path, noam_status status, size_t changed, void* data);
+
+/* noam_watch_file struct: a watched file
+ *
+ * wd: the inotify watch descriptor of its directory, editors often replace a file rather than write it,
+ *     so the directory is watched for files written or moved in, files of a directory share the descriptor
+ * path: the resolved path of the file
+ * */
+typedef struct {
+    int   wd;
+    char* path;
+} noam_watch_file;
+
+/* noam_watch struct: reloads the files of a vm when they change on disk
+ *
+ * vm: the reloaded vm
+ * fd: the inotify instance
+ * files: the watched noam_watch_file, the script files added and the modules they import
+ * func, data: told about the reloads, may be NULL
+ * */
+typedef struct {
+    noam_vm*        vm;
+    int             fd;
+    noam_buffer*    files;
+    noam_watch_func func;
+    void*           data;
+} noam_watch;
+
+/* noam_watch_create: a watch of the files of `vm`, returns NULL if inotify is not available */
+noam_watch* noam_watch_create(noam_vm* vm, noam_watch_func func, void* data);
+void noam_watch_destroy(noam_watch* watch);
+
+/* noam_watch_add: watches a script file and the modules imported so far, returns 0 if it cannot be watched */
+int noam_watch_add(noam_watch* watch, const char* path);
+
+/* noam_watch_poll: waits up to `timeout` milliseconds for changes, -1 waits for one, 0 doesn't wait,
+ * reloads each changed file once and returns the number of reloads
+ *
+ * a host calls it between frames, modules imported by a reload are watched from then on
+ * */
+size_t noam_watch_poll(noam_watch* watch, int timeout);
+
+#endif //NOAM_WATCH_H
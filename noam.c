@@ -5,91 +5,175 @@
 //TODO: Memory management awareness
 // Release all the stuff
 
-//TODO: For debugging
-const char* noam_token_to_string(noam_token token){
-    static const char* strings[] = { "NOAM_ERROR_TOKEN",
-                                     "NOAM_WORD_TOKEN",
-                                     "NOAM_INT_TOKEN",
-                                     "NOAM_FLOAT_TOKEN",
-                                     "NOAM_STRING_TOKEN",
-                                     "NOAM_BOOL_TOKEN",
-                                     "NOAM_LINE_TOKEN",
-                                     "NOAM_EQ_TOKEN",
-                                     "NOAM_OP_TOKEN",
-                                     "NOAM_LP_TOKEN",
-                                     "NOAM_RP_TOKEN",
-                                     "NOAM_LB_TOKEN",
-                                     "NOAM_RB_TOKEN",
-                                     "NOAM_COMMA_TOKEN",
-                                     "NOAM_NIL_TOKEN",
-                                     "NOAM_EOF_TOKEN" };
-    return strings[token];
-}
-
-void noam_interpret(noam_parser* parser, noam_symbol_table* symbol_table){
-    noam_buffer* statements = noam_parse_statements(parser, symbol_table);
-    noam_statements_run(statements);
-    //TODO: Fix bug on statement release
-    //noam_buffer_release(statements);
-}
-
-void noam_interactive_mode(noam_symbol_table* symbol_table){
+void noam_interactive_mode(noam_vm* vm){
 
     char* line = NULL;
     size_t length = 0;
+    /* lines of an input with open brackets or strings, it's compiled once they are closed */
+    noam_buffer* input = noam_buffer_create(1);
 
     for(;;){
-        printf(">>> ");
-        getline(&line, &length, stdin);
+        printf(noam_buffer_empty(input) ? ">>> " : "... ");
+
+        ssize_t read = getline(&line, &length, stdin);
 
-        if(!strcmp(line, "exit()\n")){
-            return;
+        if(read < 0 || (noam_buffer_empty(input) && !strcmp(line, "exit()\n"))){
+            break;
         }
 
-        noam_parser parser;
-        noam_parser_init(&parser, line);
-        noam_interpret(&parser, symbol_table);
+        noam_buffer_append(input, line, (size_t)read);
+        noam_buffer_terminate(input);
+
+        if(!noam_source_complete(input->data)){
+            continue;
+        }
+
+        /* the vm keeps the globals, functions and scopes of the session,
+         * an error aborts the input only, the session goes on */
+        if(noam_vm_load(vm, input->data) != NOAM_OK){
+            fprintf(stderr, NOAM_TITLE ": %s\n", noam_vm_error_message(vm));
+        }
+
+        input->length = 0;
     }
+
+    noam_buffer_release(input);
+    free(line);
 }
 
-void noam_file_mode(const char* filename, noam_symbol_table* symbol_table){
-    FILE* file = fopen(filename, "r");
-    NOAM_EXIT(!file, "cannot open the file");
+int noam_file_mode(const char* filename, noam_vm* vm){
+    if(noam_vm_load_file(vm, filename) != NOAM_OK){
+        fprintf(stderr, NOAM_TITLE ": %s\n", noam_vm_error_message(vm));
+        return -1;
+    }
+    return 0;
+}
 
-    const size_t chunk_size = 1024;
-    char file_buffer[chunk_size] = {0};
-    noam_buffer* file_source = noam_buffer_create(1);
-    size_t bytes_read = 0;
+void noam_watch_report(noam_vm* vm, const char* path, noam_status status, size_t changed, void* data){
+    fflush(stdout);
 
-    while((bytes_read = fread(file_buffer, 1, chunk_size, file)) > 0){
-        noam_buffer_append(file_source, file_buffer, bytes_read);
+    if(status != NOAM_OK){
+        fprintf(stderr, NOAM_TITLE ": %s\n", noam_vm_error_message(vm));
+    } else {
+        fprintf(stderr, NOAM_TITLE ": reloaded %s, %lu functions changed\n", path, (unsigned long)changed);
     }
+}
 
-    //TODO: Consider replacing by noam_buffer_pushv
-    char eof = ' ';
-    noam_buffer_push(file_source, &eof);
-    char* buffer = file_source->data;
-    buffer[file_source->length + 1] = '\0';
+/* noam_watch_mode: reloads the source and the modules it imports whenever they change, until interrupted */
+int noam_watch_mode(const char* filename, noam_vm* vm){
+    noam_watch* watch = noam_watch_create(vm, &noam_watch_report, NULL);
 
-    noam_parser parser;
-    noam_parser_init(&parser, file_source->data);
-    noam_interpret(&parser, symbol_table);
+    if(!watch || !noam_watch_add(watch, filename)){
+        fprintf(stderr, NOAM_TITLE ": cannot watch %s\n", filename);
 
-    fclose(file);
+        if(watch){
+            noam_watch_destroy(watch);
+        }
+        return -1;
+    }
+
+    /* the output of the run shows before the wait */
+    fflush(stdout);
+
+    for(;;){
+        noam_watch_poll(watch, -1);
+    }
 }
 
 int main(int argc, char** argv) {
-    NOAM_EXIT(argc != 2, "usage " NOAM_TITLE " [-i] [source]");
+    const char* source = NULL;
+    const char* profile = NULL;
+    const char* image = NULL;
+    const char* save_image = NULL;
+    int interactive = 0;
+    int alloc_stats = 0;
+    int lazy = 0;
+    int watch = 0;
+
+    NOAM_EXIT(!noam_trace_init(), "unknown category in NOAM_TRACE");
+
+    for(int i = 1; i < argc; ++i){
+        if(!strcmp(argv[i], "-i")){
+            interactive = 1;
+        } else if(!strncmp(argv[i], "--trace=", 8)){
+            NOAM_EXIT(!noam_trace_enable(argv[i] + 8), "unknown trace category, expected lexer, parser, alloc, exec, calls or all");
+        } else if(!strcmp(argv[i], "--alloc-stats")){
+            alloc_stats = 1;
+            noam_alloc_stats_enable(1);
+        } else if(!strcmp(argv[i], "--lazy")){
+            lazy = 1;
+        } else if(!strcmp(argv[i], "--watch")){
+            watch = 1;
+        } else if(!strcmp(argv[i], "--profile")){
+            profile = NOAM_PROFILE_PATH;
+        } else if(!strncmp(argv[i], "--profile=", 10)){
+            profile = argv[i] + 10;
+        } else if(!strncmp(argv[i], "--image=", 8)){
+            image = argv[i] + 8;
+        } else if(!strncmp(argv[i], "--save-image=", 13)){
+            save_image = argv[i] + 13;
+        } else {
+            NOAM_EXIT(source != NULL, NOAM_USAGE);
+            source = argv[i];
+        }
+    }
+
+    NOAM_EXIT(interactive == (source != NULL), NOAM_USAGE);
+    NOAM_EXIT(watch && interactive, NOAM_USAGE);
 
-    noam_symbol_table* symbol_table = noam_symbol_table_create();
+    noam_vm* vm = noam_vm_create();
+    noam_native_register_math(vm);
+    noam_vm_set_lazy(vm, lazy);
+    int status = 0;
 
-    if(!strcmp(argv[1], "-i")){
-        noam_interactive_mode(symbol_table);
+    /* the image takes the place of the prelude, the source runs on top of its state */
+    if(image && noam_image_load(vm, image) != NOAM_OK){
+        fprintf(stderr, NOAM_TITLE ": %s\n", noam_vm_error_message(vm));
+        noam_vm_destroy(vm);
+        return -1;
+    }
+
+    if(profile){
+        NOAM_EXIT(!noam_profile_start(vm, NOAM_PROFILE_HZ), "cannot start the profiler");
+    }
+
+    if(interactive){
+        noam_interactive_mode(vm);
     } else {
-        noam_file_mode(argv[1], symbol_table);
+        status = noam_file_mode(source, vm);
     }
 
-    noam_symbol_table_release(symbol_table);
+    /* the state the source left is kept, a failed run is watched too so a fix can be reloaded */
+    if(watch){
+        status = noam_watch_mode(source, vm);
+    }
 
-    return 0;
-}
\ No newline at end of file
+    if(save_image && !status && noam_image_save(vm, save_image) != NOAM_OK){
+        fprintf(stderr, NOAM_TITLE ": %s\n", noam_vm_error_message(vm));
+        status = -1;
+    }
+
+    if(profile){
+        FILE* folded = fopen(profile, "w");
+        noam_profile_stop();
+
+        if(!folded){
+            fprintf(stderr, NOAM_TITLE ": cannot open %s\n", profile);
+        }
+
+        noam_profile_report(folded, stderr);
+        noam_profile_release();
+
+        if(folded){
+            fclose(folded);
+        }
+    }
+
+    if(alloc_stats){
+        noam_alloc_stats_report(stderr, NOAM_ALLOC_TOP_SITES);
+    }
+
+    noam_vm_destroy(vm);
+
+    return status;
+}
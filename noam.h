@@ -2,10 +2,15 @@
 #define NOAM_H
 
 #include "noam_parser.h"
+#include "noam_profile.h"
+#include "noam_image.h"
+#include "noam_watch.h"
 
 #define NOAM_TITLE "noam"
 #define NOAM_VERSION "1.0"
 #define NOAM_FULL_TITLE NOAM_TITLE " " NOAM_VERSION
+#define NOAM_PROFILE_PATH "noam.folded"
+#define NOAM_USAGE "usage " NOAM_TITLE " [--trace=categories] [--profile[=path]] [--alloc-stats] [--lazy] [--image=path] [--save-image=path] [--watch] [-i] [source]"
 
 
 #define NOAM_EXIT(cond, message)                   \
@@ -0,0 +1,180 @@
+#include "noam_alloc.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+
+#if defined(__GNUC__)
+#define NOAM_ALLOC_ADD(target, value) __atomic_fetch_add(&(target), (value), __ATOMIC_RELAXED)
+#else
+#define NOAM_ALLOC_ADD(target, value) ((target) += (value))
+#endif
+
+/* noam_alloc_row struct: a row of the category table */
+typedef struct {
+    const char*       category;
+    noam_alloc_totals totals;
+} noam_alloc_row;
+
+int noam_alloc_on = 0;
+
+static noam_alloc_site* noam_alloc_sites = NULL;
+
+void noam_alloc_stats_enable(int on){
+    noam_alloc_on = on;
+}
+
+void noam_alloc_count(noam_alloc_site* site, size_t bytes){
+    NOAM_ALLOC_ADD(site->count, 1);
+    NOAM_ALLOC_ADD(site->bytes, bytes);
+
+#if defined(__GNUC__)
+    if(!__atomic_exchange_n(&site->listed, 1, __ATOMIC_ACQ_REL)){
+        noam_alloc_site* head = __atomic_load_n(&noam_alloc_sites, __ATOMIC_ACQUIRE);
+
+        do {
+            site->next = head;
+        } while(!__atomic_compare_exchange_n(&noam_alloc_sites, &head, site, 1, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+    }
+#else
+    if(!site->listed){
+        site->listed = 1;
+        site->next = noam_alloc_sites;
+        noam_alloc_sites = site;
+    }
+#endif
+}
+
+/* noam_alloc_add: adds the counters of a site to the totals of its category */
+void noam_alloc_add(noam_alloc_totals* totals, const noam_alloc_site* site){
+    if(site->freed){
+        totals->freed += site->count;
+        totals->freed_bytes += site->bytes;
+    } else {
+        totals->count += site->count;
+        totals->bytes += site->bytes;
+    }
+
+    totals->live = totals->count > totals->freed ? totals->count - totals->freed : 0;
+}
+
+int noam_alloc_stats_category(const char* category, noam_alloc_totals* totals){
+    int found = 0;
+    memset(totals, 0, sizeof(noam_alloc_totals));
+
+    for(noam_alloc_site* site = noam_alloc_sites; site; site = site->next){
+        if(!strcmp(site->category, category)){
+            noam_alloc_add(totals, site);
+            found = 1;
+        }
+    }
+
+    return found;
+}
+
+void noam_alloc_stats_totals(noam_alloc_totals* totals){
+    memset(totals, 0, sizeof(noam_alloc_totals));
+
+    for(noam_alloc_site* site = noam_alloc_sites; site; site = site->next){
+        noam_alloc_add(totals, site);
+    }
+}
+
+void noam_alloc_stats_reset(){
+    for(noam_alloc_site* site = noam_alloc_sites; site; site = site->next){
+        site->count = 0;
+        site->bytes = 0;
+    }
+}
+
+size_t noam_alloc_peak_rss(){
+    struct rusage usage;
+
+    if(getrusage(RUSAGE_SELF, &usage)){
+        return 0;
+    }
+
+    /* kilobytes on Linux */
+    return (size_t)usage.ru_maxrss * 1024;
+}
+
+int noam_alloc_row_cmp(const void* lhs, const void* rhs){
+    const noam_alloc_row* l = lhs;
+    const noam_alloc_row* r = rhs;
+
+    if(l->totals.bytes != r->totals.bytes){
+        return l->totals.bytes < r->totals.bytes ? 1 : -1;
+    }
+    return strcmp(l->category, r->category);
+}
+
+int noam_alloc_site_cmp(const void* lhs, const void* rhs){
+    const noam_alloc_site* l = *(noam_alloc_site* const*)lhs;
+    const noam_alloc_site* r = *(noam_alloc_site* const*)rhs;
+
+    if(l->bytes != r->bytes){
+        return l->bytes < r->bytes ? 1 : -1;
+    }
+    return l->count < r->count ? 1 : l->count > r->count ? -1 : 0;
+}
+
+void noam_alloc_stats_report(FILE* stream, size_t sites){
+    size_t length = 0;
+    size_t categories = 0;
+
+    for(noam_alloc_site* site = noam_alloc_sites; site; site = site->next){
+        ++length;
+    }
+
+    noam_alloc_row* rows = malloc((length ? length : 1) * sizeof(noam_alloc_row));
+    noam_alloc_site** allocs = malloc((length ? length : 1) * sizeof(noam_alloc_site*));
+    size_t allocs_length = 0;
+    noam_alloc_totals total;
+    memset(&total, 0, sizeof(noam_alloc_totals));
+
+    for(noam_alloc_site* site = noam_alloc_sites; site; site = site->next){
+        size_t i = 0;
+
+        while(i < categories && strcmp(rows[i].category, site->category)){
+            ++i;
+        }
+
+        if(i == categories){
+            rows[categories].category = site->category;
+            memset(&rows[categories].totals, 0, sizeof(noam_alloc_totals));
+            ++categories;
+        }
+
+        noam_alloc_add(&rows[i].totals, site);
+        noam_alloc_add(&total, site);
+
+        if(!site->freed && site->count){
+            allocs[allocs_length++] = site;
+        }
+    }
+
+    qsort(rows, categories, sizeof(noam_alloc_row), &noam_alloc_row_cmp);
+    qsort(allocs, allocs_length, sizeof(noam_alloc_site*), &noam_alloc_site_cmp);
+
+    fprintf(stream, "noam alloc stats: %lu allocations, %lu bytes, %lu live, peak rss %lu KB\n\n",
+            (unsigned long)total.count, (unsigned long)total.bytes, (unsigned long)total.live,
+            (unsigned long)(noam_alloc_peak_rss() / 1024));
+    fprintf(stream, "%12s %14s %12s %12s  %s\n", "allocs", "bytes", "frees", "live", "category");
+
+    for(size_t i = 0; i < categories; ++i){
+        const noam_alloc_totals* totals = &rows[i].totals;
+        fprintf(stream, "%12lu %14lu %12lu %12lu  %s\n", (unsigned long)totals->count, (unsigned long)totals->bytes,
+                (unsigned long)totals->freed, (unsigned long)totals->live, rows[i].category);
+    }
+
+    fprintf(stream, "\n%12s %14s  %s\n", "allocs", "bytes", "site");
+
+    for(size_t i = 0; i < allocs_length && i < sites; ++i){
+        const char* file = strrchr(allocs[i]->file, '/');
+        fprintf(stream, "%12lu %14lu  %s:%d %s\n", (unsigned long)allocs[i]->count, (unsigned long)allocs[i]->bytes,
+                file ? file + 1 : allocs[i]->file, allocs[i]->line, allocs[i]->category);
+    }
+
+    free(rows);
+    free(allocs);
+}
@@ -5,6 +5,7 @@
 noam_buffer* noam_buffer_createv(size_t chunk, noam_release_func release){
     noam_buffer* buffer = malloc(sizeof(noam_buffer));
     buffer->data = malloc(chunk);
+    NOAM_ALLOC_STAT("buffer", sizeof(noam_buffer) + chunk);
     memset(buffer->data, 0, chunk);
     buffer->length = 0;
     buffer->size = 1;
@@ -41,11 +42,24 @@ void noam_buffer_release(noam_buffer* buffer){
             buffer->release(noam_buffer_at(buffer, i));
         }
     }
+    /* the first chunk is counted as a buffer, the rest as growth, so the bytes of both categories balance */
+    NOAM_FREE_STAT("buffer", sizeof(noam_buffer) + buffer->chunk);
+
+    if(buffer->size > 1){
+        NOAM_FREE_STAT("buffer growth", (buffer->size - 1) * buffer->chunk);
+    }
+
     free(buffer->data);
     free(buffer);
 }
 
 void noam_buffer_grow(noam_buffer* buffer, size_t size){
+    if(size > buffer->size){
+        NOAM_ALLOC_STAT("buffer growth", (size - buffer->size) * buffer->chunk);
+    } else if(size < buffer->size){
+        NOAM_FREE_STAT("buffer growth", (buffer->size - size) * buffer->chunk);
+    }
+
     buffer->data = realloc(buffer->data, size * buffer->chunk);
     buffer->size = size;
 }
@@ -82,14 +96,31 @@ void noam_buffer_clear(noam_buffer* buffer){
         }
     }
 
+    if(buffer->size > 1){
+        NOAM_FREE_STAT("buffer growth", (buffer->size - 1) * buffer->chunk);
+    }
+
     buffer->data = realloc(buffer->data, buffer->chunk);
     buffer->length = 0;
     buffer->size = 1;
 }
 
+void noam_buffer_terminate(noam_buffer* buffer){
+    if(buffer->length >= buffer->size){
+        noam_buffer_grow(buffer, NOAM_BUFFER_GROW_FACTOR * buffer->size);
+    }
+    memset(noam_buffer_at(buffer, buffer->length), 0, buffer->chunk);
+}
+
 noam_buffer* noam_buffer_copy(noam_buffer* buffer){
     noam_buffer* copy = malloc(sizeof(noam_buffer));
     copy->data = malloc(buffer->chunk * buffer->size);
+    NOAM_ALLOC_STAT("buffer", sizeof(noam_buffer) + buffer->chunk);
+
+    if(buffer->size > 1){
+        NOAM_ALLOC_STAT("buffer growth", (buffer->size - 1) * buffer->chunk);
+    }
+
     memmove(copy->data, buffer->data, buffer->chunk * buffer->size);
     copy->length = buffer->length;
     copy->size = buffer->size;
@@ -0,0 +1,200 @@
+#include "noam_builtin.h"
+#include "noam_math.h"
+#include "noam_map.h"
+#include "noam_coroutine.h"
+#include "noam_pool.h"
+#include "noam_simd.h"
+
+static const noam_builtin noam_builtins[] = {{"array",       2, &noam_builtin_array},
+                                             {"len",         1, &noam_builtin_len},
+                                             {"sum",         1, &noam_builtin_sum},
+                                             {"min",         1, &noam_builtin_min},
+                                             {"max",         1, &noam_builtin_max},
+                                             {"scale",       2, &noam_builtin_scale},
+                                             {"add",         2, &noam_builtin_add},
+                                             {"dot",         2, &noam_builtin_dot},
+                                             {"fill",        2, &noam_builtin_fill},
+                                             {"sort",        1, &noam_builtin_sort},
+                                             {"vec2",        2, &noam_builtin_vec2},
+                                             {"vec3",        3, &noam_builtin_vec3},
+                                             {"vec4",        4, &noam_builtin_vec4},
+                                             {"mat4",        1, &noam_builtin_mat4},
+                                             {"translation", 3, &noam_builtin_translation},
+                                             {"length",      1, &noam_builtin_length},
+                                             {"normalize",   1, &noam_builtin_normalize},
+                                             {"cross",       2, &noam_builtin_cross},
+                                             {"transpose",   1, &noam_builtin_transpose},
+                                             {"has",         2, &noam_builtin_has},
+                                             {"remove",      2, &noam_builtin_remove},
+                                             {"resume",      1, &noam_builtin_resume},
+                                             {"done",        1, &noam_builtin_done},
+                                             {"pmap",        2, &noam_builtin_pmap}};
+
+const noam_builtin* noam_builtin_find(const noam_buffer* name){
+    for(size_t i = 0; i < sizeof(noam_builtins) / sizeof(noam_builtin); ++i){
+        if(strlen(noam_builtins[i].name) == name->length &&
+           !memcmp(noam_builtins[i].name, name->data, name->length)){
+            return &noam_builtins[i];
+        }
+    }
+    return NULL;
+}
+
+noam_array_value* noam_builtin_array_arg(noam_vm* vm, noam_value* value){
+    if(!noam_value_is_instance(value, NOAM_ARRAY_TOKEN)){
+        noam_vm_error(vm, "argument is not an array");
+    }
+    return (noam_array_value*)value;
+}
+
+/* noam_builtin_pair_arg: checks that both arrays can be processed element-wise */
+void noam_builtin_pair_arg(noam_vm* vm, noam_array_value* lhs, noam_array_value* rhs){
+    if(lhs->elem != rhs->elem || lhs->data->length != rhs->data->length){
+        noam_vm_error(vm, "arrays differ in type or length");
+    }
+}
+
+/* noam_builtin_scalar_arg: converts a number to the element type of `array` */
+void noam_builtin_scalar_arg(noam_vm* vm, noam_array_value* array, noam_value* value, int* int_value, float* float_value){
+    if(noam_value_is_instance(value, NOAM_INT_TOKEN)){
+        *int_value = ((noam_int_value*)value)->value;
+        *float_value = (float)*int_value;
+    } else if(noam_value_is_instance(value, NOAM_FLOAT_TOKEN) && array->elem == NOAM_FLOAT_TOKEN){
+        *float_value = ((noam_float_value*)value)->value;
+    } else {
+        noam_vm_error(vm, "argument does not match the array type");
+    }
+}
+
+noam_array_value* noam_builtin_nonempty_arg(noam_vm* vm, noam_value* value){
+    noam_array_value* array = noam_builtin_array_arg(vm, value);
+
+    if(!array->data->length){
+        noam_vm_error(vm, "array is empty");
+    }
+    return array;
+}
+
+noam_value* noam_builtin_array(noam_vm* vm, noam_value** args, size_t argc){
+    if(!noam_value_is_instance(args[0], NOAM_INT_TOKEN) || ((noam_int_value*)args[0])->value < 0){
+        noam_vm_error(vm, "array length is not a non-negative int");
+    }
+
+    size_t length = (size_t)((noam_int_value*)args[0])->value;
+    noam_token elem = noam_value_is_instance(args[1], NOAM_FLOAT_TOKEN) ? NOAM_FLOAT_TOKEN : NOAM_INT_TOKEN;
+    noam_array_value* array = noam_array_value_create(elem, length);
+    noam_value* fill_args[] = { (noam_value*)array, args[1] };
+
+    return noam_builtin_fill(vm, fill_args, 2);
+}
+
+noam_value* noam_builtin_len(noam_vm* vm, noam_value** args, size_t argc){
+    if(noam_value_is_instance(args[0], NOAM_MAP_TOKEN)){
+        return (noam_value*)noam_int_value_create((int)((noam_map_value*)args[0])->dict->length);
+    }
+    return (noam_value*)noam_int_value_create((int)noam_builtin_array_arg(vm, args[0])->data->length);
+}
+
+noam_value* noam_builtin_sum(noam_vm* vm, noam_value** args, size_t argc){
+    noam_array_value* array = noam_builtin_array_arg(vm, args[0]);
+
+    if(array->elem == NOAM_INT_TOKEN){
+        return (noam_value*)noam_int_value_create(noam_simd_sum_int(array->data->data, array->data->length));
+    }
+    return (noam_value*)noam_float_value_create(noam_simd_sum_float(array->data->data, array->data->length));
+}
+
+noam_value* noam_builtin_min(noam_vm* vm, noam_value** args, size_t argc){
+    noam_array_value* array = noam_builtin_nonempty_arg(vm, args[0]);
+
+    if(array->elem == NOAM_INT_TOKEN){
+        return (noam_value*)noam_int_value_create(noam_simd_min_int(array->data->data, array->data->length));
+    }
+    return (noam_value*)noam_float_value_create(noam_simd_min_float(array->data->data, array->data->length));
+}
+
+noam_value* noam_builtin_max(noam_vm* vm, noam_value** args, size_t argc){
+    noam_array_value* array = noam_builtin_nonempty_arg(vm, args[0]);
+
+    if(array->elem == NOAM_INT_TOKEN){
+        return (noam_value*)noam_int_value_create(noam_simd_max_int(array->data->data, array->data->length));
+    }
+    return (noam_value*)noam_float_value_create(noam_simd_max_float(array->data->data, array->data->length));
+}
+
+noam_value* noam_builtin_scale(noam_vm* vm, noam_value** args, size_t argc){
+    noam_array_value* array = noam_builtin_array_arg(vm, args[0]);
+    int int_factor = 0;
+    float float_factor = 0;
+    noam_array_value_write(array, vm);
+
+    noam_builtin_scalar_arg(vm, array, args[1], &int_factor, &float_factor);
+
+    if(array->elem == NOAM_INT_TOKEN){
+        noam_simd_scale_int(array->data->data, array->data->length, int_factor);
+    } else {
+        noam_simd_scale_float(array->data->data, array->data->length, float_factor);
+    }
+    return (noam_value*)array;
+}
+
+noam_value* noam_builtin_add(noam_vm* vm, noam_value** args, size_t argc){
+    noam_array_value* lhs = noam_builtin_array_arg(vm, args[0]);
+    noam_array_value* rhs = noam_builtin_array_arg(vm, args[1]);
+    noam_array_value_write(lhs, vm);
+
+    noam_builtin_pair_arg(vm, lhs, rhs);
+
+    if(lhs->elem == NOAM_INT_TOKEN){
+        noam_simd_add_int(lhs->data->data, rhs->data->data, lhs->data->length);
+    } else {
+        noam_simd_add_float(lhs->data->data, rhs->data->data, lhs->data->length);
+    }
+    return (noam_value*)lhs;
+}
+
+noam_value* noam_builtin_dot(noam_vm* vm, noam_value** args, size_t argc){
+    if(noam_value_is_instance(args[0], NOAM_VEC_TOKEN)){
+        return noam_math_dot(vm, args[0], args[1]);
+    }
+
+    noam_array_value* lhs = noam_builtin_array_arg(vm, args[0]);
+    noam_array_value* rhs = noam_builtin_array_arg(vm, args[1]);
+
+    noam_builtin_pair_arg(vm, lhs, rhs);
+
+    if(lhs->elem == NOAM_INT_TOKEN){
+        return (noam_value*)noam_int_value_create(
+                noam_simd_dot_int(lhs->data->data, rhs->data->data, lhs->data->length));
+    }
+    return (noam_value*)noam_float_value_create(
+            noam_simd_dot_float(lhs->data->data, rhs->data->data, lhs->data->length));
+}
+
+noam_value* noam_builtin_fill(noam_vm* vm, noam_value** args, size_t argc){
+    noam_array_value* array = noam_builtin_array_arg(vm, args[0]);
+    int int_value = 0;
+    float float_value = 0;
+    noam_array_value_write(array, vm);
+
+    noam_builtin_scalar_arg(vm, array, args[1], &int_value, &float_value);
+
+    if(array->elem == NOAM_INT_TOKEN){
+        noam_simd_fill_int(array->data->data, array->data->length, int_value);
+    } else {
+        noam_simd_fill_float(array->data->data, array->data->length, float_value);
+    }
+    return (noam_value*)array;
+}
+
+noam_value* noam_builtin_sort(noam_vm* vm, noam_value** args, size_t argc){
+    noam_array_value* array = noam_builtin_array_arg(vm, args[0]);
+    noam_array_value_write(array, vm);
+
+    if(array->elem == NOAM_INT_TOKEN){
+        noam_simd_sort_int(array->data->data, array->data->length);
+    } else {
+        noam_simd_sort_float(array->data->data, array->data->length);
+    }
+    return (noam_value*)array;
+}
@@ -0,0 +1,151 @@
+#include "noam_coroutine.h"
+
+noam_value* noam_coroutine_value_get(noam_coroutine_value* value, noam_vm* vm){
+    return (noam_value*)value;
+}
+
+const char* noam_coroutine_value_to_string(noam_coroutine_value* value, noam_vm* vm){
+    snprintf(vm->scratch, NOAM_VM_SCRATCH_LENGTH, "coroutine %s", (const char*)value->func->name->data);
+    return vm->scratch;
+}
+
+void noam_coroutine_value_release(noam_coroutine_value* value){
+    if(value->points){
+        noam_buffer_release(value->points);
+    }
+}
+
+noam_coroutine_value* noam_coroutine_value_create(noam_func* func, noam_value** args){
+    static noam_value_vtable_ noam_coroutine_value_vtable[] = {{&noam_coroutine_value_get,
+                                                                       &noam_coroutine_value_release,
+                                                                       &noam_coroutine_value_to_string,
+                                                                       NOAM_COROUTINE_TOKEN}};
+    NOAM_TRACE(NOAM_TRACE_ALLOC, "noam_coroutine_value_create: %s\n", (char*)func->name->data);
+    noam_coroutine_value* value = malloc(sizeof(noam_coroutine_value) + func->slots * sizeof(noam_value*));
+    NOAM_ALLOC_STAT("noam_coroutine_value", sizeof(noam_coroutine_value) + func->slots * sizeof(noam_value*));
+    memset(value, 0, sizeof(noam_coroutine_value));
+    value->vtable_ = noam_coroutine_value_vtable;
+    value->func = func;
+    value->body = func->body;
+    value->size = func->slots;
+    memcpy(value->slots, args, func->slots * sizeof(noam_value*));
+    return value;
+}
+
+noam_value* noam_coroutine_resume(noam_coroutine_value* coroutine, noam_vm* vm){
+    noam_stack* stack = vm->stack;
+    noam_func* func = coroutine->func;
+
+    if(coroutine->done){
+        return coroutine->value;
+    }
+
+    if(coroutine->running){
+        noam_vm_error(vm, "coroutine %s is already running", (const char*)func->name->data);
+    }
+
+    size_t base = stack->base;
+    size_t frame = noam_stack_push(stack, coroutine->size);
+    memcpy(stack->slots + frame, coroutine->slots, coroutine->size * sizeof(noam_value*));
+
+    coroutine->frame = frame;
+    coroutine->caller = stack->coroutine;
+    coroutine->running = 1;
+    stack->coroutine = coroutine;
+    stack->base = frame;
+    stack->resuming = coroutine->points && coroutine->points->length;
+    noam_stack_enter(stack, func);
+
+    NOAM_TRACE(NOAM_TRACE_CALLS, "%s(...) resume\n", (char*)func->name->data);
+    noam_value* result = noam_statements_run(coroutine->body, vm);
+
+    noam_stack_leave(stack);
+    stack->coroutine = coroutine->caller;
+    stack->returning = 0;
+    coroutine->running = 0;
+
+    if(stack->yielding){
+        stack->yielding = 0;
+        memcpy(coroutine->slots, stack->slots + frame, coroutine->size * sizeof(noam_value*));
+    } else {
+        /* a call returned in tail position finishes the coroutine like an ordinary call */
+        result = noam_func_tail(result, frame, vm);
+        coroutine->done = 1;
+
+        if(!result){
+            result = (noam_value*)noam_nil_value_create();
+        }
+    }
+
+    coroutine->value = result;
+    stack->base = base;
+    noam_stack_pop(stack, frame);
+    return result;
+}
+
+void noam_coroutine_suspend(noam_vm* vm, size_t index, noam_value* iterable, noam_buffer* pairs){
+    noam_coroutine_value* coroutine = vm->stack->coroutine;
+    noam_resume_point point = {index, iterable, pairs};
+
+    if(!coroutine->points){
+        coroutine->points = noam_buffer_create(sizeof(noam_resume_point));
+    }
+    noam_buffer_push(coroutine->points, &point);
+}
+
+noam_resume_point noam_coroutine_point(noam_vm* vm){
+    noam_buffer* points = vm->stack->coroutine->points;
+    return *(noam_resume_point*)noam_buffer_at(points, --points->length);
+}
+
+noam_value* noam_yield_statement_run(noam_yield_statement* statement, noam_vm* vm){
+    noam_stack* stack = vm->stack;
+
+    if(!stack->coroutine || stack->coroutine->frame != stack->base){
+        noam_vm_error(vm, "yield outside of a coroutine");
+    }
+
+    /* the resumed coroutine goes on after the yield */
+    if(stack->resuming){
+        stack->resuming = 0;
+        return NULL;
+    }
+
+    noam_value* value = statement->expression ? noam_expression_get(statement->expression, vm) :
+                                                (noam_value*)noam_nil_value_create();
+    stack->returning = 1;
+    stack->yielding = 1;
+    return value;
+}
+
+void noam_yield_statement_release(noam_yield_statement* statement){
+    if(statement->expression){
+        noam_expression_release(statement->expression);
+    }
+}
+
+noam_yield_statement* noam_yield_statement_create(noam_expression* expression){
+    static noam_statement_vtable_ noam_yield_statement_vtable[] = {{&noam_yield_statement_run,
+                                                                    &noam_yield_statement_release}};
+    NOAM_TRACE(NOAM_TRACE_PARSER, "noam_yield_statement_create\n");
+    noam_yield_statement* statement = malloc(sizeof(noam_yield_statement));
+    NOAM_ALLOC_STAT("noam_yield_statement", sizeof(noam_yield_statement));
+    statement->vtable_ = noam_yield_statement_vtable;
+    statement->expression = expression;
+    return statement;
+}
+
+noam_coroutine_value* noam_builtin_coroutine_arg(noam_vm* vm, noam_value* value){
+    if(!noam_value_is_instance(value, NOAM_COROUTINE_TOKEN)){
+        noam_vm_error(vm, "argument is not a coroutine");
+    }
+    return (noam_coroutine_value*)value;
+}
+
+noam_value* noam_builtin_resume(noam_vm* vm, noam_value** args, size_t argc){
+    return noam_coroutine_resume(noam_builtin_coroutine_arg(vm, args[0]), vm);
+}
+
+noam_value* noam_builtin_done(noam_vm* vm, noam_value** args, size_t argc){
+    return (noam_value*)noam_bool_value_create(noam_builtin_coroutine_arg(vm, args[0])->done);
+}
@@ -1,15 +1,26 @@
 #include "noam_dict.h"
 
+#define NOAM_DICT_INITIAL_SIZE 8
+#define NOAM_DICT_GROW_FACTOR 2
+
+/* maximum load factor as a fraction, Robin Hood probing keeps lookups short up to it */
+#define NOAM_DICT_MAX_LOAD_NUM 3
+#define NOAM_DICT_MAX_LOAD_DEN 4
+
+/* two extra slots past the end of the table are used as a scratch space for swapping */
+#define NOAM_DICT_SCRATCH_SLOTS 2
+
 noam_dict* noam_dict_createv(size_t key_chunk, size_t val_chunk,
                              noam_hash_func hash, noam_cmp_func cmp,
                              noam_release_func release){
+    const size_t align = sizeof(size_t);
     noam_dict* dict = malloc(sizeof(noam_dict));
-    dict->nodes = malloc(sizeof(noam_dict_node));
-    memset(dict->nodes, 0, sizeof(noam_dict_node));
+    dict->nodes = NULL;
     dict->key_chunk = key_chunk;
     dict->val_chunk = val_chunk;
+    dict->stride = (sizeof(noam_dict_node) + key_chunk + val_chunk + align - 1) / align * align;
     dict->length = 0;
-    dict->size = 1;
+    dict->size = 0;
     dict->hash = hash;
     dict->cmp = cmp;
     dict->release = release;
@@ -20,66 +31,167 @@ noam_dict* noam_dict_create(size_t key_chunk, size_t val_chunk, noam_hash_func h
     return noam_dict_createv(key_chunk, val_chunk, hash, NULL, NULL);
 }
 
-noam_dict_node* noam_dict_node_create(noam_dict* dict, void* key, void* value){
-    noam_dict_node* node = malloc(sizeof(node));
-    node->data = malloc(dict->key_chunk + dict->val_chunk);
-    if(key){
-        memcpy(node->data, key, dict->key_chunk);
+noam_dict_node* noam_dict_node_at(noam_dict* dict, size_t index){
+    return (noam_dict_node*)(dict->nodes + index * dict->stride);
+}
+
+size_t noam_dict_home(size_t hash, size_t size){
+    unsigned long long h = hash;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return (size_t)h & (size - 1);
+}
+
+int noam_dict_node_equal(noam_dict* dict, noam_dict_node* node, size_t hash, void* key){
+    if(node->hash != hash)
+        return 0;
+    if(dict->cmp)
+        return dict->cmp(node->data, key) == 0;
+    return memcmp(node->data, key, dict->key_chunk) == 0;
+}
+
+/* noam_dict_place: moves a scratch entry into the table, displacing richer entries on the way */
+void noam_dict_place(noam_dict* dict, noam_dict_node* entry){
+    noam_dict_node* swap = noam_dict_node_at(dict, dict->size + 1);
+    size_t index = noam_dict_home(entry->hash, dict->size);
+
+    entry->probe = 1;
+
+    for(;;){
+        noam_dict_node* node = noam_dict_node_at(dict, index);
+
+        if(!node->probe){
+            memcpy(node, entry, dict->stride);
+            return;
+        }
+
+        if(node->probe < entry->probe){
+            memcpy(swap, node, dict->stride);
+            memcpy(node, entry, dict->stride);
+            memcpy(entry, swap, dict->stride);
+        }
+
+        ++entry->probe;
+        index = (index + 1) & (dict->size - 1);
     }
-    if(value){
-        memcpy(node->data + dict->key_chunk, value, dict->val_chunk);
+}
+
+void noam_dict_grow(noam_dict* dict, size_t size){
+    char* nodes = dict->nodes;
+    size_t old_size = dict->size;
+
+    dict->nodes = calloc(size + NOAM_DICT_SCRATCH_SLOTS, dict->stride);
+    NOAM_ALLOC_STAT("dict nodes", (size + NOAM_DICT_SCRATCH_SLOTS) * dict->stride);
+    dict->size = size;
+
+    noam_dict_node* entry = noam_dict_node_at(dict, size);
+
+    for(size_t i = 0; i < old_size; ++i){
+        noam_dict_node* node = (noam_dict_node*)(nodes + i * dict->stride);
+
+        if(node->probe){
+            memcpy(entry, node, dict->stride);
+            noam_dict_place(dict, entry);
+        }
+    }
+
+    if(nodes){
+        NOAM_FREE_STAT("dict nodes", (old_size + NOAM_DICT_SCRATCH_SLOTS) * dict->stride);
+    }
+    free(nodes);
+}
+
+noam_dict_node* noam_dict_find_hashed(noam_dict* dict, void* key, size_t hash){
+    if(!dict->length){
+        return NULL;
+    }
+
+    size_t index = noam_dict_home(hash, dict->size);
+
+    for(size_t probe = 1;; ++probe){
+        noam_dict_node* node = noam_dict_node_at(dict, index);
+
+        /* an entry would have displaced any slot closer to its home */
+        if(node->probe < probe)
+            return NULL;
+        if(noam_dict_node_equal(dict, node, hash, key))
+            return node;
+
+        index = (index + 1) & (dict->size - 1);
     }
-    node->next = NULL;
-    return node;
 }
 
 void noam_dict_insert(noam_dict* dict, void* key, void* value){
-    //TODO: Rehash on purpose
-    size_t hash = dict->hash(key) % dict->size;
-    noam_dict_node* node = &dict->nodes[hash];
-
-    if(dict->cmp){
-        while(node->next){
-            if(dict->cmp(node->next->data, key) == 0){
-                memcpy(node->next->data + dict->key_chunk, value, dict->val_chunk);
-                return;
-            }
-            node = node->next;
-        }
-    } else {
-        while(node->next){
-            if(memcmp(node->next->data, key, dict->key_chunk) == 0){
-                memcpy(node->next->data + dict->key_chunk, value, dict->val_chunk);
-                return;
-            }
-            node = node->next;
-        }
+    size_t hash = dict->hash(key);
+    noam_dict_node* node = noam_dict_find_hashed(dict, key, hash);
+
+    if(node){
+        memcpy(node->data + dict->key_chunk, value, dict->val_chunk);
+        return;
+    }
+
+    if(!dict->size){
+        noam_dict_grow(dict, NOAM_DICT_INITIAL_SIZE);
+    } else if((dict->length + 1) * NOAM_DICT_MAX_LOAD_DEN > dict->size * NOAM_DICT_MAX_LOAD_NUM){
+        noam_dict_grow(dict, NOAM_DICT_GROW_FACTOR * dict->size);
     }
 
-    if(!node->next){
-        node->next = noam_dict_node_create(dict, key, value);
+    noam_dict_node* entry = noam_dict_node_at(dict, dict->size);
+    entry->hash = hash;
+    memcpy(entry->data, key, dict->key_chunk);
+    if(value){
+        memcpy(entry->data + dict->key_chunk, value, dict->val_chunk);
+    } else {
+        memset(entry->data + dict->key_chunk, 0, dict->val_chunk);
     }
+
+    noam_dict_place(dict, entry);
+    ++dict->length;
 }
 
 noam_dict_node* noam_dict_find(noam_dict* dict, void* key){
-    size_t hash = dict->hash(key) % dict->size;
-    noam_dict_node* node = dict->nodes[hash].next;
-
-    if(dict->cmp){
-        while(node){
-            if(dict->cmp(node->data, key) == 0)
-                return node;
-            node = node->next;
-        }
+    if(!dict->length){
         return NULL;
-    } else {
-        while(node){
-            if(memcmp(node->data, key, dict->key_chunk) == 0)
-                return node;
-            node = node->next;
+    }
+    return noam_dict_find_hashed(dict, key, dict->hash(key));
+}
+
+int noam_dict_remove(noam_dict* dict, void* key){
+    noam_dict_node* node = noam_dict_find(dict, key);
+
+    if(!node){
+        return 0;
+    }
+
+    if(dict->release){
+        dict->release(node->data);
+    }
+
+    size_t index = (size_t)((char*)node - dict->nodes) / dict->stride;
+
+    /* backward shift deletion keeps the probe sequences without tombstones */
+    for(;;){
+        size_t next_index = (index + 1) & (dict->size - 1);
+        noam_dict_node* next = noam_dict_node_at(dict, next_index);
+
+        if(next->probe <= 1){
+            break;
         }
-        return NULL;
+
+        memcpy(node, next, dict->stride);
+        --node->probe;
+        node = next;
+        index = next_index;
     }
+
+    node->probe = 0;
+    --dict->length;
+    return 1;
+}
+
+void* noam_dict_key(noam_dict_node* node){
+    return node->data;
 }
 
 void* noam_dict_value(noam_dict* dict, noam_dict_node* node){
@@ -89,36 +201,46 @@ void* noam_dict_value(noam_dict* dict, noam_dict_node* node){
 void noam_dict_release(noam_dict* dict){
     if(dict->release){
         for(size_t i = 0; i < dict->size; ++i){
-            noam_dict_node* node = dict->nodes[i].next;
+            noam_dict_node* node = noam_dict_node_at(dict, i);
 
-            while(node){
-                noam_dict_node* next = node->next;
+            if(node->probe){
                 dict->release(node->data);
-                free(node);
-                node = next;
             }
         }
     }
 
+    if(dict->nodes){
+        NOAM_FREE_STAT("dict nodes", (dict->size + NOAM_DICT_SCRATCH_SLOTS) * dict->stride);
+    }
     free(dict->nodes);
     free(dict);
 }
 
 size_t noam_hash_string(const noam_buffer* str){
     size_t hash = 5381;
-    const char* s = str->data;
+    const unsigned char* s = str->data;
 
-    while(*s){
-        hash = ((hash << 5) + hash) + *(s++);
+    for(size_t i = 0; i < str->length; ++i){
+        hash = ((hash << 5) + hash) + s[i];
     }
 
     return hash;
 }
 
 int noam_cmp_string(const noam_buffer* lhs, const noam_buffer* rhs){
+    if(!lhs && !rhs)
+        return 0;
     if(!lhs && rhs)
         return -1;
     if(lhs && !rhs)
         return 1;
-    return strcmp(lhs->data, rhs->data);
-}
\ No newline at end of file
+
+    size_t length = lhs->length < rhs->length ? lhs->length : rhs->length;
+    int cmp = memcmp(lhs->data, rhs->data, length);
+
+    if(cmp)
+        return cmp < 0 ? -1 : 1;
+    if(lhs->length == rhs->length)
+        return 0;
+    return lhs->length < rhs->length ? -1 : 1;
+}
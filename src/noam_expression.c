@@ -1,15 +1,20 @@
 #include "noam_expression.h"
+#include "noam_builtin.h"
+#include "noam_math.h"
+#include "noam_map.h"
+#include "noam_coroutine.h"
+#include "noam_parser.h"
 
 #define NOAM_CHAR_BIT 8
 #define NOAM_INT_CHAR_LENGTH ((NOAM_CHAR_BIT * sizeof(int) - 1) / 3 + 2)
 #define NOAM_FLOAT_CHAR_LENGTH ((NOAM_CHAR_BIT * sizeof(float) - 1) / 3 + 2)
 
-noam_value* noam_expression_get(noam_expression* expression){
-    return expression->vtable_->get(expression);
+noam_value* noam_expression_get(noam_expression* expression, noam_vm* vm){
+    return expression->vtable_->get(expression, vm);
 }
 
-const char* noam_value_to_string(noam_value* value){
-    return value->vtable_->to_string(value);
+const char* noam_value_to_string(noam_value* value, noam_vm* vm){
+    return value->vtable_->to_string(value, vm);
 }
 
 void noam_expression_release(noam_expression* expression){
@@ -18,72 +23,143 @@ void noam_expression_release(noam_expression* expression){
     }
 }
 
-noam_value* noam_variable_expression_get(noam_variable_expression* expression){
-    noam_scope* scope = expression->scope;
-    noam_dict_node* node = NULL;
+noam_value* noam_variable_expression_get(noam_variable_expression* expression, noam_vm* vm){
+    noam_stack* stack = vm->stack;
+    noam_value* value = stack->slots[(expression->global ? 0 : stack->base) + expression->slot];
 
-    while(scope){
-        if((node = noam_dict_find(scope->vars, expression->name)))
-            break;
-        scope = scope->parent;
+    if(!value){
+        noam_vm_error(vm, "unknown variable %s", (const char*)expression->name->data);
     }
 
-    if(!node){
-        fprintf(stderr, "noam: unknown variable %s", (const char*)expression->name->data);
-        exit(-1);
-        //TODO: Error
-    }
-    noam_expression** value = noam_dict_value(expression->scope->vars, node);
-    return noam_expression_get(*value);
+    noam_value_share(value);
+    return value;
 }
 
 void noam_variable_expression_release(noam_variable_expression* expression){
     noam_buffer_release(expression->name);
 }
 
-noam_value* noam_func_call_expression_get(noam_func_call_expression* expression){
+noam_func* noam_func_call_expression_func(noam_func_call_expression* expression, noam_vm* vm){
     noam_dict_node* node = noam_dict_find(expression->symbol_table->funcs, expression->name);
 
     if(!node){
-        //TODO: Error
-        fprintf(stderr, "unknown function %s", (const char*)expression->name->data);
-        exit(-1);
+        noam_vm_error(vm, "unknown function %s", (const char*)expression->name->data);
     }
 
-    noam_func* func = noam_dict_value(expression->symbol_table->funcs, node);
-
-    //TODO: Find scope
-    noam_scope* scope = expression->symbol_table->head->child;
+    noam_func* func = *(noam_func**)noam_dict_value(expression->symbol_table->funcs, node);
 
-    while(scope){
-        if(noam_cmp_string(expression->name, scope->name) == 0){
-            break;
-        }
-        scope = scope->next;
+    if(expression->args->length != func->params->length){
+        noam_vm_error(vm, "function params mismatch: args=%lu params=%lu", expression->args->length, func->params->length);
     }
 
-    if(!scope){
-        //TODO: Error
-        fprintf(stderr, "cannot find a function scope");
-        exit(-1);
+    return func;
+}
+
+noam_value* noam_func_call_expression_get(noam_func_call_expression* expression, noam_vm* vm){
+    noam_func* func = expression->func;
+
+    /* an unknown function or a redefinition with other params is reported by the lookup */
+    if(!func || expression->args->length != func->params->length){
+        func = noam_func_call_expression_func(expression, vm);
     }
 
-    if(expression->args->length != func->params->length){
-        //TODO: Error
-        fprintf(stderr, "function params mismatch: args=%lu params=%lu", expression->args->length, func->params->length);
-        exit(-1);
+    /* a lazy vm parses the body on the first call, the frame size is known then */
+    if(func->tokens){
+        noam_func_compile(func, vm);
     }
 
+    noam_stack* stack = vm->stack;
+    size_t frame = noam_stack_push(stack, func->slots);
+
+    /* arguments are evaluated in the caller frame, the stack may grow meanwhile */
     for(size_t i = 0; i < expression->args->length; ++i){
-        noam_buffer* param = noam_buffer_at(func->params, i);
         noam_expression** arg = noam_buffer_at(expression->args, i);
-        noam_dict_insert(scope->vars, param, arg);
+        noam_value* value = noam_expression_get(*arg, vm);
+        stack->slots[frame + i] = value;
+    }
+
+    if(expression->tail){
+        stack->tail = func;
+        stack->tail_frame = frame;
+        return expression->unwind;
+    }
+
+    return noam_func_call(func, frame, vm);
+}
+
+noam_value* noam_func_call(noam_func* func, size_t frame, noam_vm* vm){
+    noam_stack* stack = vm->stack;
+    size_t base = stack->base;
+    stack->base = frame;
+    noam_stack_enter(stack, func);
+
+    noam_value* result = noam_func_tail(noam_func_body(func, frame, vm), frame, vm);
+
+    noam_stack_leave(stack);
+    stack->base = base;
+    noam_stack_pop(stack, frame);
+    return result;
+}
+
+noam_value* noam_func_body(noam_func* func, size_t frame, noam_vm* vm){
+    if(func->coroutine){
+        return (noam_value*)noam_coroutine_value_create(func, vm->stack->slots + frame);
+    }
+
+    NOAM_TRACE(NOAM_TRACE_CALLS, "%s(...) call\n", (char*)func->name->data);
+    noam_value* result = noam_statements_run(func->body, vm);
+    vm->stack->returning = 0;
+    return result;
+}
+
+noam_value* noam_func_tail(noam_value* result, size_t frame, noam_vm* vm){
+    noam_stack* stack = vm->stack;
+
+    /* a pending tail call moves its arguments down to this frame and runs in the same loop */
+    while(stack->tail){
+        noam_func* func = stack->tail;
+        stack->tail = NULL;
+
+        /* the callee takes over the call site of the caller as well */
+        if(stack->depth < NOAM_STACK_CALLS){
+            stack->calls[stack->depth].func = func;
+        }
+
+        size_t params = func->params->length;
+        memmove(stack->slots + frame, stack->slots + stack->tail_frame, params * sizeof(noam_value*));
+        noam_stack_pop(stack, frame + params);
+        noam_stack_push(stack, func->slots - params);
+
+        result = noam_func_body(func, frame, vm);
     }
 
-#ifdef NOAM_DEBUG
-    printf("%s(...) call\n", (char*)func->name->data);
-#endif
-    return noam_statements_run(func->body);
+    return result;
+}
+
+void noam_func_call_expression_link(noam_symbol_table* symbol_table){
+    size_t unresolved = 0;
+
+    for(size_t i = 0; i < symbol_table->calls->length; ++i){
+        noam_func_call_expression* expression = *(noam_func_call_expression**)noam_buffer_at(symbol_table->calls, i);
+        noam_dict_node* node = noam_dict_find(symbol_table->funcs, expression->name);
+
+        if(node){
+            expression->func = *(noam_func**)noam_dict_value(symbol_table->funcs, node);
+        } else {
+            *(noam_func_call_expression**)noam_buffer_at(symbol_table->calls, unresolved++) = expression;
+        }
+    }
+
+    symbol_table->calls->length = unresolved;
+}
+
+int noam_expression_is_func_call(const noam_expression* expression){
+    return expression->vtable_->get == (noam_expression_get_func)&noam_func_call_expression_get;
+}
+
+void noam_func_call_expression_tail(noam_func_call_expression* expression){
+    expression->tail = 1;
+    expression->unwind = (noam_value*)noam_nil_value_create();
 }
 
 void noam_func_call_expression_release(noam_func_call_expression* expression){
@@ -92,27 +168,25 @@ void noam_func_call_expression_release(noam_func_call_expression* expression){
     noam_buffer_release(expression->args);
 }
 
-noam_value* noam_int_value_get(noam_int_value* value){
+noam_value* noam_int_value_get(noam_int_value* value, noam_vm* vm){
     return value;
 }
 
-const char* noam_int_value_to_string(noam_int_value* value){
-    static char str[NOAM_INT_CHAR_LENGTH];
-    sprintf(str, "%d", value->value);
-    return str;
+const char* noam_int_value_to_string(noam_int_value* value, noam_vm* vm){
+    snprintf(vm->scratch, NOAM_INT_CHAR_LENGTH, "%d", value->value);
+    return vm->scratch;
 }
 
-noam_value* noam_float_value_get(noam_float_value* value){
+noam_value* noam_float_value_get(noam_float_value* value, noam_vm* vm){
     return value;
 }
 
-const char* noam_float_value_to_string(noam_float_value* value){
-    static char str[NOAM_FLOAT_CHAR_LENGTH];
-    sprintf(str, "%f", value->value);
-    return str;
+const char* noam_float_value_to_string(noam_float_value* value, noam_vm* vm){
+    snprintf(vm->scratch, NOAM_VM_SCRATCH_LENGTH, "%f", value->value);
+    return vm->scratch;
 }
 
-noam_value* noam_string_value_get(noam_string_value* value){
+noam_value* noam_string_value_get(noam_string_value* value, noam_vm* vm){
     return value;
 }
 
@@ -120,15 +194,15 @@ void noam_string_value_release(noam_string_value* value){
     noam_buffer_release(value->str);
 }
 
-const char* noam_string_value_to_string(noam_string_value* value){
+const char* noam_string_value_to_string(noam_string_value* value, noam_vm* vm){
     return value->str->data;
 }
 
-noam_value* noam_bool_value_get(noam_bool_value* value){
+noam_value* noam_bool_value_get(noam_bool_value* value, noam_vm* vm){
     return value;
 }
 
-const char* noam_bool_value_to_string(noam_bool_value* value){
+const char* noam_bool_value_to_string(noam_bool_value* value, noam_vm* vm){
     return value->value == 1 ? NOAM_TRUE_STR : NOAM_FALSE_STR;
 }
 
@@ -139,13 +213,12 @@ int noam_value_is_instance(const noam_value* value, noam_token type){
 noam_variable_expression* noam_variable_expression_create(noam_buffer* name, noam_scope* scope){
     static noam_expression_vtable_ noam_variable_expression_vtable[] = {{&noam_variable_expression_get,
                                                                                 &noam_variable_expression_release}};
-#ifdef NOAM_DEBUG
-    printf("noam_variable_expression_create: %s\n", (char*)name->data);
-#endif
+    NOAM_TRACE(NOAM_TRACE_PARSER, "noam_variable_expression_create: %s\n", (char*)name->data);
     noam_variable_expression* expression = malloc(sizeof(noam_variable_expression));
+    NOAM_ALLOC_STAT("noam_variable_expression", sizeof(noam_variable_expression));
     expression->vtable_ = noam_variable_expression_vtable;
     expression->name = name;
-    expression->scope = scope;
+    expression->slot = noam_scope_lookup(scope, name, &expression->global);
     return expression;
 }
 
@@ -153,14 +226,17 @@ noam_func_call_expression* noam_func_call_expression_create(
         noam_buffer* name, noam_buffer* args, noam_symbol_table* symbol_table){
     static noam_expression_vtable_ noam_func_call_expression_vtable[] = {{&noam_func_call_expression_get,
                                                                                  &noam_func_call_expression_release}};
-#ifdef NOAM_DEBUG
-    printf("noam_func_call_expression_create: %s\n", (char*)name->data);
-#endif
+    NOAM_TRACE(NOAM_TRACE_PARSER, "noam_func_call_expression_create: %s\n", (char*)name->data);
     noam_func_call_expression* expression = malloc(sizeof(noam_func_call_expression));
+    NOAM_ALLOC_STAT("noam_func_call_expression", sizeof(noam_func_call_expression));
     expression->vtable_ = noam_func_call_expression_vtable;
     expression->name = name;
     expression->args = args;
     expression->symbol_table = symbol_table;
+    expression->func = NULL;
+    expression->tail = 0;
+    expression->unwind = NULL;
+    noam_buffer_push(symbol_table->calls, &expression);
     return expression;
 }
 
@@ -169,12 +245,12 @@ noam_int_value* noam_int_value_create(int value){
                                                                  NULL,
                                                                  &noam_int_value_to_string,
                                                                  NOAM_INT_TOKEN}};
-#ifdef NOAM_DEBUG
-    printf("noam_int_value_create: %d\n", value);
-#endif
+    NOAM_TRACE(NOAM_TRACE_ALLOC, "noam_int_value_create: %d\n", value);
     noam_int_value* int_value = malloc(sizeof(noam_int_value));
+    NOAM_ALLOC_STAT("noam_int_value", sizeof(noam_int_value));
     int_value->vtable_ = noam_int_value_vtable;
     int_value->value = value;
+    int_value->owned = 0;
     return int_value;
 }
 
@@ -183,12 +259,12 @@ noam_float_value* noam_float_value_create(float value){
                                                                    NULL,
                                                                    &noam_float_value_to_string,
                                                                    NOAM_FLOAT_TOKEN}};
-#ifdef NOAM_DEBUG
-    printf("noam_float_value_create: %f\n", value);
-#endif
+    NOAM_TRACE(NOAM_TRACE_ALLOC, "noam_float_value_create: %f\n", value);
     noam_float_value* float_value = malloc(sizeof(noam_float_value));
+    NOAM_ALLOC_STAT("noam_float_value", sizeof(noam_float_value));
     float_value->vtable_ = noam_float_value_vtable;
     float_value->value = value;
+    float_value->owned = 0;
     return float_value;
 }
 
@@ -197,13 +273,16 @@ noam_string_value* noam_string_value_create(noam_buffer* str){
                                                                     &noam_string_value_release,
                                                                     &noam_string_value_to_string,
                                                                     NOAM_STRING_TOKEN}};
-#ifdef NOAM_DEBUG
-    printf("noam_string_value_create: %s\n", (char*)str->data);
-#endif
+    NOAM_TRACE(NOAM_TRACE_ALLOC, "noam_string_value_create: %s\n", (char*)str->data);
     noam_string_value* string_value = malloc(sizeof(noam_string_value));
+    NOAM_ALLOC_STAT("noam_string_value", sizeof(noam_string_value));
     string_value->vtable_ = noam_string_value_vtable;
     string_value->str = noam_buffer_create(1);
     noam_buffer_merge(string_value->str, str);
+    noam_buffer_terminate(string_value->str);
+    string_value->hash = 0;
+    string_value->hashed = 0;
+    string_value->owned = 0;
     return string_value;
 }
 
@@ -212,26 +291,56 @@ noam_bool_value* noam_bool_value_create(int value){
                                                                   NULL,
                                                                   &noam_bool_value_to_string,
                                                                   NOAM_BOOL_TOKEN}};
-#ifdef NOAM_DEBUG
-    printf("noam_bool_value_create: %d\n", value);
-#endif
+    NOAM_TRACE(NOAM_TRACE_ALLOC, "noam_bool_value_create: %d\n", value);
     noam_bool_value* bool_value = malloc(sizeof(noam_bool_value));
+    NOAM_ALLOC_STAT("noam_bool_value", sizeof(noam_bool_value));
     bool_value->vtable_ = noam_bool_value_vtable;
     bool_value->value = value;
     return bool_value;
 }
 
+void noam_value_share(noam_value* value){
+    /* written only when set, so vms on other threads reading shared values don't race */
+    switch(value->vtable_->type){
+        case NOAM_INT_TOKEN:
+            if(((noam_int_value*)value)->owned){
+                ((noam_int_value*)value)->owned = 0;
+            }
+            break;
+        case NOAM_FLOAT_TOKEN:
+            if(((noam_float_value*)value)->owned){
+                ((noam_float_value*)value)->owned = 0;
+            }
+            break;
+        case NOAM_STRING_TOKEN:
+            if(((noam_string_value*)value)->owned){
+                ((noam_string_value*)value)->owned = 0;
+            }
+            break;
+        default:
+            break;
+    }
+}
+
 int noam_values_equal_type(const noam_value* lhs, const noam_value* rhs, noam_token type){
     return noam_value_is_instance(lhs, type) && noam_value_is_instance(rhs, type);
 }
 
-noam_value* noam_op_expression_get(noam_op_expression* expression){
-    //printf("op: %s\n", (char*)expression->op->data);
-    noam_value* lhs = noam_expression_get(expression->lhs);
-    noam_value* rhs = noam_expression_get(expression->rhs);
+/* noam_op_compare: evaluates <, >, <= or >=, ints convert to doubles exactly */
+int noam_op_compare(const char* op, double lhs, double rhs){
+    if(op[1] == '='){
+        return op[0] == '<' ? lhs <= rhs : lhs >= rhs;
+    }
+    return op[0] == '<' ? lhs < rhs : lhs > rhs;
+}
+
+noam_value* noam_op_values(noam_vm* vm, const char* op, noam_value* lhs, noam_value* rhs){
+    if(noam_math_is_instance(lhs) || noam_math_is_instance(rhs)){
+        return noam_math_op(vm, op, lhs, rhs);
+    }
 
     //TODO: Type cast
-    if(!strcmp(expression->op->data, NOAM_PLUS_STR)) {
+    if(!strcmp(op, NOAM_PLUS_STR)) {
         if (noam_values_equal_type(lhs, rhs, NOAM_FLOAT_TOKEN)){
             return noam_float_value_create(((noam_float_value*)lhs)->value + ((noam_float_value*)rhs)->value);
         } else if (noam_values_equal_type(lhs, rhs, NOAM_INT_TOKEN)){
@@ -246,21 +355,21 @@ noam_value* noam_op_expression_get(noam_op_expression* expression){
         }
 
         //TODO: Error
-    } else if(!strcmp(expression->op->data, NOAM_MINUS_STR)) {
+    } else if(!strcmp(op, NOAM_MINUS_STR)) {
         if (noam_values_equal_type(lhs, rhs, NOAM_FLOAT_TOKEN)){
             return noam_float_value_create(((noam_float_value*)lhs)->value - ((noam_float_value*)rhs)->value);
         } else if (noam_values_equal_type(lhs, rhs, NOAM_INT_TOKEN)){
             return noam_int_value_create(((noam_int_value*)lhs)->value - ((noam_int_value*)rhs)->value);
         }
         //TODO: Error
-    } else if(!strcmp(expression->op->data, NOAM_MULT_STR)) {
+    } else if(!strcmp(op, NOAM_MULT_STR)) {
         if (noam_values_equal_type(lhs, rhs, NOAM_FLOAT_TOKEN)){
             return noam_float_value_create(((noam_float_value*)lhs)->value * ((noam_float_value*)rhs)->value);
         } else if (noam_values_equal_type(lhs, rhs, NOAM_INT_TOKEN)){
             return noam_int_value_create(((noam_int_value*)lhs)->value * ((noam_int_value*)rhs)->value);
         }
         //TODO: Error
-    } else if(!strcmp(expression->op->data, NOAM_DIV_STR)) {
+    } else if(!strcmp(op, NOAM_DIV_STR)) {
         if (noam_values_equal_type(lhs, rhs, NOAM_FLOAT_TOKEN)){
             if(((noam_float_value*)rhs)->value == 0){
                 //TODO: Error
@@ -268,12 +377,12 @@ noam_value* noam_op_expression_get(noam_op_expression* expression){
             return noam_float_value_create(((noam_float_value*)lhs)->value / ((noam_float_value*)rhs)->value);
         } else if (noam_values_equal_type(lhs, rhs, NOAM_INT_TOKEN)){
             if(((noam_int_value*)rhs)->value == 0){
-                //TODO: Error
+                noam_vm_error(vm, "division by zero");
             }
             return noam_int_value_create(((noam_int_value*)lhs)->value / ((noam_int_value*)rhs)->value);
         }
         //TODO: Error
-    } else if(!strcmp(expression->op->data, NOAM_EQ2_STR)){
+    } else if(!strcmp(op, NOAM_EQ2_STR)){
         if (noam_values_equal_type(lhs, rhs, NOAM_FLOAT_TOKEN)){
             return noam_bool_value_create(((noam_float_value*)lhs)->value == ((noam_float_value*)rhs)->value);
         } else if (noam_values_equal_type(lhs, rhs, NOAM_INT_TOKEN)){
@@ -282,7 +391,7 @@ noam_value* noam_op_expression_get(noam_op_expression* expression){
             return noam_bool_value_create(((noam_bool_value*)lhs)->value == ((noam_bool_value*)rhs)->value);
         }
         //TODO: Error
-    } else if(!strcmp(expression->op->data, NOAM_NEQ_STR)){
+    } else if(!strcmp(op, NOAM_NEQ_STR)){
         if (noam_values_equal_type(lhs, rhs, NOAM_FLOAT_TOKEN)){
             return noam_bool_value_create(((noam_float_value*)lhs)->value != ((noam_float_value*)rhs)->value);
         } else if (noam_values_equal_type(lhs, rhs, NOAM_INT_TOKEN)){
@@ -291,12 +400,26 @@ noam_value* noam_op_expression_get(noam_op_expression* expression){
             return noam_bool_value_create(((noam_bool_value*)lhs)->value != ((noam_bool_value*)rhs)->value);
         }
         //TODO: Error
+    } else if(op[0] == '<' || op[0] == '>'){
+        if (noam_values_equal_type(lhs, rhs, NOAM_FLOAT_TOKEN)){
+            return noam_bool_value_create(noam_op_compare(op, ((noam_float_value*)lhs)->value,
+                                                          ((noam_float_value*)rhs)->value));
+        } else if (noam_values_equal_type(lhs, rhs, NOAM_INT_TOKEN)){
+            return noam_bool_value_create(noam_op_compare(op, ((noam_int_value*)lhs)->value,
+                                                          ((noam_int_value*)rhs)->value));
+        }
     }
 
-    //TODO: Error
+    noam_vm_error(vm, "unsupported operands for %s", op);
     return NULL;
 }
 
+noam_value* noam_op_expression_get(noam_op_expression* expression, noam_vm* vm){
+    noam_value* lhs = noam_expression_get(expression->lhs, vm);
+    noam_value* rhs = noam_expression_get(expression->rhs, vm);
+    return noam_op_values(vm, expression->op->data, lhs, rhs);
+}
+
 void noam_op_expression_release(noam_op_expression* expression){
     //TODO
 }
@@ -304,10 +427,9 @@ void noam_op_expression_release(noam_op_expression* expression){
 noam_op_expression* noam_op_expression_create(noam_expression* lhs, noam_buffer* op, noam_expression* rhs){
     static noam_expression_vtable_ noam_op_expression_vtable[] = {{&noam_op_expression_get,
                                                                           &noam_op_expression_release}};
-#ifdef NOAM_DEBUG
-    printf("noam_op_expression_create: %s\n", (char*)op->data);
-#endif
+    NOAM_TRACE(NOAM_TRACE_PARSER, "noam_op_expression_create: %s\n", (char*)op->data);
     noam_op_expression* expression = malloc(sizeof(noam_op_expression));
+    NOAM_ALLOC_STAT("noam_op_expression", sizeof(noam_op_expression));
     expression->vtable_ = noam_op_expression_vtable;
     expression->lhs = lhs;
     expression->op = op;
@@ -320,18 +442,217 @@ noam_nil_value* noam_nil_value_create(){
                                                                    NULL,
                                                                    &noam_nil_value_to_string,
                                                                    NOAM_NIL_TOKEN}};
-#ifdef NOAM_DEBUG
-    printf("noam_nil_value_create\n");
-#endif
+    NOAM_TRACE(NOAM_TRACE_ALLOC, "noam_nil_value_create\n");
     noam_nil_value* nil_value = malloc(sizeof(noam_nil_value));
+    NOAM_ALLOC_STAT("noam_nil_value", sizeof(noam_nil_value));
     nil_value->vtable_ = noam_nil_value_vtable;
     return nil_value;
 }
 
-const char* noam_nil_value_to_string(noam_nil_value* value){
+const char* noam_nil_value_to_string(noam_nil_value* value, noam_vm* vm){
     return "nil";
 }
 
-noam_value* noam_nil_value_get(noam_nil_value* value){
+noam_value* noam_nil_value_get(noam_nil_value* value, noam_vm* vm){
     return value;
-}
\ No newline at end of file
+}
+noam_value* noam_array_value_get(noam_array_value* value, noam_vm* vm){
+    return value;
+}
+
+void* noam_array_value_at(noam_array_value* value, size_t index){
+    return noam_buffer_at(value->data, index);
+}
+
+void noam_array_value_write(noam_array_value* value, noam_vm* vm){
+    if(value->frozen){
+        noam_vm_error(vm, "cannot change a global array inside pmap");
+    }
+}
+
+const char* noam_array_value_to_string(noam_array_value* value, noam_vm* vm){
+    char str[NOAM_FLOAT_CHAR_LENGTH + NOAM_INT_CHAR_LENGTH];
+
+    /* the representation is built in the array, which other workers may print too */
+    if(value->frozen){
+        noam_vm_error(vm, "cannot print a global array inside pmap");
+    }
+
+    noam_buffer_clear(value->repr);
+    noam_buffer_push(value->repr, "[");
+
+    for(size_t i = 0; i < value->data->length; ++i){
+        int length = value->elem == NOAM_INT_TOKEN ?
+                     sprintf(str, i ? ", %d" : "%d", *(int*)noam_array_value_at(value, i)) :
+                     sprintf(str, i ? ", %f" : "%f", *(float*)noam_array_value_at(value, i));
+        noam_buffer_append(value->repr, str, (size_t)length);
+    }
+
+    noam_buffer_push(value->repr, "]");
+    noam_buffer_terminate(value->repr);
+    return value->repr->data;
+}
+
+void noam_array_value_release(noam_array_value* value){
+    noam_buffer_release(value->data);
+    noam_buffer_release(value->repr);
+}
+
+noam_array_value* noam_array_value_create(noam_token elem, size_t length){
+    static noam_value_vtable_ noam_array_value_vtable[] = {{&noam_array_value_get,
+                                                                   &noam_array_value_release,
+                                                                   &noam_array_value_to_string,
+                                                                   NOAM_ARRAY_TOKEN}};
+    NOAM_TRACE(NOAM_TRACE_ALLOC, "noam_array_value_create: %lu\n", length);
+    noam_array_value* array_value = malloc(sizeof(noam_array_value));
+    NOAM_ALLOC_STAT("noam_array_value", sizeof(noam_array_value));
+    array_value->vtable_ = noam_array_value_vtable;
+    array_value->elem = elem;
+    array_value->data = noam_buffer_create(elem == NOAM_INT_TOKEN ? sizeof(int) : sizeof(float));
+    noam_buffer_grow(array_value->data, length ? length : 1);
+    memset(array_value->data->data, 0, array_value->data->size * array_value->data->chunk);
+    array_value->data->length = length;
+    array_value->repr = noam_buffer_create(1);
+    array_value->frozen = 0;
+    return array_value;
+}
+
+noam_value* noam_array_expression_get(noam_array_expression* expression, noam_vm* vm){
+    size_t length = expression->elements->length;
+    noam_value** values = malloc((length ? length : 1) * sizeof(noam_value*));
+    noam_token elem = NOAM_INT_TOKEN;
+
+    for(size_t i = 0; i < length; ++i){
+        noam_expression** element = noam_buffer_at(expression->elements, i);
+        values[i] = noam_expression_get(*element, vm);
+
+        if(noam_value_is_instance(values[i], NOAM_FLOAT_TOKEN)){
+            elem = NOAM_FLOAT_TOKEN;
+        } else if(!noam_value_is_instance(values[i], NOAM_INT_TOKEN)){
+            noam_vm_error(vm, "array elements must be int or float");
+        }
+    }
+
+    /* ints are promoted once a float element is met, so the storage stays homogeneous */
+    noam_array_value* array = noam_array_value_create(elem, length);
+
+    for(size_t i = 0; i < length; ++i){
+        if(elem == NOAM_INT_TOKEN){
+            *(int*)noam_array_value_at(array, i) = ((noam_int_value*)values[i])->value;
+        } else if(noam_value_is_instance(values[i], NOAM_INT_TOKEN)){
+            *(float*)noam_array_value_at(array, i) = (float)((noam_int_value*)values[i])->value;
+        } else {
+            *(float*)noam_array_value_at(array, i) = ((noam_float_value*)values[i])->value;
+        }
+    }
+
+    free(values);
+    return (noam_value*)array;
+}
+
+void noam_array_expression_release(noam_array_expression* expression){
+    noam_buffer_release(expression->elements);
+}
+
+noam_array_expression* noam_array_expression_create(noam_buffer* elements){
+    static noam_expression_vtable_ noam_array_expression_vtable[] = {{&noam_array_expression_get,
+                                                                             &noam_array_expression_release}};
+    NOAM_TRACE(NOAM_TRACE_PARSER, "noam_array_expression_create: %lu\n", elements->length);
+    noam_array_expression* expression = malloc(sizeof(noam_array_expression));
+    NOAM_ALLOC_STAT("noam_array_expression", sizeof(noam_array_expression));
+    expression->vtable_ = noam_array_expression_vtable;
+    expression->elements = elements;
+    return expression;
+}
+
+int noam_index_value(noam_vm* vm, noam_value* index){
+    if(!noam_value_is_instance(index, NOAM_INT_TOKEN)){
+        noam_vm_error(vm, "index is not an int");
+    }
+    return ((noam_int_value*)index)->value;
+}
+
+size_t noam_array_index(noam_vm* vm, noam_value* target, noam_value* index, noam_array_value** array){
+    if(!noam_value_is_instance(target, NOAM_ARRAY_TOKEN)){
+        noam_vm_error(vm, "value is not indexable");
+    }
+
+    *array = (noam_array_value*)target;
+    int i = noam_index_value(vm, index);
+
+    if(i < 0 || (size_t)i >= (*array)->data->length){
+        noam_vm_error(vm, "array index %d is out of range", i);
+    }
+
+    return (size_t)i;
+}
+
+noam_value* noam_index_expression_get(noam_index_expression* expression, noam_vm* vm){
+    noam_value* target = noam_expression_get(expression->target, vm);
+    noam_value* index_value = noam_expression_get(expression->index, vm);
+
+    if(noam_math_is_instance(target)){
+        return noam_math_index(vm, target, noam_index_value(vm, index_value));
+    }
+
+    if(noam_value_is_instance(target, NOAM_MAP_TOKEN)){
+        noam_value* value = noam_map_get((noam_map_value*)target, index_value, vm);
+        return value ? value : (noam_value*)noam_nil_value_create();
+    }
+
+    noam_array_value* array = NULL;
+    size_t index = noam_array_index(vm, target, index_value, &array);
+
+    if(array->elem == NOAM_INT_TOKEN){
+        return (noam_value*)noam_int_value_create(*(int*)noam_array_value_at(array, index));
+    }
+    return (noam_value*)noam_float_value_create(*(float*)noam_array_value_at(array, index));
+}
+
+void noam_index_expression_release(noam_index_expression* expression){
+    noam_expression_release(expression->target);
+    noam_expression_release(expression->index);
+}
+
+noam_index_expression* noam_index_expression_create(noam_expression* target, noam_expression* index){
+    static noam_expression_vtable_ noam_index_expression_vtable[] = {{&noam_index_expression_get,
+                                                                             &noam_index_expression_release}};
+    NOAM_TRACE(NOAM_TRACE_PARSER, "noam_index_expression_create\n");
+    noam_index_expression* expression = malloc(sizeof(noam_index_expression));
+    NOAM_ALLOC_STAT("noam_index_expression", sizeof(noam_index_expression));
+    expression->vtable_ = noam_index_expression_vtable;
+    expression->target = target;
+    expression->index = index;
+    return expression;
+}
+
+int noam_expression_is_index(const noam_expression* expression){
+    return expression->vtable_->get == (noam_expression_get_func)&noam_index_expression_get;
+}
+
+noam_value* noam_builtin_call_expression_get(noam_builtin_call_expression* expression, noam_vm* vm){
+    noam_value* args[NOAM_BUILTIN_MAX_ARGS];
+
+    for(size_t i = 0; i < expression->args->length; ++i){
+        noam_expression** arg = noam_buffer_at(expression->args, i);
+        args[i] = noam_expression_get(*arg, vm);
+    }
+
+    return expression->builtin->func(vm, args, expression->args->length);
+}
+
+void noam_builtin_call_expression_release(noam_builtin_call_expression* expression){
+    noam_buffer_release(expression->args);
+}
+
+noam_builtin_call_expression* noam_builtin_call_expression_create(const noam_builtin* builtin, noam_buffer* args){
+    static noam_expression_vtable_ noam_builtin_call_expression_vtable[] = {{&noam_builtin_call_expression_get,
+                                                                                    &noam_builtin_call_expression_release}};
+    NOAM_TRACE(NOAM_TRACE_PARSER, "noam_builtin_call_expression_create: %s\n", builtin->name);
+    noam_builtin_call_expression* expression = malloc(sizeof(noam_builtin_call_expression));
+    NOAM_ALLOC_STAT("noam_builtin_call_expression", sizeof(noam_builtin_call_expression));
+    expression->vtable_ = noam_builtin_call_expression_vtable;
+    expression->builtin = builtin;
+    expression->args = args;
+    return expression;
+}
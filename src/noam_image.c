@@ -0,0 +1,1051 @@
+#include "noam_image.h"
+#include "noam_parser.h"
+#include "noam_module.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define NOAM_IMAGE_NONE ((size_t)-1)
+
+/* noam_image_tag enum: what follows in the image, values are written in place the first time
+ * and referred to by their index afterwards */
+typedef enum {
+    NOAM_IMAGE_NULL,
+    NOAM_IMAGE_REF,
+    NOAM_IMAGE_VALUE,
+    NOAM_IMAGE_PRINT,
+    NOAM_IMAGE_ASSIGNMENT,
+    NOAM_IMAGE_COMPOUND,
+    NOAM_IMAGE_INDEX_ASSIGNMENT,
+    NOAM_IMAGE_EXPRESSION,
+    NOAM_IMAGE_RETURN,
+    NOAM_IMAGE_COND,
+    NOAM_IMAGE_FOR,
+    NOAM_IMAGE_WHILE,
+    NOAM_IMAGE_RANGE,
+    NOAM_IMAGE_YIELD,
+    NOAM_IMAGE_VARIABLE,
+    NOAM_IMAGE_FUNC_CALL,
+    NOAM_IMAGE_OP,
+    NOAM_IMAGE_ARRAY,
+    NOAM_IMAGE_INDEX,
+    NOAM_IMAGE_BUILTIN_CALL,
+    NOAM_IMAGE_NATIVE_CALL,
+    NOAM_IMAGE_MAP,
+    NOAM_IMAGE_COMPONENT
+} noam_image_tag;
+
+/* node types are told apart by their vtables like noam_expression_is_func_call does,
+ * the order follows noam_image_tag */
+static const noam_statement_run_func noam_image_runs[] = {
+        (noam_statement_run_func)&noam_print_statement_run,
+        (noam_statement_run_func)&noam_assignment_statement_run,
+        (noam_statement_run_func)&noam_compound_assignment_statement_run,
+        (noam_statement_run_func)&noam_index_assignment_statement_run,
+        (noam_statement_run_func)&noam_expression_statement_run,
+        (noam_statement_run_func)&noam_return_statement_run,
+        (noam_statement_run_func)&noam_cond_statement_run,
+        (noam_statement_run_func)&noam_for_statement_run,
+        (noam_statement_run_func)&noam_while_statement_run,
+        (noam_statement_run_func)&noam_range_statement_run,
+        (noam_statement_run_func)&noam_yield_statement_run
+};
+
+static const noam_expression_get_func noam_image_gets[] = {
+        (noam_expression_get_func)&noam_variable_expression_get,
+        (noam_expression_get_func)&noam_func_call_expression_get,
+        (noam_expression_get_func)&noam_op_expression_get,
+        (noam_expression_get_func)&noam_array_expression_get,
+        (noam_expression_get_func)&noam_index_expression_get,
+        (noam_expression_get_func)&noam_builtin_call_expression_get,
+        (noam_expression_get_func)&noam_native_call_expression_get,
+        (noam_expression_get_func)&noam_map_expression_get,
+        (noam_expression_get_func)&noam_component_expression_get
+};
+
+size_t noam_image_hash_pointer(noam_value* const* key){
+    return (size_t)*key >> 4;
+}
+
+void noam_image_write(noam_buffer* data, const void* bytes, size_t length){
+    noam_buffer_append(data, bytes, length);
+}
+
+/* noam_image_write_size: sizes, tags and slots are written in 7 bit groups, most of them take a byte */
+void noam_image_write_size(noam_buffer* data, size_t size){
+    unsigned char bytes[2 * sizeof(size_t)];
+    size_t length = 0;
+
+    while(size >= 0x80){
+        bytes[length++] = (unsigned char)(size | 0x80);
+        size >>= 7;
+    }
+
+    bytes[length++] = (unsigned char)size;
+    noam_image_write(data, bytes, length);
+}
+
+/* noam_image_write_name: writes the index of a name in the string table, adds the name on its first use */
+void noam_image_write_name(noam_image_writer* writer, noam_buffer* name){
+    if(!name){
+        noam_image_write_size(writer->data, NOAM_IMAGE_NONE);
+        return;
+    }
+
+    noam_dict_node* node = noam_dict_find(writer->names, name);
+
+    if(node){
+        noam_image_write_size(writer->data, *(size_t*)noam_dict_value(writer->names, node));
+        return;
+    }
+
+    size_t index = writer->names->length;
+    noam_dict_insert(writer->names, name, &index);
+    noam_image_write_size(writer->strings, name->length);
+    noam_image_write(writer->strings, name->data, name->length);
+    noam_image_write_size(writer->data, index);
+}
+
+void noam_image_write_value(noam_image_writer* writer, noam_value* value){
+    noam_buffer* data = writer->data;
+
+    if(!value){
+        noam_image_write_size(data, NOAM_IMAGE_NULL);
+        return;
+    }
+
+    noam_dict_node* node = noam_dict_find(writer->values, &value);
+
+    if(node){
+        noam_image_write_size(data, NOAM_IMAGE_REF);
+        noam_image_write_size(data, *(size_t*)noam_dict_value(writer->values, node));
+        return;
+    }
+
+    /* the index is taken before the elements, so a map holding itself refers to itself */
+    size_t index = writer->values->length;
+    noam_dict_insert(writer->values, &value, &index);
+    noam_image_write_size(data, NOAM_IMAGE_VALUE);
+    noam_image_write_size(data, value->vtable_->type);
+
+    switch(value->vtable_->type){
+        case NOAM_INT_TOKEN:
+            noam_image_write(data, &((noam_int_value*)value)->value, sizeof(int));
+            noam_image_write_size(data, (size_t)((noam_int_value*)value)->owned);
+            break;
+        case NOAM_FLOAT_TOKEN:
+            noam_image_write(data, &((noam_float_value*)value)->value, sizeof(float));
+            noam_image_write_size(data, (size_t)((noam_float_value*)value)->owned);
+            break;
+        case NOAM_STRING_TOKEN: {
+            noam_string_value* str = (noam_string_value*)value;
+            noam_image_write_size(data, str->str->length);
+            noam_image_write(data, str->str->data, str->str->length);
+            noam_image_write_size(data, (size_t)str->owned);
+            break;
+        }
+        case NOAM_BOOL_TOKEN:
+            noam_image_write_size(data, (size_t)((noam_bool_value*)value)->value);
+            break;
+        case NOAM_NIL_TOKEN:
+            break;
+        case NOAM_ARRAY_TOKEN: {
+            noam_array_value* array = (noam_array_value*)value;
+            noam_image_write_size(data, array->elem);
+            noam_image_write_size(data, array->data->length);
+            noam_image_write(data, array->data->data, array->data->length * array->data->chunk);
+            break;
+        }
+        case NOAM_MAP_TOKEN: {
+            noam_dict* dict = ((noam_map_value*)value)->dict;
+            noam_image_write_size(data, dict->length);
+
+            for(size_t i = 0; i < dict->size; ++i){
+                noam_dict_node* pair = noam_dict_node_at(dict, i);
+
+                if(pair->probe){
+                    noam_image_write_value(writer, *(noam_value**)noam_dict_key(pair));
+                    noam_image_write_value(writer, *(noam_value**)noam_dict_value(dict, pair));
+                }
+            }
+            break;
+        }
+        case NOAM_VEC_TOKEN:
+            noam_image_write_size(data, ((noam_vec_value*)value)->size);
+            noam_image_write(data, ((noam_vec_value*)value)->v, NOAM_VEC_MAX_SIZE * sizeof(float));
+            break;
+        case NOAM_MAT_TOKEN:
+            noam_image_write(data, ((noam_mat_value*)value)->m, NOAM_MAT_SIZE * sizeof(float));
+            break;
+        case NOAM_COROUTINE_TOKEN:
+            noam_vm_error(writer->vm, "cannot save a coroutine to an image");
+        default:
+            noam_vm_error(writer->vm, "cannot save a value of an unknown type to an image");
+    }
+}
+
+/* noam_image_native_name: the name a host function is registered by */
+noam_buffer* noam_image_native_name(noam_image_writer* writer, const noam_native* native){
+    noam_dict* natives = writer->vm->symbol_table->natives;
+
+    for(size_t i = 0; i < natives->size; ++i){
+        noam_dict_node* node = noam_dict_node_at(natives, i);
+
+        if(node->probe && *(noam_native**)noam_dict_value(natives, node) == native){
+            return noam_dict_key(node);
+        }
+    }
+
+    noam_vm_error(writer->vm, "cannot save a host function which is not registered anymore");
+    return NULL;
+}
+
+void noam_image_write_expressions(noam_image_writer* writer, noam_buffer* expressions);
+void noam_image_write_statements(noam_image_writer* writer, noam_buffer* statements);
+
+void noam_image_write_expression(noam_image_writer* writer, noam_expression* expression){
+    noam_buffer* data = writer->data;
+    size_t tag = 0;
+
+    if(!expression){
+        noam_image_write_size(data, NOAM_IMAGE_NULL);
+        return;
+    }
+
+    while(tag < sizeof(noam_image_gets) / sizeof(noam_expression_get_func) &&
+          expression->vtable_->get != noam_image_gets[tag]){
+        ++tag;
+    }
+
+    /* the rest of the expressions are literal values */
+    if(tag == sizeof(noam_image_gets) / sizeof(noam_expression_get_func)){
+        noam_image_write_value(writer, (noam_value*)expression);
+        return;
+    }
+
+    tag += NOAM_IMAGE_VARIABLE;
+    noam_image_write_size(data, tag);
+
+    switch(tag){
+        case NOAM_IMAGE_VARIABLE: {
+            noam_variable_expression* variable = (noam_variable_expression*)expression;
+            noam_image_write_name(writer, variable->name);
+            noam_image_write_size(data, variable->slot);
+            noam_image_write_size(data, (size_t)variable->global);
+            break;
+        }
+        case NOAM_IMAGE_FUNC_CALL: {
+            noam_func_call_expression* call = (noam_func_call_expression*)expression;
+            noam_image_write_name(writer, call->name);
+            noam_image_write_expressions(writer, call->args);
+            noam_image_write_size(data, (size_t)call->tail);
+            break;
+        }
+        case NOAM_IMAGE_OP: {
+            noam_op_expression* op = (noam_op_expression*)expression;
+            noam_image_write_name(writer, op->op);
+            noam_image_write_expression(writer, op->lhs);
+            noam_image_write_expression(writer, op->rhs);
+            break;
+        }
+        case NOAM_IMAGE_ARRAY:
+            noam_image_write_expressions(writer, ((noam_array_expression*)expression)->elements);
+            break;
+        case NOAM_IMAGE_INDEX:
+            noam_image_write_expression(writer, ((noam_index_expression*)expression)->target);
+            noam_image_write_expression(writer, ((noam_index_expression*)expression)->index);
+            break;
+        case NOAM_IMAGE_BUILTIN_CALL: {
+            noam_builtin_call_expression* call = (noam_builtin_call_expression*)expression;
+            noam_buffer name;
+            memset(&name, 0, sizeof(noam_buffer));
+            name.data = (void*)call->builtin->name;
+            name.length = strlen(call->builtin->name);
+            name.chunk = 1;
+            noam_image_write_name(writer, &name);
+            noam_image_write_expressions(writer, call->args);
+            break;
+        }
+        case NOAM_IMAGE_NATIVE_CALL: {
+            noam_native_call_expression* call = (noam_native_call_expression*)expression;
+            noam_image_write_name(writer, noam_image_native_name(writer, call->native));
+            noam_image_write_expressions(writer, call->args);
+            break;
+        }
+        case NOAM_IMAGE_MAP:
+            noam_image_write_expressions(writer, ((noam_map_expression*)expression)->keys);
+            noam_image_write_expressions(writer, ((noam_map_expression*)expression)->values);
+            break;
+        case NOAM_IMAGE_COMPONENT:
+            noam_image_write_expression(writer, ((noam_component_expression*)expression)->target);
+            noam_image_write_size(data, ((noam_component_expression*)expression)->component);
+            break;
+        default:
+            break;
+    }
+}
+
+void noam_image_write_expressions(noam_image_writer* writer, noam_buffer* expressions){
+    noam_image_write_size(writer->data, expressions->length);
+
+    for(size_t i = 0; i < expressions->length; ++i){
+        noam_image_write_expression(writer, *(noam_expression**)noam_buffer_at(expressions, i));
+    }
+}
+
+void noam_image_write_statement(noam_image_writer* writer, noam_statement* statement){
+    noam_buffer* data = writer->data;
+    size_t tag = 0;
+
+    while(tag < sizeof(noam_image_runs) / sizeof(noam_statement_run_func) &&
+          statement->vtable_->run != noam_image_runs[tag]){
+        ++tag;
+    }
+
+    if(tag == sizeof(noam_image_runs) / sizeof(noam_statement_run_func)){
+        noam_vm_error(writer->vm, "cannot save a statement of an unknown type to an image");
+    }
+
+    tag += NOAM_IMAGE_PRINT;
+    noam_image_write_size(data, tag);
+    noam_image_write_size(data, statement->line);
+
+    switch(tag){
+        case NOAM_IMAGE_PRINT:
+            noam_image_write_expression(writer, ((noam_print_statement*)statement)->expr);
+            break;
+        case NOAM_IMAGE_ASSIGNMENT: {
+            noam_assignment_statement* assignment = (noam_assignment_statement*)statement;
+            noam_image_write_name(writer, assignment->name);
+            noam_image_write_expression(writer, assignment->expr);
+            noam_image_write_size(data, assignment->slot);
+            noam_image_write_size(data, (size_t)assignment->global);
+            break;
+        }
+        case NOAM_IMAGE_COMPOUND: {
+            noam_compound_assignment_statement* compound = (noam_compound_assignment_statement*)statement;
+            noam_image_write_name(writer, compound->name);
+            noam_image_write_size(data, (size_t)compound->op);
+            noam_image_write_expression(writer, compound->expr);
+            noam_image_write_size(data, compound->slot);
+            noam_image_write_size(data, (size_t)compound->global);
+            break;
+        }
+        case NOAM_IMAGE_INDEX_ASSIGNMENT:
+            noam_image_write_expression(writer, (noam_expression*)((noam_index_assignment_statement*)statement)->target);
+            noam_image_write_expression(writer, ((noam_index_assignment_statement*)statement)->expr);
+            break;
+        case NOAM_IMAGE_EXPRESSION:
+            noam_image_write_expression(writer, ((noam_expression_statement*)statement)->expression);
+            break;
+        case NOAM_IMAGE_RETURN:
+            noam_image_write_expression(writer, ((noam_return_statement*)statement)->expression);
+            break;
+        case NOAM_IMAGE_COND: {
+            noam_cond_statement* cond = (noam_cond_statement*)statement;
+            noam_image_write_expressions(writer, cond->conditions);
+            noam_image_write_size(data, cond->blocks->length);
+
+            for(size_t i = 0; i < cond->blocks->length; ++i){
+                noam_image_write_statements(writer, noam_buffer_at(cond->blocks, i));
+            }
+
+            noam_image_write_size(data, (size_t)cond->with_else);
+            break;
+        }
+        case NOAM_IMAGE_FOR: {
+            noam_for_statement* loop = (noam_for_statement*)statement;
+            noam_image_write_name(writer, loop->key);
+            noam_image_write_name(writer, loop->value);
+            noam_image_write_size(data, loop->key_slot);
+            noam_image_write_size(data, loop->value_slot);
+            noam_image_write_size(data, (size_t)loop->global);
+            noam_image_write_expression(writer, loop->iterable);
+            noam_image_write_statements(writer, loop->block);
+            break;
+        }
+        case NOAM_IMAGE_WHILE:
+            noam_image_write_expression(writer, ((noam_while_statement*)statement)->condition);
+            noam_image_write_statements(writer, ((noam_while_statement*)statement)->block);
+            break;
+        case NOAM_IMAGE_RANGE: {
+            noam_range_statement* range = (noam_range_statement*)statement;
+            noam_image_write_name(writer, range->key);
+            noam_image_write_size(data, range->slot);
+            noam_image_write_size(data, (size_t)range->global);
+            noam_image_write_expression(writer, range->from);
+            noam_image_write_expression(writer, range->to);
+            noam_image_write_statements(writer, range->block);
+            noam_image_write_size(data, (size_t)range->bound);
+            noam_image_write_size(data, (size_t)range->escapes);
+            break;
+        }
+        case NOAM_IMAGE_YIELD:
+            noam_image_write_expression(writer, ((noam_yield_statement*)statement)->expression);
+            break;
+        default:
+            break;
+    }
+}
+
+void noam_image_write_statements(noam_image_writer* writer, noam_buffer* statements){
+    noam_image_write_size(writer->data, statements->length);
+
+    for(size_t i = 0; i < statements->length; ++i){
+        noam_image_write_statement(writer, *(noam_statement**)noam_buffer_at(statements, i));
+    }
+}
+
+/* noam_image_write_program: functions, then global names and slots, then the values of the global slots,
+ * then the paths of the imported modules */
+void noam_image_write_program(noam_image_writer* writer){
+    noam_symbol_table* symbol_table = writer->vm->symbol_table;
+    noam_dict* vars = symbol_table->head->vars;
+    noam_stack* stack = writer->vm->stack;
+
+    noam_image_write_size(writer->data, symbol_table->funcs->length);
+
+    for(size_t i = 0; i < symbol_table->funcs->size; ++i){
+        noam_dict_node* node = noam_dict_node_at(symbol_table->funcs, i);
+
+        if(!node->probe){
+            continue;
+        }
+
+        noam_func* func = *(noam_func**)noam_dict_value(symbol_table->funcs, node);
+        noam_image_write_name(writer, func->name);
+        noam_image_write_size(writer->data, func->params->length);
+
+        for(size_t j = 0; j < func->params->length; ++j){
+            noam_image_write_name(writer, noam_buffer_at(func->params, j));
+        }
+
+        noam_image_write_size(writer->data, func->slots);
+        noam_image_write_size(writer->data, (size_t)func->coroutine);
+        noam_image_write_statements(writer, func->body);
+    }
+
+    noam_image_write_size(writer->data, symbol_table->head->slots);
+    noam_image_write_size(writer->data, vars->length);
+
+    for(size_t i = 0; i < vars->size; ++i){
+        noam_dict_node* node = noam_dict_node_at(vars, i);
+
+        if(node->probe){
+            noam_image_write_name(writer, noam_dict_key(node));
+            noam_image_write_size(writer->data, *(size_t*)noam_dict_value(vars, node));
+        }
+    }
+
+    for(size_t i = 0; i < symbol_table->head->slots; ++i){
+        noam_image_write_value(writer, i < stack->length ? stack->slots[i] : NULL);
+    }
+
+    noam_buffer* paths = noam_buffer_create(sizeof(noam_buffer));
+
+    for(size_t i = 0; i < symbol_table->modules->size; ++i){
+        noam_dict_node* node = noam_dict_node_at(symbol_table->modules, i);
+        noam_module* module = node->probe ? *(noam_module**)noam_dict_value(symbol_table->modules, node) : NULL;
+
+        if(module && module->state == NOAM_MODULE_PARSED){
+            noam_buffer path;
+            memset(&path, 0, sizeof(noam_buffer));
+            path.data = module->path;
+            path.length = strlen(module->path);
+            path.chunk = 1;
+            noam_buffer_push(paths, &path);
+        }
+    }
+
+    noam_image_write_size(writer->data, paths->length);
+
+    for(size_t i = 0; i < paths->length; ++i){
+        noam_image_write_name(writer, noam_buffer_at(paths, i));
+    }
+
+    noam_buffer_release(paths);
+}
+
+noam_status noam_image_save(noam_vm* vm, const char* path){
+    noam_image_writer writer;
+    jmp_buf recover;
+
+    if(vm->recover){
+        snprintf(vm->error, NOAM_VM_ERROR_LENGTH, "cannot save an image while a script is running");
+        return vm->status = NOAM_RUNTIME_ERROR;
+    }
+
+    NOAM_TRACE(NOAM_TRACE_EXEC, "noam_image_save: %s\n", path);
+    writer.vm = vm;
+    writer.data = noam_buffer_create(1);
+    writer.strings = noam_buffer_create(1);
+    writer.names = noam_dict_createv(sizeof(noam_buffer), sizeof(size_t), &noam_hash_string, &noam_cmp_string, NULL);
+    writer.values = noam_dict_create(sizeof(noam_value*), sizeof(size_t), &noam_image_hash_pointer);
+
+    vm->status = NOAM_OK;
+    vm->recover = &recover;
+
+    if(!setjmp(recover)){
+        noam_parse_pending(vm);
+        noam_image_write_program(&writer);
+
+        noam_image_header header;
+        memset(&header, 0, sizeof(noam_image_header));
+        memcpy(header.magic, NOAM_IMAGE_MAGIC, sizeof(NOAM_IMAGE_MAGIC));
+        header.version = NOAM_IMAGE_VERSION;
+        header.word = sizeof(size_t);
+        header.strings = writer.names->length;
+
+        FILE* file = fopen(path, "wb");
+
+        if(!file){
+            snprintf(vm->error, NOAM_VM_ERROR_LENGTH, "cannot open the file %s", path);
+            vm->status = NOAM_IO_ERROR;
+        } else {
+            fwrite(&header, sizeof(noam_image_header), 1, file);
+            fwrite(writer.strings->data, 1, writer.strings->length, file);
+            fwrite(writer.data->data, 1, writer.data->length, file);
+
+            if(ferror(file) | fclose(file)){
+                snprintf(vm->error, NOAM_VM_ERROR_LENGTH, "cannot write the file %s", path);
+                vm->status = NOAM_IO_ERROR;
+            }
+        }
+    }
+
+    vm->recover = NULL;
+    noam_buffer_release(writer.data);
+    noam_buffer_release(writer.strings);
+    noam_dict_release(writer.names);
+    noam_dict_release(writer.values);
+    return vm->status;
+}
+
+/* noam_image_read: returns the next `length` bytes of the image */
+const void* noam_image_read(noam_image_reader* reader, size_t length){
+    if(length > reader->length - reader->offset){
+        noam_vm_error(reader->vm, "the image is truncated");
+    }
+
+    const void* bytes = reader->data + reader->offset;
+    reader->offset += length;
+    return bytes;
+}
+
+size_t noam_image_read_size(noam_image_reader* reader){
+    size_t size = 0;
+
+    for(size_t shift = 0; shift < 8 * sizeof(size_t); shift += 7){
+        unsigned char byte = *(const unsigned char*)noam_image_read(reader, 1);
+        size |= (size_t)(byte & 0x7f) << shift;
+
+        if(!(byte & 0x80)){
+            return size;
+        }
+    }
+
+    noam_vm_error(reader->vm, "the image is corrupt");
+    return 0;
+}
+
+noam_buffer* noam_image_read_name(noam_image_reader* reader){
+    size_t index = noam_image_read_size(reader);
+
+    if(index == NOAM_IMAGE_NONE){
+        return NULL;
+    }
+
+    if(index >= reader->strings->length){
+        noam_vm_error(reader->vm, "the image is corrupt");
+    }
+
+    return *(noam_buffer**)noam_buffer_at(reader->strings, index);
+}
+
+noam_value* noam_image_read_value(noam_image_reader* reader, size_t tag){
+    noam_value* value = NULL;
+
+    if(tag == NOAM_IMAGE_NULL){
+        return NULL;
+    }
+
+    if(tag == NOAM_IMAGE_REF){
+        size_t index = noam_image_read_size(reader);
+
+        if(index >= reader->values->length){
+            noam_vm_error(reader->vm, "the image is corrupt");
+        }
+        return *(noam_value**)noam_buffer_at(reader->values, index);
+    }
+
+    if(tag != NOAM_IMAGE_VALUE){
+        noam_vm_error(reader->vm, "the image is corrupt");
+    }
+
+    switch(noam_image_read_size(reader)){
+        case NOAM_INT_TOKEN: {
+            int number = 0;
+            memcpy(&number, noam_image_read(reader, sizeof(int)), sizeof(int));
+            value = (noam_value*)noam_int_value_create(number);
+            ((noam_int_value*)value)->owned = (int)noam_image_read_size(reader);
+            break;
+        }
+        case NOAM_FLOAT_TOKEN: {
+            float number = 0;
+            memcpy(&number, noam_image_read(reader, sizeof(float)), sizeof(float));
+            value = (noam_value*)noam_float_value_create(number);
+            ((noam_float_value*)value)->owned = (int)noam_image_read_size(reader);
+            break;
+        }
+        case NOAM_STRING_TOKEN: {
+            noam_buffer str;
+            memset(&str, 0, sizeof(noam_buffer));
+            str.length = noam_image_read_size(reader);
+            str.data = (void*)noam_image_read(reader, str.length);
+            str.chunk = 1;
+            value = (noam_value*)noam_string_value_create(&str);
+            ((noam_string_value*)value)->owned = (int)noam_image_read_size(reader);
+            noam_string_value_hash((noam_string_value*)value);
+            break;
+        }
+        case NOAM_BOOL_TOKEN:
+            value = (noam_value*)noam_bool_value_create((int)noam_image_read_size(reader));
+            break;
+        case NOAM_NIL_TOKEN:
+            value = (noam_value*)noam_nil_value_create();
+            break;
+        case NOAM_ARRAY_TOKEN: {
+            noam_token elem = (noam_token)noam_image_read_size(reader);
+            size_t length = noam_image_read_size(reader);
+
+            if(elem != NOAM_INT_TOKEN && elem != NOAM_FLOAT_TOKEN){
+                noam_vm_error(reader->vm, "the image is corrupt");
+            }
+
+            noam_array_value* array = noam_array_value_create(elem, length);
+            memcpy(array->data->data, noam_image_read(reader, length * array->data->chunk),
+                   length * array->data->chunk);
+            value = (noam_value*)array;
+            break;
+        }
+        case NOAM_MAP_TOKEN: {
+            noam_map_value* map = noam_map_value_create();
+            size_t length = noam_image_read_size(reader);
+
+            /* indexed before the pairs like on save */
+            noam_buffer_push(reader->values, &map);
+
+            for(size_t i = 0; i < length; ++i){
+                noam_value* key = noam_image_read_value(reader, noam_image_read_size(reader));
+                noam_value* pair = noam_image_read_value(reader, noam_image_read_size(reader));
+
+                if(!key || !pair){
+                    noam_vm_error(reader->vm, "the image is corrupt");
+                }
+                noam_map_set(map, key, pair);
+            }
+            return (noam_value*)map;
+        }
+        case NOAM_VEC_TOKEN: {
+            size_t size = noam_image_read_size(reader);
+            float v[NOAM_VEC_MAX_SIZE];
+            memcpy(v, noam_image_read(reader, NOAM_VEC_MAX_SIZE * sizeof(float)), NOAM_VEC_MAX_SIZE * sizeof(float));
+            value = (noam_value*)noam_vec_value_create(size, v);
+            break;
+        }
+        case NOAM_MAT_TOKEN: {
+            float m[NOAM_MAT_SIZE];
+            memcpy(m, noam_image_read(reader, NOAM_MAT_SIZE * sizeof(float)), NOAM_MAT_SIZE * sizeof(float));
+            value = (noam_value*)noam_mat_value_create(m);
+            break;
+        }
+        default:
+            noam_vm_error(reader->vm, "the image is corrupt");
+    }
+
+    noam_buffer_push(reader->values, &value);
+    return value;
+}
+
+noam_expression* noam_image_read_expression(noam_image_reader* reader);
+noam_buffer* noam_image_read_statements(noam_image_reader* reader, noam_release_func release);
+
+noam_buffer* noam_image_read_expressions(noam_image_reader* reader){
+    noam_buffer* expressions = noam_buffer_createv(sizeof(noam_expression*), &noam_expression_release);
+    size_t length = noam_image_read_size(reader);
+
+    for(size_t i = 0; i < length; ++i){
+        noam_expression* expression = noam_image_read_expression(reader);
+        noam_buffer_push(expressions, &expression);
+    }
+
+    return expressions;
+}
+
+/* noam_image_check_slot: a local slot must be in the frame of the function being read,
+ * global slots are checked against the global frame once it's read */
+void noam_image_check_slot(noam_image_reader* reader, size_t slot, int global){
+    if(global){
+        reader->globals = slot >= reader->globals ? slot + 1 : reader->globals;
+    } else if(slot >= reader->slots){
+        noam_vm_error(reader->vm, "the image is corrupt");
+    }
+}
+
+/* noam_image_read_expression: the fields are read in the order they were written before a node is created,
+ * since the order arguments are evaluated in is unspecified */
+noam_expression* noam_image_read_expression(noam_image_reader* reader){
+    size_t tag = noam_image_read_size(reader);
+
+    switch(tag){
+        case NOAM_IMAGE_VARIABLE: {
+            noam_buffer* name = noam_image_read_name(reader);
+            noam_variable_expression* variable = noam_variable_expression_create(name, reader->scope);
+            variable->slot = noam_image_read_size(reader);
+            variable->global = (int)noam_image_read_size(reader);
+            noam_image_check_slot(reader, variable->slot, variable->global);
+            return (noam_expression*)variable;
+        }
+        case NOAM_IMAGE_FUNC_CALL: {
+            noam_buffer* name = noam_image_read_name(reader);
+            noam_buffer* args = noam_image_read_expressions(reader);
+            noam_func_call_expression* call = noam_func_call_expression_create(name, args, reader->vm->symbol_table);
+
+            if(noam_image_read_size(reader)){
+                noam_func_call_expression_tail(call);
+            }
+            return (noam_expression*)call;
+        }
+        case NOAM_IMAGE_OP: {
+            noam_buffer* op = noam_image_read_name(reader);
+            noam_expression* lhs = noam_image_read_expression(reader);
+            noam_expression* rhs = noam_image_read_expression(reader);
+            return (noam_expression*)noam_op_expression_create(lhs, op, rhs);
+        }
+        case NOAM_IMAGE_ARRAY:
+            return (noam_expression*)noam_array_expression_create(noam_image_read_expressions(reader));
+        case NOAM_IMAGE_INDEX: {
+            noam_expression* target = noam_image_read_expression(reader);
+            noam_expression* index = noam_image_read_expression(reader);
+            return (noam_expression*)noam_index_expression_create(target, index);
+        }
+        case NOAM_IMAGE_BUILTIN_CALL: {
+            noam_buffer* name = noam_image_read_name(reader);
+            const noam_builtin* builtin = name ? noam_builtin_find(name) : NULL;
+
+            if(!builtin){
+                noam_vm_error(reader->vm, "the image is corrupt");
+            }
+            return (noam_expression*)noam_builtin_call_expression_create(builtin, noam_image_read_expressions(reader));
+        }
+        case NOAM_IMAGE_NATIVE_CALL: {
+            noam_buffer* name = noam_image_read_name(reader);
+            const noam_native* native = name ? noam_native_find(reader->vm->symbol_table, name) : NULL;
+
+            if(!native){
+                noam_vm_error(reader->vm, "host function %s of the image is not registered",
+                              name ? (const char*)name->data : "");
+            }
+            return (noam_expression*)noam_native_call_expression_create(native, noam_image_read_expressions(reader));
+        }
+        case NOAM_IMAGE_MAP: {
+            noam_buffer* keys = noam_image_read_expressions(reader);
+            noam_buffer* values = noam_image_read_expressions(reader);
+            return (noam_expression*)noam_map_expression_create(keys, values);
+        }
+        case NOAM_IMAGE_COMPONENT: {
+            noam_expression* target = noam_image_read_expression(reader);
+            return (noam_expression*)noam_component_expression_create(target, noam_image_read_size(reader));
+        }
+        default:
+            return (noam_expression*)noam_image_read_value(reader, tag);
+    }
+}
+
+noam_statement* noam_image_read_statement(noam_image_reader* reader){
+    size_t tag = noam_image_read_size(reader);
+    size_t line = noam_image_read_size(reader);
+    noam_statement* statement = NULL;
+
+    switch(tag){
+        case NOAM_IMAGE_PRINT:
+            statement = (noam_statement*)noam_print_statement_create(noam_image_read_expression(reader));
+            break;
+        case NOAM_IMAGE_ASSIGNMENT: {
+            noam_buffer* name = noam_image_read_name(reader);
+            noam_expression* expression = noam_image_read_expression(reader);
+            noam_assignment_statement* assignment = noam_assignment_statement_create(name, expression, reader->scope);
+            assignment->slot = noam_image_read_size(reader);
+            assignment->global = (int)noam_image_read_size(reader);
+            noam_image_check_slot(reader, assignment->slot, assignment->global);
+            statement = (noam_statement*)assignment;
+            break;
+        }
+        case NOAM_IMAGE_COMPOUND: {
+            noam_buffer* name = noam_image_read_name(reader);
+            char op = (char)noam_image_read_size(reader);
+            noam_expression* expression = noam_image_read_expression(reader);
+            noam_compound_assignment_statement* compound = noam_compound_assignment_statement_create(
+                    name, op, expression, reader->scope
+            );
+            compound->slot = noam_image_read_size(reader);
+            compound->global = (int)noam_image_read_size(reader);
+            noam_image_check_slot(reader, compound->slot, compound->global);
+            statement = (noam_statement*)compound;
+            break;
+        }
+        case NOAM_IMAGE_INDEX_ASSIGNMENT: {
+            noam_expression* target = noam_image_read_expression(reader);
+            noam_expression* expression = noam_image_read_expression(reader);
+
+            if(!target || !noam_expression_is_index(target)){
+                noam_vm_error(reader->vm, "the image is corrupt");
+            }
+            statement = (noam_statement*)noam_index_assignment_statement_create((noam_index_expression*)target,
+                                                                                expression);
+            break;
+        }
+        case NOAM_IMAGE_EXPRESSION:
+            statement = (noam_statement*)noam_expression_statement_create(noam_image_read_expression(reader));
+            break;
+        case NOAM_IMAGE_RETURN:
+            statement = (noam_statement*)noam_return_statement_create(noam_image_read_expression(reader));
+            break;
+        case NOAM_IMAGE_COND: {
+            noam_buffer* conditions = noam_image_read_expressions(reader);
+            noam_buffer* blocks = noam_buffer_createv(sizeof(noam_buffer), &noam_buffer_release);
+            size_t length = noam_image_read_size(reader);
+
+            for(size_t i = 0; i < length; ++i){
+                noam_buffer* block = noam_image_read_statements(reader, NULL);
+                noam_buffer_push(blocks, block);
+                free(block);
+            }
+
+            statement = (noam_statement*)noam_cond_statement_create(conditions, blocks,
+                                                                    (int)noam_image_read_size(reader));
+            break;
+        }
+        case NOAM_IMAGE_FOR: {
+            noam_buffer* key = noam_image_read_name(reader);
+            noam_buffer* value = noam_image_read_name(reader);
+            size_t key_slot = noam_image_read_size(reader);
+            size_t value_slot = noam_image_read_size(reader);
+            int global = (int)noam_image_read_size(reader);
+            noam_image_check_slot(reader, key_slot, global);
+            noam_image_check_slot(reader, value_slot, global);
+            noam_expression* iterable = noam_image_read_expression(reader);
+            noam_buffer* block = noam_image_read_statements(reader, NULL);
+
+            if(!key){
+                noam_vm_error(reader->vm, "the image is corrupt");
+            }
+
+            noam_for_statement* loop = noam_for_statement_create(key, value, iterable, block, reader->scope);
+            loop->key_slot = key_slot;
+            loop->value_slot = value_slot;
+            loop->global = global;
+            statement = (noam_statement*)loop;
+            break;
+        }
+        case NOAM_IMAGE_WHILE: {
+            noam_expression* condition = noam_image_read_expression(reader);
+            noam_buffer* block = noam_image_read_statements(reader, NULL);
+            statement = (noam_statement*)noam_while_statement_create(condition, block);
+            break;
+        }
+        case NOAM_IMAGE_RANGE: {
+            noam_buffer* key = noam_image_read_name(reader);
+            size_t slot = noam_image_read_size(reader);
+            int global = (int)noam_image_read_size(reader);
+            noam_image_check_slot(reader, slot, global);
+            noam_expression* from = noam_image_read_expression(reader);
+            noam_expression* to = noam_image_read_expression(reader);
+            noam_buffer* block = noam_image_read_statements(reader, NULL);
+            int bound = (int)noam_image_read_size(reader);
+            int escapes = (int)noam_image_read_size(reader);
+
+            if(!key){
+                noam_vm_error(reader->vm, "the image is corrupt");
+            }
+
+            noam_range_statement* range = noam_range_statement_create(key, from, to, block, bound, escapes, reader->scope);
+            range->slot = slot;
+            range->global = global;
+            statement = (noam_statement*)range;
+            break;
+        }
+        case NOAM_IMAGE_YIELD:
+            statement = (noam_statement*)noam_yield_statement_create(noam_image_read_expression(reader));
+            break;
+        default:
+            noam_vm_error(reader->vm, "the image is corrupt");
+    }
+
+    statement->line = line;
+    return statement;
+}
+
+/* noam_image_read_statements: function bodies own their statements, blocks don't like in the parser */
+noam_buffer* noam_image_read_statements(noam_image_reader* reader, noam_release_func release){
+    noam_buffer* statements = noam_buffer_createv(sizeof(noam_statement*), release);
+    size_t length = noam_image_read_size(reader);
+
+    for(size_t i = 0; i < length; ++i){
+        noam_statement* statement = noam_image_read_statement(reader);
+        noam_buffer_push(statements, &statement);
+    }
+
+    return statements;
+}
+
+/* noam_image_read_program: the names are copied for the dictionaries of the symbol table,
+ * which own their keys */
+void noam_image_read_program(noam_image_reader* reader){
+    noam_symbol_table* symbol_table = reader->vm->symbol_table;
+    const noam_image_header* header = noam_image_read(reader, sizeof(noam_image_header));
+
+    if(memcmp(header->magic, NOAM_IMAGE_MAGIC, sizeof(NOAM_IMAGE_MAGIC)) ||
+       header->version != NOAM_IMAGE_VERSION || header->word != sizeof(size_t)){
+        noam_vm_error(reader->vm, "not an image of this version of noam");
+    }
+
+    for(size_t i = header->strings; i > 0; --i){
+        size_t length = noam_image_read_size(reader);
+        noam_buffer* name = noam_buffer_create(1);
+        noam_buffer_append(name, noam_image_read(reader, length), length);
+        noam_buffer_terminate(name);
+        noam_buffer_push(reader->strings, &name);
+    }
+
+    for(size_t i = noam_image_read_size(reader); i > 0; --i){
+        noam_buffer* name = noam_image_read_name(reader);
+        noam_buffer* params = noam_buffer_createv(sizeof(noam_buffer), &noam_buffer_release);
+
+        for(size_t j = noam_image_read_size(reader); j > 0; --j){
+            noam_buffer* param = noam_image_read_name(reader);
+
+            if(!param){
+                noam_vm_error(reader->vm, "the image is corrupt");
+            }
+            noam_buffer_push(params, param);
+        }
+
+        size_t slots = noam_image_read_size(reader);
+        int coroutine = (int)noam_image_read_size(reader);
+
+        /* params take the first slots of the frame */
+        if(!name || params->length > slots){
+            noam_vm_error(reader->vm, "the image is corrupt");
+        }
+
+        reader->slots = slots;
+        noam_func* func = noam_func_create(name, params, noam_image_read_statements(reader, &noam_statement_release));
+        func->slots = slots;
+        func->coroutine = coroutine;
+
+        noam_buffer* key = noam_buffer_copy(name);
+        noam_dict_insert(symbol_table->funcs, key, &func);
+        free(key);
+    }
+
+    symbol_table->head->slots = noam_image_read_size(reader);
+
+    if(reader->globals > symbol_table->head->slots){
+        noam_vm_error(reader->vm, "the image is corrupt");
+    }
+
+    for(size_t i = noam_image_read_size(reader); i > 0; --i){
+        noam_buffer* name = noam_image_read_name(reader);
+        size_t slot = noam_image_read_size(reader);
+
+        if(!name || slot >= symbol_table->head->slots){
+            noam_vm_error(reader->vm, "the image is corrupt");
+        }
+
+        noam_buffer* key = noam_buffer_copy(name);
+        noam_dict_insert(symbol_table->head->vars, key, &slot);
+        free(key);
+    }
+
+    noam_stack_globals(reader->vm->stack, symbol_table->head->slots);
+
+    for(size_t i = 0; i < symbol_table->head->slots; ++i){
+        reader->vm->stack->slots[i] = noam_image_read_value(reader, noam_image_read_size(reader));
+    }
+
+    /* the modules are known by their namespaces again, an import of one of them is not loaded twice */
+    for(size_t i = noam_image_read_size(reader); i > 0; --i){
+        noam_buffer* path = noam_image_read_name(reader);
+
+        if(!path){
+            noam_vm_error(reader->vm, "the image is corrupt");
+        }
+
+        noam_module* module = noam_module_create(path->data);
+        module->state = NOAM_MODULE_PARSED;
+        noam_dict_insert(symbol_table->modules, module->name, &module);
+    }
+
+    noam_func_call_expression_link(symbol_table);
+}
+
+noam_status noam_image_load(noam_vm* vm, const char* path){
+    noam_image_reader reader;
+    struct stat info;
+    jmp_buf recover;
+
+    if(vm->recover || vm->shared || vm->symbol_table->funcs->length || vm->symbol_table->head->slots){
+        snprintf(vm->error, NOAM_VM_ERROR_LENGTH, vm->recover ? "cannot load an image while a script is running" :
+                                                  "an image is loaded into a new vm only");
+        return vm->status = NOAM_RUNTIME_ERROR;
+    }
+
+    NOAM_TRACE(NOAM_TRACE_EXEC, "noam_image_load: %s\n", path);
+    int file = open(path, O_RDONLY);
+
+    if(file < 0 || fstat(file, &info)){
+        if(file >= 0){
+            close(file);
+        }
+        snprintf(vm->error, NOAM_VM_ERROR_LENGTH, "cannot open the file %s", path);
+        return vm->status = NOAM_IO_ERROR;
+    }
+
+    memset(&reader, 0, sizeof(noam_image_reader));
+    reader.vm = vm;
+    reader.length = (size_t)info.st_size;
+    reader.data = reader.length ? mmap(NULL, reader.length, PROT_READ, MAP_PRIVATE, file, 0) : NULL;
+    close(file);
+
+    if(reader.data == MAP_FAILED){
+        snprintf(vm->error, NOAM_VM_ERROR_LENGTH, "cannot map the file %s", path);
+        return vm->status = NOAM_IO_ERROR;
+    }
+
+    reader.strings = noam_buffer_create(sizeof(noam_buffer*));
+    reader.values = noam_buffer_create(sizeof(noam_value*));
+    reader.scope = noam_scope_create(NULL);
+
+    vm->status = NOAM_OK;
+    vm->recover = &recover;
+
+    if(!setjmp(recover)){
+        noam_image_read_program(&reader);
+    }
+
+    vm->recover = NULL;
+
+    if(reader.data){
+        munmap((void*)reader.data, reader.length);
+    }
+
+    /* names resolved in the scratch scope belong to the nodes */
+    reader.scope->vars->release = NULL;
+    noam_scope_release(reader.scope);
+    noam_buffer_release(reader.strings);
+    noam_buffer_release(reader.values);
+    return vm->status;
+}
@@ -1,13 +1,51 @@
 #include <ctype.h>
+#include <pthread.h>
 
 #include "noam_lexer.h"
 
-noam_token_info* noam_token_info_create(noam_buffer* name, noam_token token){
-    noam_token_info* info = malloc(sizeof(noam_token_info));
-    info->name = noam_buffer_create(1);
-    noam_buffer_merge(info->name, name);
-    info->token = token;
-    return info;
+static noam_prefix_node* noam_tokens_root = NULL;
+static pthread_once_t noam_tokens_once = PTHREAD_ONCE_INIT;
+
+const char* noam_token_to_string(noam_token token){
+    static const char* strings[] = { "NOAM_ERROR_TOKEN",
+                                     "NOAM_WORD_TOKEN",
+                                     "NOAM_INT_TOKEN",
+                                     "NOAM_FLOAT_TOKEN",
+                                     "NOAM_STRING_TOKEN",
+                                     "NOAM_BOOL_TOKEN",
+                                     "NOAM_LINE_TOKEN",
+                                     "NOAM_EQ_TOKEN",
+                                     "NOAM_OP_TOKEN",
+                                     "NOAM_OP_EQ_TOKEN",
+                                     "NOAM_LP_TOKEN",
+                                     "NOAM_RP_TOKEN",
+                                     "NOAM_LB_TOKEN",
+                                     "NOAM_RB_TOKEN",
+                                     "NOAM_COMMA_TOKEN",
+                                     "NOAM_NIL_TOKEN",
+                                     "NOAM_LS_TOKEN",
+                                     "NOAM_RS_TOKEN",
+                                     "NOAM_DOT_TOKEN",
+                                     "NOAM_COLON_TOKEN",
+                                     "NOAM_RANGE_TOKEN",
+                                     "NOAM_EOF_TOKEN",
+                                     "NOAM_ARRAY_TOKEN",
+                                     "NOAM_VEC_TOKEN",
+                                     "NOAM_MAT_TOKEN",
+                                     "NOAM_MAP_TOKEN",
+                                     "NOAM_COROUTINE_TOKEN" };
+    return strings[token];
+}
+
+void noam_token_push(noam_buffer* tokens, noam_buffer* name, noam_token token, size_t line){
+    noam_token_info info;
+    NOAM_ALLOC_STAT("token", sizeof(noam_token_info));
+    info.name = noam_buffer_create(1);
+    noam_buffer_merge(info.name, name);
+    noam_buffer_terminate(info.name);
+    info.token = token;
+    info.line = line;
+    noam_buffer_push(tokens, &info);
 }
 
 void noam_state_reset(noam_buffer* token_name, noam_state* state){
@@ -16,7 +54,24 @@ void noam_state_reset(noam_buffer* token_name, noam_state* state){
 }
 
 void noam_token_info_release(noam_token_info* info){
-    free(info->name);
+    /* names moved to the body tokens of a lazily parsed function are NULL */
+    if(info->name){
+        noam_buffer_release(info->name);
+    }
+}
+
+void noam_tokens_release(noam_buffer* tokens){
+    for(size_t i = 0; i < tokens->length; ++i){
+        noam_token_info* info = noam_buffer_at(tokens, i);
+        NOAM_FREE_STAT("token", sizeof(noam_token_info));
+
+        if(info->token != NOAM_WORD_TOKEN && info->token != NOAM_OP_TOKEN){
+            noam_token_info_release(info);
+        }
+    }
+
+    tokens->release = NULL;
+    noam_buffer_release(tokens);
 }
 
 noam_prefix_node* noam_prefix_node_create(char character){
@@ -126,7 +181,7 @@ noam_prefix_node* noam_prefix_tree_build(const char** keywords, const noam_token
     return root;
 }
 
-noam_prefix_node* noam_tokens_tree(){
+void noam_tokens_tree_init(){
     static const char* tokens_str[] = { NOAM_TRUE_STR,
                                         NOAM_FALSE_STR,
                                         NOAM_EQ_STR,
@@ -134,8 +189,14 @@ noam_prefix_node* noam_tokens_tree(){
                                         NOAM_MINUS_STR,
                                         NOAM_MULT_STR,
                                         NOAM_DIV_STR,
+                                        NOAM_PLUS_EQ_STR,
+                                        NOAM_MINUS_EQ_STR,
+                                        NOAM_MULT_EQ_STR,
+                                        NOAM_DIV_EQ_STR,
                                         NOAM_LESS_STR,
                                         NOAM_GREATER_STR,
+                                        NOAM_LEQ_STR,
+                                        NOAM_GEQ_STR,
                                         NOAM_LP_STR,
                                         NOAM_RP_STR,
                                         NOAM_LB_STR,
@@ -143,7 +204,12 @@ noam_prefix_node* noam_tokens_tree(){
                                         NOAM_EQ2_STR,
                                         NOAM_NEQ_STR,
                                         NOAM_COMMA_STR,
-                                        NOAM_NIL_STR };
+                                        NOAM_NIL_STR,
+                                        NOAM_LS_STR,
+                                        NOAM_RS_STR,
+                                        NOAM_DOT_STR,
+                                        NOAM_COLON_STR,
+                                        NOAM_RANGE_STR };
 
     static const noam_token tokens[] = { NOAM_BOOL_TOKEN,
                                          NOAM_BOOL_TOKEN,
@@ -152,6 +218,12 @@ noam_prefix_node* noam_tokens_tree(){
                                          NOAM_OP_TOKEN,
                                          NOAM_OP_TOKEN,
                                          NOAM_OP_TOKEN,
+                                         NOAM_OP_EQ_TOKEN,
+                                         NOAM_OP_EQ_TOKEN,
+                                         NOAM_OP_EQ_TOKEN,
+                                         NOAM_OP_EQ_TOKEN,
+                                         NOAM_OP_TOKEN,
+                                         NOAM_OP_TOKEN,
                                          NOAM_OP_TOKEN,
                                          NOAM_OP_TOKEN,
                                          NOAM_LP_TOKEN,
@@ -161,9 +233,19 @@ noam_prefix_node* noam_tokens_tree(){
                                          NOAM_OP_TOKEN,
                                          NOAM_OP_TOKEN,
                                          NOAM_COMMA_TOKEN,
-                                         NOAM_NIL_TOKEN };
+                                         NOAM_NIL_TOKEN,
+                                         NOAM_LS_TOKEN,
+                                         NOAM_RS_TOKEN,
+                                         NOAM_DOT_TOKEN,
+                                         NOAM_COLON_TOKEN,
+                                         NOAM_RANGE_TOKEN };
+
+    noam_tokens_root = noam_prefix_tree_build(tokens_str, tokens, sizeof(tokens) / sizeof(noam_token));
+}
 
-    return noam_prefix_tree_build(tokens_str, tokens, sizeof(tokens) / sizeof(noam_token));
+noam_prefix_node* noam_tokens_tree(){
+    pthread_once(&noam_tokens_once, &noam_tokens_tree_init);
+    return noam_tokens_root;
 }
 
 noam_buffer* noam_parse_tokens(const char* source){
@@ -171,10 +253,15 @@ noam_buffer* noam_parse_tokens(const char* source){
     noam_state state = NOAM_DEFAULT_STATE;
     noam_buffer* token_name = noam_buffer_create(1);
     noam_prefix_node* tokens_root = noam_tokens_tree();
+    /* line of the current character and of the first character of the current token */
+    size_t line = 1;
+    size_t start = 1;
 
     for(const char* c = source; *c != '\0'; ++c){
         switch(state){
             case NOAM_DEFAULT_STATE: {
+                start = line;
+
                 if(isalpha(*c)){
                     state = NOAM_WORD_STATE;
                     noam_buffer_push(token_name, c);
@@ -186,13 +273,15 @@ noam_buffer* noam_parse_tokens(const char* source){
                 } else if(*c == '#') {
                     state = NOAM_COMMENT_STATE;
                 } else if(*c == ' ' || *c == '\n'){
+                    line += *c == '\n';
                     break;
                 } else {
                     noam_buffer_push(token_name, c);
 
                     if(!noam_prefix_tree_contains(tokens_root, token_name)){
-                        fprintf(stderr, "noam: unknown token");
-                        exit(-1);
+                        noam_buffer_release(token_name);
+                        noam_buffer_release(tokens);
+                        return NULL;
                     }
 
                     state = NOAM_SPEC_STATE;
@@ -206,9 +295,9 @@ noam_buffer* noam_parse_tokens(const char* source){
                     noam_token token = noam_prefix_tree_find(tokens_root, token_name);
 
                     if(token != NOAM_ERROR_TOKEN){
-                        noam_buffer_push(tokens, noam_token_info_create(token_name, token));
+                        noam_token_push(tokens, token_name, token, start);
                     } else {
-                        noam_buffer_push(tokens, noam_token_info_create(token_name, NOAM_WORD_TOKEN));
+                        noam_token_push(tokens, token_name, NOAM_WORD_TOKEN, start);
                     }
 
                     noam_state_reset(token_name, &state);
@@ -219,11 +308,12 @@ noam_buffer* noam_parse_tokens(const char* source){
             case NOAM_NUMBER_STATE: { //TODO: zero case
                 if(isdigit(*c)){
                     noam_buffer_push(token_name, c);
-                } else if(*c == '.') {
+                } else if(*c == '.' && c[1] != '.') {
+                    /* a second dot makes a range like 0..n rather than a fraction */
                     noam_buffer_push(token_name, c);
                     state = NOAM_FRACTION_STATE;
                 } else {
-                    noam_buffer_push(tokens, noam_token_info_create(token_name, NOAM_INT_TOKEN));
+                    noam_token_push(tokens, token_name, NOAM_INT_TOKEN, start);
                     noam_state_reset(token_name, &state);
                     --c;
                 }
@@ -233,7 +323,7 @@ noam_buffer* noam_parse_tokens(const char* source){
                 if(isdigit(*c)){
                     noam_buffer_push(token_name, c);
                 } else {
-                    noam_buffer_push(tokens, noam_token_info_create(token_name, NOAM_FLOAT_TOKEN));
+                    noam_token_push(tokens, token_name, NOAM_FLOAT_TOKEN, start);
                     noam_state_reset(token_name, &state);
                     --c;
                 }
@@ -241,15 +331,17 @@ noam_buffer* noam_parse_tokens(const char* source){
             }
             case NOAM_STRING_STATE: {
                 if(*c != '"'){
+                    line += *c == '\n';
                     noam_buffer_push(token_name, c);
                 } else {
-                    noam_buffer_push(tokens, noam_token_info_create(token_name, NOAM_STRING_TOKEN));
+                    noam_token_push(tokens, token_name, NOAM_STRING_TOKEN, start);
                     noam_state_reset(token_name, &state);
                 }
                 break;
             }
             case NOAM_COMMENT_STATE: {
                 if(*c == '\n'){
+                    ++line;
                     state = NOAM_DEFAULT_STATE;
                 }
                 break;
@@ -261,10 +353,10 @@ noam_buffer* noam_parse_tokens(const char* source){
                 noam_token ts = noam_prefix_tree_find(tokens_root, token_name);
 
                 if(ts != NOAM_ERROR_TOKEN){
-                    noam_buffer_push(tokens, noam_token_info_create(token_name, ts));
+                    noam_token_push(tokens, token_name, ts, start);
                     noam_state_reset(token_name, &state);
                 } else if(!noam_prefix_tree_contains(tokens_root, token_name)){
-                    noam_buffer_push(tokens, noam_token_info_create(temp, tf));
+                    noam_token_push(tokens, temp, tf, start);
                     noam_state_reset(token_name, &state);
                     --c;
                 }
@@ -275,6 +367,34 @@ noam_buffer* noam_parse_tokens(const char* source){
         }
     }
 
+    /* a trailing EOF token makes any lookahead past the last token safe */
+    noam_buffer_clear(token_name);
+    noam_token_push(tokens, token_name, NOAM_EOF_TOKEN, line);
+
     noam_buffer_release(token_name);
     return tokens;
-}
\ No newline at end of file
+}
+int noam_source_complete(const char* source){
+    long depth = 0;
+    int string = 0;
+    int comment = 0;
+
+    for(const char* c = source; *c != '\0'; ++c){
+        if(comment){
+            comment = *c != '\n';
+        } else if(string){
+            string = *c != '"';
+        } else if(*c == '"'){
+            string = 1;
+        } else if(*c == '#'){
+            comment = 1;
+        } else if(*c == '(' || *c == '[' || *c == '{'){
+            ++depth;
+        } else if(*c == ')' || *c == ']' || *c == '}'){
+            --depth;
+        }
+    }
+
+    /* extra closing brackets are left to the parser to report */
+    return !string && depth <= 0;
+}
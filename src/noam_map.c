@@ -0,0 +1,210 @@
+#include "noam_map.h"
+
+size_t noam_hash_value(noam_value* const* key){
+    const noam_value* value = *key;
+
+    switch(value->vtable_->type){
+        case NOAM_INT_TOKEN:
+            return (size_t)(unsigned)((const noam_int_value*)value)->value;
+        case NOAM_BOOL_TOKEN:
+            return (size_t)((const noam_bool_value*)value)->value;
+        case NOAM_FLOAT_TOKEN: {
+            float f = ((const noam_float_value*)value)->value;
+            unsigned bits = 0;
+            /* 0.0 and -0.0 are equal keys */
+            if(f != 0){
+                memcpy(&bits, &f, sizeof(bits));
+            }
+            return (size_t)bits;
+        }
+        case NOAM_STRING_TOKEN: {
+            /* a lookup key may be a literal read by other vms at the same time, so the hash isn't stored here */
+            const noam_string_value* str = (const noam_string_value*)value;
+            return str->hashed ? str->hash : noam_hash_string(str->str);
+        }
+        case NOAM_NIL_TOKEN:
+            return 0;
+        default:
+            return (size_t)value;
+    }
+}
+
+int noam_cmp_value(noam_value* const* lhs, noam_value* const* rhs){
+    const noam_value* a = *lhs;
+    const noam_value* b = *rhs;
+
+    if(a->vtable_->type != b->vtable_->type){
+        return a->vtable_->type < b->vtable_->type ? -1 : 1;
+    }
+
+    switch(a->vtable_->type){
+        case NOAM_INT_TOKEN: {
+            int x = ((const noam_int_value*)a)->value, y = ((const noam_int_value*)b)->value;
+            return x == y ? 0 : (x < y ? -1 : 1);
+        }
+        case NOAM_BOOL_TOKEN: {
+            int x = ((const noam_bool_value*)a)->value, y = ((const noam_bool_value*)b)->value;
+            return x == y ? 0 : (x < y ? -1 : 1);
+        }
+        case NOAM_FLOAT_TOKEN: {
+            float x = ((const noam_float_value*)a)->value, y = ((const noam_float_value*)b)->value;
+            return x == y ? 0 : (x < y ? -1 : 1);
+        }
+        case NOAM_STRING_TOKEN:
+            return noam_cmp_string(((const noam_string_value*)a)->str, ((const noam_string_value*)b)->str);
+        case NOAM_NIL_TOKEN:
+            return 0;
+        default:
+            return a == b ? 0 : (a < b ? -1 : 1);
+    }
+}
+
+noam_value* noam_map_value_get(noam_map_value* value, noam_vm* vm){
+    return value;
+}
+
+void noam_map_value_write(noam_map_value* value, noam_vm* vm){
+    if(value->frozen){
+        noam_vm_error(vm, "cannot change a global map inside pmap");
+    }
+}
+
+const char* noam_map_value_to_string(noam_map_value* value, noam_vm* vm){
+    /* the representation is built in the map, which other workers may print too */
+    if(value->frozen){
+        noam_vm_error(vm, "cannot print a global map inside pmap");
+    }
+
+    noam_buffer_clear(value->repr);
+    noam_buffer_push(value->repr, "{");
+
+    for(size_t i = 0, count = 0; i < value->dict->size; ++i){
+        noam_dict_node* node = noam_dict_node_at(value->dict, i);
+
+        if(!node->probe){
+            continue;
+        }
+
+        if(count++){
+            noam_buffer_append(value->repr, ", ", 2);
+        }
+
+        /* numbers are written to the scratch buffer of the vm, which the next part reuses, so each part is copied right away */
+        const char* key = noam_value_to_string(*(noam_value**)noam_dict_key(node), vm);
+        noam_buffer_append(value->repr, key, strlen(key));
+        noam_buffer_append(value->repr, ": ", 2);
+        const char* val = noam_value_to_string(*(noam_value**)noam_dict_value(value->dict, node), vm);
+        noam_buffer_append(value->repr, val, strlen(val));
+    }
+
+    noam_buffer_push(value->repr, "}");
+    noam_buffer_terminate(value->repr);
+    return value->repr->data;
+}
+
+void noam_map_value_release(noam_map_value* value){
+    noam_dict_release(value->dict);
+    noam_buffer_release(value->repr);
+}
+
+noam_map_value* noam_map_value_create(){
+    static noam_value_vtable_ noam_map_value_vtable[] = {{&noam_map_value_get,
+                                                                 &noam_map_value_release,
+                                                                 &noam_map_value_to_string,
+                                                                 NOAM_MAP_TOKEN}};
+    NOAM_TRACE(NOAM_TRACE_ALLOC, "noam_map_value_create\n");
+    noam_map_value* map_value = malloc(sizeof(noam_map_value));
+    NOAM_ALLOC_STAT("noam_map_value", sizeof(noam_map_value));
+    map_value->vtable_ = noam_map_value_vtable;
+    map_value->dict = noam_dict_createv(sizeof(noam_value*), sizeof(noam_value*),
+                                        (noam_hash_func)&noam_hash_value, (noam_cmp_func)&noam_cmp_value,
+                                        NULL);
+    map_value->repr = noam_buffer_create(1);
+    map_value->frozen = 0;
+    return map_value;
+}
+
+void noam_string_value_hash(noam_string_value* str){
+    str->hash = noam_hash_string(str->str);
+    str->hashed = 1;
+}
+
+noam_value* noam_map_get(noam_map_value* map, noam_value* key, noam_vm* vm){
+    noam_dict_node* node = noam_dict_find(map->dict, &key);
+
+    if(!node){
+        return NULL;
+    }
+    return *(noam_value**)noam_dict_value(map->dict, node);
+}
+
+void noam_map_set(noam_map_value* map, noam_value* key, noam_value* value){
+    noam_dict_node* node = noam_dict_find(map->dict, &key);
+
+    if(node){
+        memcpy(noam_dict_value(map->dict, node), &value, sizeof(noam_value*));
+        return;
+    }
+
+    /* a stored key must not change its hash, so strings and numbers, which may be updated in place, are owned by the map */
+    if(noam_value_is_instance(key, NOAM_INT_TOKEN)){
+        key = (noam_value*)noam_int_value_create(((noam_int_value*)key)->value);
+    } else if(noam_value_is_instance(key, NOAM_FLOAT_TOKEN)){
+        key = (noam_value*)noam_float_value_create(((noam_float_value*)key)->value);
+    } else if(noam_value_is_instance(key, NOAM_STRING_TOKEN)){
+        noam_string_value* str = (noam_string_value*)key;
+        size_t hash = noam_hash_value(&key);
+        key = (noam_value*)noam_string_value_create(str->str);
+        ((noam_string_value*)key)->hash = hash;
+        ((noam_string_value*)key)->hashed = 1;
+    }
+
+    noam_dict_insert(map->dict, &key, &value);
+}
+
+noam_value* noam_map_expression_get(noam_map_expression* expression, noam_vm* vm){
+    noam_map_value* map = noam_map_value_create();
+
+    for(size_t i = 0; i < expression->keys->length; ++i){
+        noam_expression** key = noam_buffer_at(expression->keys, i);
+        noam_expression** value = noam_buffer_at(expression->values, i);
+        noam_map_set(map, noam_expression_get(*key, vm), noam_expression_get(*value, vm));
+    }
+
+    return (noam_value*)map;
+}
+
+void noam_map_expression_release(noam_map_expression* expression){
+    noam_buffer_release(expression->keys);
+    noam_buffer_release(expression->values);
+}
+
+noam_map_expression* noam_map_expression_create(noam_buffer* keys, noam_buffer* values){
+    static noam_expression_vtable_ noam_map_expression_vtable[] = {{&noam_map_expression_get,
+                                                                           &noam_map_expression_release}};
+    NOAM_TRACE(NOAM_TRACE_PARSER, "noam_map_expression_create: %lu\n", keys->length);
+    noam_map_expression* expression = malloc(sizeof(noam_map_expression));
+    NOAM_ALLOC_STAT("noam_map_expression", sizeof(noam_map_expression));
+    expression->vtable_ = noam_map_expression_vtable;
+    expression->keys = keys;
+    expression->values = values;
+    return expression;
+}
+
+noam_map_value* noam_map_arg(noam_vm* vm, noam_value* value){
+    if(!noam_value_is_instance(value, NOAM_MAP_TOKEN)){
+        noam_vm_error(vm, "argument is not a map");
+    }
+    return (noam_map_value*)value;
+}
+
+noam_value* noam_builtin_has(noam_vm* vm, noam_value** args, size_t argc){
+    noam_map_value* map = noam_map_arg(vm, args[0]);
+    return (noam_value*)noam_bool_value_create(noam_dict_find(map->dict, &args[1]) != NULL);
+}
+
+noam_value* noam_builtin_remove(noam_vm* vm, noam_value** args, size_t argc){
+    noam_map_value* map = noam_map_arg(vm, args[0]);
+    noam_map_value_write(map, vm);
+    return (noam_value*)noam_bool_value_create(noam_dict_remove(map->dict, &args[1]));
+}
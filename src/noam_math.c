@@ -0,0 +1,364 @@
+#include <math.h>
+
+#include "noam_math.h"
+#include "noam_simd.h"
+
+#define NOAM_MATH_FLOAT_CHAR_LENGTH 48
+
+noam_value* noam_vec_value_get(noam_vec_value* value, noam_vm* vm){
+    return value;
+}
+
+const char* noam_vec_value_to_string(noam_vec_value* value, noam_vm* vm){
+    char* str = vm->scratch;
+    int length = sprintf(str, "vec%lu(", value->size);
+
+    for(size_t i = 0; i < value->size; ++i){
+        length += snprintf(str + length, NOAM_MATH_FLOAT_CHAR_LENGTH, i ? ", %f" : "%f", value->v[i]);
+    }
+
+    str[length++] = ')';
+    str[length] = '\0';
+    return str;
+}
+
+noam_vec_value* noam_vec_value_create(size_t size, const float* v){
+    static noam_value_vtable_ noam_vec_value_vtable[] = {{&noam_vec_value_get,
+                                                                 NULL,
+                                                                 &noam_vec_value_to_string,
+                                                                 NOAM_VEC_TOKEN}};
+    NOAM_TRACE(NOAM_TRACE_ALLOC, "noam_vec_value_create: %lu\n", size);
+    noam_vec_value* vec_value = malloc(sizeof(noam_vec_value));
+    NOAM_ALLOC_STAT("noam_vec_value", sizeof(noam_vec_value));
+    vec_value->vtable_ = noam_vec_value_vtable;
+    vec_value->size = size;
+    memset(vec_value->v, 0, sizeof(vec_value->v));
+    memcpy(vec_value->v, v, size * sizeof(float));
+    return vec_value;
+}
+
+noam_value* noam_mat_value_get(noam_mat_value* value, noam_vm* vm){
+    return value;
+}
+
+const char* noam_mat_value_to_string(noam_mat_value* value, noam_vm* vm){
+    char* str = vm->scratch;
+    int length = sprintf(str, "mat4(");
+
+    for(size_t i = 0; i < NOAM_MAT_SIZE; ++i){
+        length += snprintf(str + length, NOAM_MATH_FLOAT_CHAR_LENGTH, i ? ", %f" : "%f", value->m[i]);
+    }
+
+    str[length++] = ')';
+    str[length] = '\0';
+    return str;
+}
+
+noam_mat_value* noam_mat_value_create(const float* m){
+    static noam_value_vtable_ noam_mat_value_vtable[] = {{&noam_mat_value_get,
+                                                                 NULL,
+                                                                 &noam_mat_value_to_string,
+                                                                 NOAM_MAT_TOKEN}};
+    NOAM_TRACE(NOAM_TRACE_ALLOC, "noam_mat_value_create\n");
+    noam_mat_value* mat_value = malloc(sizeof(noam_mat_value));
+    NOAM_ALLOC_STAT("noam_mat_value", sizeof(noam_mat_value));
+    mat_value->vtable_ = noam_mat_value_vtable;
+    memcpy(mat_value->m, m, sizeof(mat_value->m));
+    return mat_value;
+}
+
+int noam_component_index(const noam_buffer* name){
+    static const char components[] = "xyzw";
+
+    if(name->length != 1){
+        return -1;
+    }
+
+    const char* component = strchr(components, *(const char*)name->data);
+    return component && *component ? (int)(component - components) : -1;
+}
+
+noam_value* noam_component_expression_get(noam_component_expression* expression, noam_vm* vm){
+    noam_value* target = noam_expression_get(expression->target, vm);
+
+    if(!noam_value_is_instance(target, NOAM_VEC_TOKEN)){
+        noam_vm_error(vm, "components are accessed on vectors only");
+    }
+
+    noam_vec_value* vec = (noam_vec_value*)target;
+
+    if(expression->component >= vec->size){
+        noam_vm_error(vm, "vec%lu has no such component", vec->size);
+    }
+
+    return (noam_value*)noam_float_value_create(vec->v[expression->component]);
+}
+
+void noam_component_expression_release(noam_component_expression* expression){
+    noam_expression_release(expression->target);
+}
+
+noam_component_expression* noam_component_expression_create(noam_expression* target, size_t component){
+    static noam_expression_vtable_ noam_component_expression_vtable[] = {{&noam_component_expression_get,
+                                                                                 &noam_component_expression_release}};
+    NOAM_TRACE(NOAM_TRACE_PARSER, "noam_component_expression_create: %lu\n", component);
+    noam_component_expression* expression = malloc(sizeof(noam_component_expression));
+    NOAM_ALLOC_STAT("noam_component_expression", sizeof(noam_component_expression));
+    expression->vtable_ = noam_component_expression_vtable;
+    expression->target = target;
+    expression->component = component;
+    return expression;
+}
+
+int noam_math_is_instance(const noam_value* value){
+    return noam_value_is_instance(value, NOAM_VEC_TOKEN) || noam_value_is_instance(value, NOAM_MAT_TOKEN);
+}
+
+/* noam_math_scalar: converts an int or a float operand, returns 0 for other types */
+int noam_math_scalar(noam_value* value, float* scalar){
+    if(noam_value_is_instance(value, NOAM_FLOAT_TOKEN)){
+        *scalar = ((noam_float_value*)value)->value;
+        return 1;
+    }
+    if(noam_value_is_instance(value, NOAM_INT_TOKEN)){
+        *scalar = (float)((noam_int_value*)value)->value;
+        return 1;
+    }
+    return 0;
+}
+
+float noam_math_scalar_arg(noam_vm* vm, noam_value* value){
+    float scalar = 0;
+
+    if(!noam_math_scalar(value, &scalar)){
+        noam_vm_error(vm, "argument is not a number");
+    }
+    return scalar;
+}
+
+noam_vec_value* noam_math_vec_arg(noam_vm* vm, noam_value* value){
+    if(!noam_value_is_instance(value, NOAM_VEC_TOKEN)){
+        noam_vm_error(vm, "argument is not a vector");
+    }
+    return (noam_vec_value*)value;
+}
+
+noam_mat_value* noam_math_mat_arg(noam_vm* vm, noam_value* value){
+    if(!noam_value_is_instance(value, NOAM_MAT_TOKEN)){
+        noam_vm_error(vm, "argument is not a matrix");
+    }
+    return (noam_mat_value*)value;
+}
+
+noam_value* noam_math_vec_op(noam_vm* vm, char op, noam_vec_value* lhs, noam_value* rhs){
+    float v[NOAM_VEC_MAX_SIZE];
+    float scalar = 0;
+
+    if(noam_value_is_instance(rhs, NOAM_VEC_TOKEN)){
+        noam_vec_value* other = (noam_vec_value*)rhs;
+
+        if(lhs->size != other->size){
+            noam_vm_error(vm, "vec%lu and vec%lu sizes mismatch", lhs->size, other->size);
+        }
+
+        switch(op){
+            case '+': noam_simd_vec4_add(v, lhs->v, other->v); break;
+            case '-': noam_simd_vec4_sub(v, lhs->v, other->v); break;
+            case '*': noam_simd_vec4_mul(v, lhs->v, other->v); break;
+            default: return NULL;
+        }
+    } else if(noam_math_scalar(rhs, &scalar)){
+        switch(op){
+            case '*': noam_simd_vec4_scale(v, lhs->v, scalar); break;
+            case '/': noam_simd_vec4_scale(v, lhs->v, 1.0f / scalar); break;
+            default: return NULL;
+        }
+    } else {
+        return NULL;
+    }
+
+    return (noam_value*)noam_vec_value_create(lhs->size, v);
+}
+
+noam_value* noam_math_mat_op(char op, noam_mat_value* lhs, noam_value* rhs){
+    float m[NOAM_MAT_SIZE];
+    float scalar = 0;
+
+    if(noam_value_is_instance(rhs, NOAM_MAT_TOKEN)){
+        noam_mat_value* other = (noam_mat_value*)rhs;
+
+        switch(op){
+            case '*':
+                noam_simd_mat4_mul(m, lhs->m, other->m);
+                break;
+            case '+':
+                for(size_t i = 0; i < NOAM_MAT_SIZE; i += 4){
+                    noam_simd_vec4_add(m + i, lhs->m + i, other->m + i);
+                }
+                break;
+            case '-':
+                for(size_t i = 0; i < NOAM_MAT_SIZE; i += 4){
+                    noam_simd_vec4_sub(m + i, lhs->m + i, other->m + i);
+                }
+                break;
+            default:
+                return NULL;
+        }
+    } else if(noam_value_is_instance(rhs, NOAM_VEC_TOKEN) && op == '*'){
+        noam_vec_value* vec = (noam_vec_value*)rhs;
+        float v[NOAM_VEC_MAX_SIZE];
+
+        if(vec->size < 3){
+            return NULL;
+        }
+
+        /* a vec3 is transformed as a point */
+        memcpy(v, vec->v, sizeof(v));
+        if(vec->size == 3){
+            v[3] = 1;
+        }
+
+        noam_simd_mat4_mul_vec4(v, lhs->m, v);
+        return (noam_value*)noam_vec_value_create(vec->size, v);
+    } else if(noam_math_scalar(rhs, &scalar) && op == '*'){
+        for(size_t i = 0; i < NOAM_MAT_SIZE; i += 4){
+            noam_simd_vec4_scale(m + i, lhs->m + i, scalar);
+        }
+    } else {
+        return NULL;
+    }
+
+    return (noam_value*)noam_mat_value_create(m);
+}
+
+noam_value* noam_math_op(noam_vm* vm, const char* op, noam_value* lhs, noam_value* rhs){
+    noam_value* result = NULL;
+
+    if(op[0] == '\0' || op[1] != '\0'){
+        result = NULL;
+    } else if(noam_value_is_instance(lhs, NOAM_VEC_TOKEN)){
+        result = noam_math_vec_op(vm, op[0], (noam_vec_value*)lhs, rhs);
+    } else if(noam_value_is_instance(lhs, NOAM_MAT_TOKEN)){
+        result = noam_math_mat_op(op[0], (noam_mat_value*)lhs, rhs);
+    } else if(op[0] == '*'){
+        /* scalar * vector and scalar * matrix commute */
+        float scalar = 0;
+        if(noam_math_scalar(lhs, &scalar)){
+            result = noam_math_op(vm, op, rhs, lhs);
+        }
+    }
+
+    if(!result){
+        noam_vm_error(vm, "unsupported operands for %s", op);
+    }
+
+    return result;
+}
+
+noam_value* noam_math_index(noam_vm* vm, noam_value* target, int index){
+    if(noam_value_is_instance(target, NOAM_VEC_TOKEN)){
+        noam_vec_value* vec = (noam_vec_value*)target;
+
+        if(index < 0 || (size_t)index >= vec->size){
+            noam_vm_error(vm, "vector index %d is out of range", index);
+        }
+        return (noam_value*)noam_float_value_create(vec->v[index]);
+    }
+
+    noam_mat_value* mat = noam_math_mat_arg(vm, target);
+
+    if(index < 0 || index >= 4){
+        noam_vm_error(vm, "matrix column %d is out of range", index);
+    }
+    return (noam_value*)noam_vec_value_create(4, mat->m + 4 * index);
+}
+
+noam_value* noam_math_vec_create(noam_vm* vm, noam_value** args, size_t argc){
+    float v[NOAM_VEC_MAX_SIZE];
+
+    for(size_t i = 0; i < argc; ++i){
+        v[i] = noam_math_scalar_arg(vm, args[i]);
+    }
+
+    return (noam_value*)noam_vec_value_create(argc, v);
+}
+
+noam_value* noam_builtin_vec2(noam_vm* vm, noam_value** args, size_t argc){
+    return noam_math_vec_create(vm, args, argc);
+}
+
+noam_value* noam_builtin_vec3(noam_vm* vm, noam_value** args, size_t argc){
+    return noam_math_vec_create(vm, args, argc);
+}
+
+noam_value* noam_builtin_vec4(noam_vm* vm, noam_value** args, size_t argc){
+    return noam_math_vec_create(vm, args, argc);
+}
+
+noam_value* noam_builtin_mat4(noam_vm* vm, noam_value** args, size_t argc){
+    float m[NOAM_MAT_SIZE] = {0};
+    float diagonal = noam_math_scalar_arg(vm, args[0]);
+
+    m[0] = m[5] = m[10] = m[15] = diagonal;
+    return (noam_value*)noam_mat_value_create(m);
+}
+
+noam_value* noam_builtin_translation(noam_vm* vm, noam_value** args, size_t argc){
+    float m[NOAM_MAT_SIZE] = {0};
+
+    m[0] = m[5] = m[10] = m[15] = 1;
+    m[12] = noam_math_scalar_arg(vm, args[0]);
+    m[13] = noam_math_scalar_arg(vm, args[1]);
+    m[14] = noam_math_scalar_arg(vm, args[2]);
+    return (noam_value*)noam_mat_value_create(m);
+}
+
+noam_value* noam_math_dot(noam_vm* vm, noam_value* lhs, noam_value* rhs){
+    noam_vec_value* a = noam_math_vec_arg(vm, lhs);
+    noam_vec_value* b = noam_math_vec_arg(vm, rhs);
+
+    if(a->size != b->size){
+        noam_vm_error(vm, "vec%lu and vec%lu sizes mismatch", a->size, b->size);
+    }
+    return (noam_value*)noam_float_value_create(noam_simd_vec4_dot(a->v, b->v));
+}
+
+noam_value* noam_builtin_length(noam_vm* vm, noam_value** args, size_t argc){
+    noam_vec_value* vec = noam_math_vec_arg(vm, args[0]);
+    return (noam_value*)noam_float_value_create(sqrtf(noam_simd_vec4_dot(vec->v, vec->v)));
+}
+
+noam_value* noam_builtin_normalize(noam_vm* vm, noam_value** args, size_t argc){
+    noam_vec_value* vec = noam_math_vec_arg(vm, args[0]);
+    float length = sqrtf(noam_simd_vec4_dot(vec->v, vec->v));
+    float v[NOAM_VEC_MAX_SIZE];
+
+    noam_simd_vec4_scale(v, vec->v, length > 0 ? 1.0f / length : 0.0f);
+    return (noam_value*)noam_vec_value_create(vec->size, v);
+}
+
+noam_value* noam_builtin_cross(noam_vm* vm, noam_value** args, size_t argc){
+    noam_vec_value* a = noam_math_vec_arg(vm, args[0]);
+    noam_vec_value* b = noam_math_vec_arg(vm, args[1]);
+
+    if(a->size != 3 || b->size != 3){
+        noam_vm_error(vm, "cross is defined for vec3 only");
+    }
+
+    float v[] = { a->v[1] * b->v[2] - a->v[2] * b->v[1],
+                  a->v[2] * b->v[0] - a->v[0] * b->v[2],
+                  a->v[0] * b->v[1] - a->v[1] * b->v[0] };
+    return (noam_value*)noam_vec_value_create(3, v);
+}
+
+noam_value* noam_builtin_transpose(noam_vm* vm, noam_value** args, size_t argc){
+    noam_mat_value* mat = noam_math_mat_arg(vm, args[0]);
+    float m[NOAM_MAT_SIZE];
+
+    for(size_t i = 0; i < 4; ++i){
+        for(size_t j = 0; j < 4; ++j){
+            m[4 * i + j] = mat->m[4 * j + i];
+        }
+    }
+    return (noam_value*)noam_mat_value_create(m);
+}
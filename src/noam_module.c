@@ -0,0 +1,390 @@
+#include "noam_module.h"
+
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+
+void noam_module_imports_release(void* data){
+    free(*(char**)data);
+}
+
+/* noam_module_key: the namespace of a path as a view into it, the file name without the extension */
+void noam_module_key(const char* path, noam_buffer* key){
+    const char* slash = strrchr(path, '/');
+    const char* name = slash ? slash + 1 : path;
+    const char* dot = strrchr(name, '.');
+
+    memset(key, 0, sizeof(noam_buffer));
+    key->data = (void*)name;
+    key->length = dot && dot != name ? (size_t)(dot - name) : strlen(name);
+    key->chunk = 1;
+}
+
+noam_module* noam_module_create(const char* path){
+    NOAM_TRACE(NOAM_TRACE_PARSER, "noam_module_create: %s\n", path);
+    noam_module* module = malloc(sizeof(noam_module));
+    NOAM_ALLOC_STAT("module", sizeof(noam_module));
+    noam_buffer key;
+    memset(module, 0, sizeof(noam_module));
+    noam_module_key(path, &key);
+
+    module->name = noam_buffer_create(1);
+    noam_buffer_merge(module->name, &key);
+    noam_buffer_terminate(module->name);
+
+    module->prefix = noam_buffer_create(1);
+    noam_buffer_merge(module->prefix, &key);
+    noam_buffer_append(module->prefix, ".", 1);
+    noam_buffer_terminate(module->prefix);
+
+    module->path = malloc(strlen(path) + 1);
+    strcpy(module->path, path);
+
+    /* keys are names of tokens, which stay alive with the parsed code */
+    module->funcs = noam_dict_createv(sizeof(noam_buffer), 0, &noam_hash_string, &noam_cmp_string, NULL);
+    module->names = noam_dict_createv(sizeof(noam_buffer), sizeof(noam_buffer*),
+                                      &noam_hash_string, &noam_cmp_string, NULL);
+    module->imports = noam_buffer_createv(sizeof(char*), &noam_module_imports_release);
+    module->deps = noam_buffer_create(sizeof(noam_module*));
+    module->state = NOAM_MODULE_NEW;
+    return module;
+}
+
+/* noam_module_reset: forgets a load which failed, so the next import loads the module again */
+void noam_module_reset(noam_module* module){
+    if(module->tokens){
+        noam_tokens_release(module->tokens);
+        module->tokens = NULL;
+    }
+
+    noam_dict_release(module->funcs);
+    module->funcs = noam_dict_createv(sizeof(noam_buffer), 0, &noam_hash_string, &noam_cmp_string, NULL);
+    noam_buffer_clear(module->imports);
+    noam_buffer_clear(module->deps);
+    module->error[0] = '\0';
+    module->state = NOAM_MODULE_NEW;
+}
+
+void noam_module_release(noam_module* module){
+    if(module->tokens){
+        noam_tokens_release(module->tokens);
+    }
+
+    /* qualified names are shared by the parsed code like the names of tokens */
+    noam_dict_release(module->names);
+    noam_dict_release(module->funcs);
+    noam_buffer_release(module->imports);
+    noam_buffer_release(module->deps);
+    noam_buffer_release(module->name);
+    noam_buffer_release(module->prefix);
+    free(module->path);
+    free(module);
+}
+
+noam_module* noam_module_find(noam_symbol_table* symbol_table, const noam_buffer* name){
+    noam_dict_node* node = noam_dict_find(symbol_table->modules, (void*)name);
+    return node ? *(noam_module**)noam_dict_value(symbol_table->modules, node) : NULL;
+}
+
+noam_module* noam_module_at(noam_symbol_table* symbol_table, const char* path){
+    noam_buffer key;
+    noam_module_key(path, &key);
+    noam_module* module = noam_module_find(symbol_table, &key);
+    return module && !strcmp(module->path, path) ? module : NULL;
+}
+
+noam_buffer* noam_module_qualify(noam_module* module, noam_buffer* name){
+    noam_dict_node* node = noam_dict_find(module->names, name);
+
+    if(node){
+        return *(noam_buffer**)noam_dict_value(module->names, node);
+    }
+
+    noam_buffer* qualified = noam_buffer_create(1);
+    noam_buffer_merge(qualified, module->prefix);
+    noam_buffer_merge(qualified, name);
+    noam_buffer_terminate(qualified);
+    noam_dict_insert(module->names, name, &qualified);
+    return qualified;
+}
+
+char* noam_module_resolve(const char* importer, const char* path){
+    const char* slash = importer ? strrchr(importer, '/') : NULL;
+    size_t dir = path[0] != '/' && slash ? (size_t)(slash - importer) + 1 : 0;
+    char* joined = malloc(dir + strlen(path) + 1);
+
+    memcpy(joined, importer, dir);
+    strcpy(joined + dir, path);
+
+    char* resolved = realpath(joined, NULL);
+    free(joined);
+    return resolved;
+}
+
+int noam_module_scan(noam_buffer* tokens, const char* path, noam_buffer* imports, noam_dict* funcs, char* error){
+    size_t depth = 0;
+
+    for(size_t i = 0; i < tokens->length; ++i){
+        noam_token_info* info = noam_buffer_at(tokens, i);
+
+        depth += info->token == NOAM_LB_TOKEN;
+        depth -= info->token == NOAM_RB_TOKEN && depth;
+
+        if(depth || info->token != NOAM_WORD_TOKEN || i + 1 == tokens->length){
+            continue;
+        }
+
+        noam_token_info* next = info + 1;
+
+        if(funcs && next->token == NOAM_WORD_TOKEN && !strcmp(info->name->data, NOAM_FUNC_STR)){
+            noam_dict_insert(funcs, next->name, NULL);
+        } else if(imports && next->token == NOAM_STRING_TOKEN && !strcmp(info->name->data, NOAM_IMPORT_STR)){
+            char* resolved = noam_module_resolve(path, next->name->data);
+
+            if(!resolved){
+                snprintf(error, NOAM_VM_ERROR_LENGTH, "cannot open the module %s", (const char*)next->name->data);
+                return 0;
+            }
+
+            noam_buffer_push(imports, &resolved);
+        }
+    }
+
+    return 1;
+}
+
+char* noam_module_read(const char* path){
+    FILE* file = fopen(path, "r");
+
+    if(!file){
+        return NULL;
+    }
+
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    if(length < 0){
+        fclose(file);
+        return NULL;
+    }
+
+    char* source = malloc((size_t)length + 2);
+    size_t read = fread(source, 1, (size_t)length, file);
+    fclose(file);
+
+    source[read] = ' ';
+    source[read + 1] = '\0';
+    return source;
+}
+
+/* noam_module_lex_file: lexes and scans a module, called on any thread, failures are left in `error` */
+void noam_module_lex_file(noam_module* module){
+    char* source = noam_module_read(module->path);
+
+    if(!source){
+        snprintf(module->error, NOAM_VM_ERROR_LENGTH, "cannot open the module %s", module->path);
+        return;
+    }
+
+    module->tokens = noam_parse_tokens(source);
+    free(source);
+
+    if(!module->tokens){
+        snprintf(module->error, NOAM_VM_ERROR_LENGTH, "unknown token in the module %s", module->path);
+        return;
+    }
+
+    if(noam_module_scan(module->tokens, module->path, module->imports, module->funcs, module->error)){
+        module->state = NOAM_MODULE_LEXED;
+    }
+}
+
+void* noam_module_thread(void* data){
+    noam_module_batch* batch = data;
+
+    for(;;){
+        pthread_mutex_lock(&batch->lock);
+        size_t i = batch->next++;
+        pthread_mutex_unlock(&batch->lock);
+
+        if(i >= batch->modules->length){
+            return NULL;
+        }
+
+        noam_module_lex_file(*(noam_module**)noam_buffer_at(batch->modules, i));
+    }
+}
+
+void noam_module_lex(noam_buffer* modules){
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t length = cpus > 0 ? (size_t)cpus : 1;
+    noam_module_batch batch;
+    sigset_t mask;
+    sigset_t previous;
+
+    if(length > modules->length){
+        length = modules->length;
+    }
+
+    if(!length){
+        return;
+    }
+
+    batch.modules = modules;
+    batch.next = 0;
+    pthread_mutex_init(&batch.lock, NULL);
+    pthread_t* threads = malloc(length * sizeof(pthread_t));
+
+    /* profiler samples land on the loading thread, like they do with the pool */
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGPROF);
+    pthread_sigmask(SIG_BLOCK, &mask, &previous);
+
+    for(size_t i = 1; i < length; ++i){
+        pthread_create(&threads[i], NULL, &noam_module_thread, &batch);
+    }
+
+    pthread_sigmask(SIG_SETMASK, &previous, NULL);
+
+    /* the loading thread lexes as well */
+    noam_module_thread(&batch);
+
+    for(size_t i = 1; i < length; ++i){
+        pthread_join(threads[i], NULL);
+    }
+
+    free(threads);
+    pthread_mutex_destroy(&batch.lock);
+}
+
+/* noam_module_add: the module of a resolved path, a module which is not loaded yet is queued to `level` */
+noam_module* noam_module_add(noam_vm* vm, const char* path, noam_buffer* level){
+    noam_buffer key;
+    noam_module_key(path, &key);
+    noam_module* module = noam_module_find(vm->symbol_table, &key);
+
+    if(!module){
+        module = noam_module_create(path);
+        noam_dict_insert(vm->symbol_table->modules, module->name, &module);
+    } else if(strcmp(module->path, path)){
+        noam_vm_syntax_error(vm, "module %s of %s is already imported from %s", (const char*)module->name->data,
+                             path, module->path);
+    }
+
+    if(module->state == NOAM_MODULE_NEW){
+        module->state = NOAM_MODULE_LEXING;
+        noam_buffer_push(level, &module);
+    }
+
+    return module;
+}
+
+void noam_module_parse(noam_vm* vm, noam_module* module){
+    /* a module being parsed is imported back by one of its imports, its functions are linked once defined */
+    if(module->state != NOAM_MODULE_LEXED){
+        return;
+    }
+
+    NOAM_TRACE(NOAM_TRACE_PARSER, "noam_module_parse: %s\n", module->path);
+    module->state = NOAM_MODULE_PARSING;
+
+    for(size_t i = 0; i < module->deps->length; ++i){
+        noam_module_parse(vm, *(noam_module**)noam_buffer_at(module->deps, i));
+    }
+
+    noam_parser parser;
+    memset(&parser, 0, sizeof(noam_parser));
+    parser.vm = vm;
+    parser.tokens = module->tokens;
+    parser.module = module;
+
+    noam_buffer* statements = noam_parse_statements(&parser, vm->symbol_table);
+    noam_tokens_release(module->tokens);
+    module->tokens = NULL;
+    noam_buffer_push(vm->symbol_table->main, &statements);
+    module->state = NOAM_MODULE_PARSED;
+}
+
+void noam_module_import(noam_vm* vm, noam_buffer* tokens, const char* path){
+    noam_buffer* imports = noam_buffer_createv(sizeof(char*), &noam_module_imports_release);
+    char error[NOAM_VM_ERROR_LENGTH];
+
+    if(!noam_module_scan(tokens, path, imports, NULL, error)){
+        noam_buffer_release(imports);
+        noam_vm_syntax_error(vm, "%s", error);
+    }
+
+    if(noam_buffer_empty(imports)){
+        noam_buffer_release(imports);
+        return;
+    }
+
+    noam_buffer* roots = noam_buffer_create(sizeof(noam_module*));
+    noam_buffer* level = noam_buffer_create(sizeof(noam_module*));
+    noam_buffer* next = noam_buffer_create(sizeof(noam_module*));
+    jmp_buf* prev = vm->recover;
+    jmp_buf recover;
+    vm->recover = &recover;
+
+    if(!setjmp(recover)){
+        for(size_t i = 0; i < imports->length; ++i){
+            noam_module* module = noam_module_add(vm, *(char**)noam_buffer_at(imports, i), level);
+            noam_buffer_push(roots, &module);
+        }
+
+        /* each level of the module graph is lexed at once, the imports found make the next one */
+        while(!noam_buffer_empty(level)){
+            noam_module_lex(level);
+
+            for(size_t i = 0; i < level->length; ++i){
+                noam_module* module = *(noam_module**)noam_buffer_at(level, i);
+
+                if(module->state != NOAM_MODULE_LEXED){
+                    noam_vm_syntax_error(vm, "%s", module->error);
+                }
+
+                for(size_t j = 0; j < module->imports->length; ++j){
+                    noam_module* dep = noam_module_add(vm, *(char**)noam_buffer_at(module->imports, j), next);
+                    noam_buffer_push(module->deps, &dep);
+                }
+            }
+
+            noam_buffer* swap = level;
+            level = next;
+            next = swap;
+            noam_buffer_clear(next);
+        }
+
+        for(size_t i = 0; i < roots->length; ++i){
+            noam_module_parse(vm, *(noam_module**)noam_buffer_at(roots, i));
+        }
+    } else {
+        /* modules of a failed load are loaded again by the next import, their functions stay defined
+         * like the ones of a script which failed to load */
+        noam_dict* modules = vm->symbol_table->modules;
+
+        for(size_t i = 0; i < modules->size; ++i){
+            noam_dict_node* node = noam_dict_node_at(modules, i);
+
+            if(node->probe && (*(noam_module**)noam_dict_value(modules, node))->state != NOAM_MODULE_PARSED){
+                noam_module_reset(*(noam_module**)noam_dict_value(modules, node));
+            }
+        }
+    }
+
+    noam_buffer_release(imports);
+    noam_buffer_release(roots);
+    noam_buffer_release(level);
+    noam_buffer_release(next);
+    vm->recover = prev;
+
+    if(vm->status != NOAM_OK){
+        longjmp(*prev, 1);
+    }
+}
+
+void noam_symbol_table_modules_release(void* data){
+    /* the key is the name of the module */
+    noam_module_release(*(noam_module**)((char*)data + sizeof(noam_buffer)));
+}
@@ -0,0 +1,212 @@
+#include "noam_native.h"
+
+#include <math.h>
+
+noam_native* noam_native_add(noam_vm* vm, const char* name, noam_native_signature signature,
+                             size_t arity){
+    NOAM_TRACE(NOAM_TRACE_EXEC, "noam_native_add: %s\n", name);
+    noam_symbol_table* symbol_table = vm->symbol_table;
+    noam_native* native = malloc(sizeof(noam_native));
+    memset(native, 0, sizeof(noam_native));
+    native->signature = signature;
+    native->arity = arity;
+
+    noam_buffer* key = noam_buffer_create(1);
+    noam_buffer_append(key, name, strlen(name));
+    noam_buffer_terminate(key);
+
+    noam_dict_node* node = noam_dict_find(symbol_table->natives, key);
+
+    /* expressions parsed before keep the previous function */
+    if(node){
+        *(noam_native**)noam_dict_value(symbol_table->natives, node) = native;
+        noam_buffer_release(key);
+    } else {
+        /* keys are stored inline, the dictionary owns the string data */
+        noam_dict_insert(symbol_table->natives, key, &native);
+        free(key);
+    }
+
+    return native;
+}
+
+noam_status noam_native_register(noam_vm* vm, const char* name, size_t arity,
+                                 noam_native_func func, void* data){
+    /* the host registers functions outside of any script, so there is nothing to recover to */
+    if(arity > NOAM_NATIVE_MAX_ARGS){
+        snprintf(vm->error, NOAM_VM_ERROR_LENGTH, "%s has too many params", name);
+        return vm->status = NOAM_RUNTIME_ERROR;
+    }
+
+    noam_native* native = noam_native_add(vm, name, NOAM_NATIVE_GENERIC, arity);
+    native->func.generic = func;
+    native->data = data;
+    return NOAM_OK;
+}
+
+noam_status noam_native_register_f_f(noam_vm* vm, const char* name, noam_native_f_f func){
+    noam_native_add(vm, name, NOAM_NATIVE_F_F, 1)->func.f_f = func;
+    return NOAM_OK;
+}
+
+noam_status noam_native_register_f_ff(noam_vm* vm, const char* name, noam_native_f_ff func){
+    noam_native_add(vm, name, NOAM_NATIVE_F_FF, 2)->func.f_ff = func;
+    return NOAM_OK;
+}
+
+noam_status noam_native_register_f_fff(noam_vm* vm, const char* name, noam_native_f_fff func){
+    noam_native_add(vm, name, NOAM_NATIVE_F_FFF, 3)->func.f_fff = func;
+    return NOAM_OK;
+}
+
+noam_status noam_native_register_i_i(noam_vm* vm, const char* name, noam_native_i_i func){
+    noam_native_add(vm, name, NOAM_NATIVE_I_I, 1)->func.i_i = func;
+    return NOAM_OK;
+}
+
+noam_status noam_native_register_i_ii(noam_vm* vm, const char* name, noam_native_i_ii func){
+    noam_native_add(vm, name, NOAM_NATIVE_I_II, 2)->func.i_ii = func;
+    return NOAM_OK;
+}
+
+int noam_native_abs(int value){
+    return value < 0 ? -value : value;
+}
+
+noam_status noam_native_register_math(noam_vm* vm){
+    noam_native_register_f_f(vm, "sqrt", &sqrtf);
+    noam_native_register_f_f(vm, "sin", &sinf);
+    noam_native_register_f_f(vm, "cos", &cosf);
+    noam_native_register_f_f(vm, "tan", &tanf);
+    noam_native_register_f_f(vm, "floor", &floorf);
+    noam_native_register_f_ff(vm, "pow", &powf);
+    noam_native_register_f_ff(vm, "atan2", &atan2f);
+    return noam_native_register_i_i(vm, "abs", &noam_native_abs);
+}
+
+const noam_native* noam_native_find(noam_symbol_table* symbol_table, noam_buffer* name){
+    noam_dict_node* node = noam_dict_find(symbol_table->natives, name);
+
+    if(!node){
+        return NULL;
+    }
+    return *(noam_native**)noam_dict_value(symbol_table->natives, node);
+}
+
+int noam_native_returns(const noam_expression* expression, int float_result){
+    if(expression->vtable_->get != (noam_expression_get_func)&noam_native_call_expression_get){
+        return 0;
+    }
+
+    noam_native_signature signature = ((const noam_native_call_expression*)expression)->native->signature;
+
+    if(float_result){
+        return signature == NOAM_NATIVE_F_F || signature == NOAM_NATIVE_F_FF || signature == NOAM_NATIVE_F_FFF;
+    }
+    return signature == NOAM_NATIVE_I_I || signature == NOAM_NATIVE_I_II;
+}
+
+noam_expression* noam_native_arg(noam_native_call_expression* expression, size_t index){
+    return *(noam_expression**)noam_buffer_at(expression->args, index);
+}
+
+/* noam_native_call_float, noam_native_call_int: run a fast call and return its unboxed result */
+float noam_native_call_float(noam_native_call_expression* expression, noam_vm* vm){
+    const noam_native* native = expression->native;
+
+    switch(native->signature){
+        case NOAM_NATIVE_F_F:
+            return native->func.f_f(noam_native_float(noam_native_arg(expression, 0), vm));
+        case NOAM_NATIVE_F_FF: {
+            float a = noam_native_float(noam_native_arg(expression, 0), vm);
+            float b = noam_native_float(noam_native_arg(expression, 1), vm);
+            return native->func.f_ff(a, b);
+        }
+        default: {
+            float a = noam_native_float(noam_native_arg(expression, 0), vm);
+            float b = noam_native_float(noam_native_arg(expression, 1), vm);
+            float c = noam_native_float(noam_native_arg(expression, 2), vm);
+            return native->func.f_fff(a, b, c);
+        }
+    }
+}
+
+int noam_native_call_int(noam_native_call_expression* expression, noam_vm* vm){
+    const noam_native* native = expression->native;
+
+    if(native->signature == NOAM_NATIVE_I_I){
+        return native->func.i_i(noam_native_int(noam_native_arg(expression, 0), vm));
+    }
+
+    int a = noam_native_int(noam_native_arg(expression, 0), vm);
+    int b = noam_native_int(noam_native_arg(expression, 1), vm);
+    return native->func.i_ii(a, b);
+}
+
+float noam_native_float(noam_expression* expression, noam_vm* vm){
+    if(noam_native_returns(expression, 1)){
+        return noam_native_call_float((noam_native_call_expression*)expression, vm);
+    } else if(noam_native_returns(expression, 0)){
+        return (float)noam_native_call_int((noam_native_call_expression*)expression, vm);
+    }
+
+    noam_value* value = noam_expression_get(expression, vm);
+
+    if(noam_value_is_instance(value, NOAM_FLOAT_TOKEN)){
+        return ((noam_float_value*)value)->value;
+    } else if(noam_value_is_instance(value, NOAM_INT_TOKEN)){
+        return (float)((noam_int_value*)value)->value;
+    }
+
+    noam_vm_error(vm, "argument is not a number");
+}
+
+int noam_native_int(noam_expression* expression, noam_vm* vm){
+    if(noam_native_returns(expression, 0)){
+        return noam_native_call_int((noam_native_call_expression*)expression, vm);
+    }
+
+    noam_value* value = noam_expression_get(expression, vm);
+
+    if(!noam_value_is_instance(value, NOAM_INT_TOKEN)){
+        noam_vm_error(vm, "argument is not an int");
+    }
+    return ((noam_int_value*)value)->value;
+}
+
+noam_value* noam_native_call_expression_get(noam_native_call_expression* expression, noam_vm* vm){
+    const noam_native* native = expression->native;
+
+    switch(native->signature){
+        case NOAM_NATIVE_GENERIC: {
+            noam_value* args[NOAM_NATIVE_MAX_ARGS];
+
+            for(size_t i = 0; i < expression->args->length; ++i){
+                args[i] = noam_expression_get(noam_native_arg(expression, i), vm);
+            }
+
+            return native->func.generic(vm, args, expression->args->length, native->data);
+        }
+        case NOAM_NATIVE_I_I:
+        case NOAM_NATIVE_I_II:
+            return (noam_value*)noam_int_value_create(noam_native_call_int(expression, vm));
+        default:
+            return (noam_value*)noam_float_value_create(noam_native_call_float(expression, vm));
+    }
+}
+
+void noam_native_call_expression_release(noam_native_call_expression* expression){
+    noam_buffer_release(expression->args);
+}
+
+noam_native_call_expression* noam_native_call_expression_create(const noam_native* native, noam_buffer* args){
+    static noam_expression_vtable_ noam_native_call_expression_vtable[] = {{&noam_native_call_expression_get,
+                                                                                   &noam_native_call_expression_release}};
+    NOAM_TRACE(NOAM_TRACE_PARSER, "noam_native_call_expression_create\n");
+    noam_native_call_expression* expression = malloc(sizeof(noam_native_call_expression));
+    NOAM_ALLOC_STAT("noam_native_call_expression", sizeof(noam_native_call_expression));
+    expression->vtable_ = noam_native_call_expression_vtable;
+    expression->native = native;
+    expression->args = args;
+    return expression;
+}
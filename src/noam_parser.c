@@ -1,4 +1,5 @@
 #include "noam_parser.h"
+#include "noam_module.h"
 
 noam_token_info* noam_get_token_info(noam_parser* parser, int offset){
     return noam_buffer_at(parser->tokens, parser->index + offset);
@@ -44,40 +45,153 @@ noam_token_info* noam_consume_token_str(noam_parser* parser, const char* name){
     return noam_get_token_info(parser, -1);
 }
 
-noam_buffer* noam_parse_func_args(noam_parser* parser, noam_symbol_table* symbol_table, noam_scope* current_scope){
-    noam_buffer* args = noam_buffer_createv(sizeof(noam_expression*), &noam_expression_release);
+noam_buffer* noam_parse_list(noam_parser* parser, noam_symbol_table* symbol_table, noam_scope* current_scope,
+                             noam_token end_token){
+    noam_buffer* list = noam_buffer_createv(sizeof(noam_expression*), &noam_expression_release);
+    const char* end = end_token == NOAM_RP_TOKEN ? ")" : "]";
 
-    if(!noam_match_token(parser, NOAM_RP_TOKEN)){
-        noam_expression* arg = noam_parse_expression(parser, symbol_table, current_scope);
-        noam_buffer_push(args, &arg);
+    if(!noam_match_token(parser, end_token)){
+        noam_expression* element = noam_parse_expression(parser, symbol_table, current_scope);
 
-        while(!noam_match_token(parser, NOAM_RP_TOKEN)){
+        if(!element){
+            noam_vm_syntax_error(parser->vm, "expected an expression");
+        }
+
+        noam_buffer_push(list, &element);
+
+        while(!noam_match_token(parser, end_token)){
             if(!noam_match_token(parser, NOAM_COMMA_TOKEN)){
-                //TODO: Error
+                noam_vm_syntax_error(parser->vm, "expected , or %s", end);
             }
-            arg = noam_parse_expression(parser, symbol_table, current_scope);
-            noam_buffer_push(args, &arg);
+
+            element = noam_parse_expression(parser, symbol_table, current_scope);
+
+            if(!element){
+                noam_vm_syntax_error(parser->vm, "expected an expression");
+            }
+
+            noam_buffer_push(list, &element);
         }
     }
 
-    return args;
+    return list;
 }
 
-noam_expression* noam_parse_atomic(noam_parser* parser, noam_symbol_table* symbol_table, noam_scope* current_scope){
+noam_buffer* noam_parse_func_args(noam_parser* parser, noam_symbol_table* symbol_table, noam_scope* current_scope){
+    return noam_parse_list(parser, symbol_table, current_scope, NOAM_RP_TOKEN);
+}
+
+noam_expression* noam_parse_builtin_call(noam_parser* parser, noam_symbol_table* symbol_table, noam_scope* current_scope,
+                                         const noam_builtin* builtin){
+    noam_buffer* args = noam_parse_func_args(parser, symbol_table, current_scope);
+
+    if(args->length != builtin->arity){
+        noam_vm_syntax_error(parser->vm, "%s expects %lu arguments, %lu given", builtin->name, builtin->arity, args->length);
+    }
+
+    return noam_builtin_call_expression_create(builtin, args);
+}
+
+noam_expression* noam_parse_native_call(noam_parser* parser, noam_symbol_table* symbol_table, noam_scope* current_scope,
+                                        const noam_native* native){
+    noam_token_info* name = noam_get_token_info(parser, -2);
+    noam_buffer* args = noam_parse_func_args(parser, symbol_table, current_scope);
+
+    if(args->length != native->arity){
+        noam_vm_syntax_error(parser->vm, "%s expects %lu arguments, %lu given",
+                             (const char*)name->name->data, native->arity, args->length);
+    }
+
+    return noam_native_call_expression_create(native, args);
+}
+
+noam_buffer* noam_parse_name(noam_parser* parser, noam_scope* scope, noam_buffer* name){
+    size_t slot = 0;
+
+    if(!parser->module || (noam_scope_frame(scope)->parent && noam_scope_find(scope, name, &slot))){
+        return name;
+    }
+    return noam_module_qualify(parser->module, name);
+}
+
+noam_buffer* noam_parse_call_name(noam_parser* parser, noam_buffer* name){
+    if(parser->module && noam_dict_find(parser->module->funcs, name)){
+        return noam_module_qualify(parser->module, name);
+    }
+    return name;
+}
+
+noam_expression* noam_parse_map(noam_parser* parser, noam_symbol_table* symbol_table, noam_scope* current_scope){
+    noam_buffer* keys = noam_buffer_createv(sizeof(noam_expression*), &noam_expression_release);
+    noam_buffer* values = noam_buffer_createv(sizeof(noam_expression*), &noam_expression_release);
+
+    while(!noam_match_token(parser, NOAM_RB_TOKEN)){
+        if(keys->length && !noam_match_token(parser, NOAM_COMMA_TOKEN)){
+            noam_vm_syntax_error(parser->vm, "expected , between map pairs");
+        }
+
+        noam_expression* key = noam_parse_expression(parser, symbol_table, current_scope);
+
+        if(!key || !noam_match_token(parser, NOAM_COLON_TOKEN)){
+            noam_vm_syntax_error(parser->vm, "expected key: value in a map literal");
+        }
+
+        noam_expression* value = noam_parse_expression(parser, symbol_table, current_scope);
+        noam_buffer_push(keys, &key);
+        noam_buffer_push(values, &value);
+    }
+
+    return noam_map_expression_create(keys, values);
+}
+
+noam_expression* noam_parse_primary(noam_parser* parser, noam_symbol_table* symbol_table, noam_scope* current_scope){
     if(noam_match_token(parser, NOAM_WORD_TOKEN)){
         noam_token_info* info = noam_get_token_info(parser, -1);
+        noam_module* module = noam_get_token_info(parser, 0)->token == NOAM_DOT_TOKEN ?
+                              noam_module_find(symbol_table, info->name) : NULL;
+
+        /* `module.name` is a function or a global of an imported module */
+        if(module && noam_match_tokens(parser, NOAM_DOT_TOKEN, NOAM_WORD_TOKEN)){
+            noam_buffer* name = noam_module_qualify(module, noam_get_token_info(parser, -1)->name);
+
+            if(noam_match_token(parser, NOAM_LP_TOKEN)){
+                noam_buffer* args = noam_parse_func_args(parser, symbol_table, current_scope);
+                return noam_func_call_expression_create(name, args, symbol_table);
+            }
+            return noam_variable_expression_create(name, current_scope);
+        }
+
         if(noam_match_token(parser, NOAM_LP_TOKEN)){
+            noam_buffer* name = noam_parse_call_name(parser, info->name);
+
+            /* functions of the script shadow host functions and built-ins, wherever they are defined */
+            if(!noam_dict_find(symbol_table->funcs, name) && !(parser->funcs && noam_dict_find(parser->funcs, name))){
+                const noam_native* native = noam_native_find(symbol_table, name);
+
+                if(native){
+                    return noam_parse_native_call(parser, symbol_table, current_scope, native);
+                }
+
+                const noam_builtin* builtin = noam_builtin_find(name);
+
+                if(builtin){
+                    return noam_parse_builtin_call(parser, symbol_table, current_scope, builtin);
+                }
+            }
+
             noam_buffer* args = noam_parse_func_args(parser, symbol_table, current_scope);
-            return noam_func_call_expression_create(info->name, args, symbol_table);
+            return noam_func_call_expression_create(name, args, symbol_table);
         } else {
-            return noam_variable_expression_create(info->name, current_scope);
+            return noam_variable_expression_create(noam_parse_name(parser, current_scope, info->name), current_scope);
         }
     } else if(noam_match_token(parser, NOAM_INT_TOKEN)){
         return noam_int_value_create(atoi(noam_get_token_info(parser, -1)->name->data));
     } else if(noam_match_token(parser, NOAM_FLOAT_TOKEN)){
         return noam_float_value_create(atof(noam_get_token_info(parser, -1)->name->data));
     } else if(noam_match_token(parser, NOAM_STRING_TOKEN)){
-        return noam_string_value_create(noam_get_token_info(parser, -1)->name);
+        noam_string_value* str = noam_string_value_create(noam_get_token_info(parser, -1)->name);
+        noam_string_value_hash(str);
+        return str;
     } else if(noam_match_token(parser, NOAM_BOOL_TOKEN)){
         return noam_bool_value_create(noam_atob(noam_get_token_info(parser, -1)->name->data));
     } else if(noam_match_token(parser, NOAM_NIL_TOKEN)){
@@ -85,45 +199,124 @@ noam_expression* noam_parse_atomic(noam_parser* parser, noam_symbol_table* symbo
     } else if(noam_match_token(parser, NOAM_LP_TOKEN)){
         noam_expression* expression = noam_parse_expression(parser, symbol_table, current_scope);
 
-        if(!noam_match_token(parser, NOAM_RP_TOKEN)){
-            //TODO: Error
+        if(!expression || !noam_match_token(parser, NOAM_RP_TOKEN)){
+            noam_vm_syntax_error(parser->vm, "expected )");
         }
 
         return expression;
+    } else if(noam_match_token(parser, NOAM_LS_TOKEN)){
+        noam_buffer* elements = noam_parse_list(parser, symbol_table, current_scope, NOAM_RS_TOKEN);
+        return noam_array_expression_create(elements);
+    } else if(noam_match_token(parser, NOAM_LB_TOKEN)){
+        return noam_parse_map(parser, symbol_table, current_scope);
     }
     //TODO: Error
     return NULL;
 }
 
-noam_expression* noam_parse_op(noam_parser* parser, noam_symbol_table* symbol_table, noam_scope* current_scope){
+noam_expression* noam_parse_atomic(noam_parser* parser, noam_symbol_table* symbol_table, noam_scope* current_scope){
+    noam_expression* expression = noam_parse_primary(parser, symbol_table, current_scope);
+
+    while(expression){
+        if(noam_match_token(parser, NOAM_LS_TOKEN)){
+            noam_expression* index = noam_parse_expression(parser, symbol_table, current_scope);
+
+            if(!index){
+                noam_vm_syntax_error(parser->vm, "expected an index");
+            }
+
+            if(!noam_match_token(parser, NOAM_RS_TOKEN)){
+                noam_vm_syntax_error(parser->vm, "expected ]");
+            }
+
+            expression = noam_index_expression_create(expression, index);
+        } else if(noam_match_tokens(parser, NOAM_DOT_TOKEN, NOAM_WORD_TOKEN)){
+            noam_token_info* info = noam_get_token_info(parser, -1);
+            int component = noam_component_index(info->name);
+
+            if(component < 0){
+                noam_vm_syntax_error(parser->vm, "unknown component %s", (const char*)info->name->data);
+            }
+
+            expression = noam_component_expression_create(expression, (size_t)component);
+        } else {
+            break;
+        }
+    }
+
+    return expression;
+}
+
+int noam_op_precedence(const noam_buffer* op){
+    switch(*(const char*)op->data){
+        case '*':
+        case '/':
+            return 3;
+        case '+':
+        case '-':
+            return 2;
+        case '<':
+        case '>':
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+noam_expression* noam_parse_binary(noam_parser* parser, noam_symbol_table* symbol_table, noam_scope* current_scope,
+                                   int precedence){
     noam_expression* lhs_expression = noam_parse_atomic(parser, symbol_table, current_scope);
 
-    while(noam_match_token(parser, NOAM_OP_TOKEN)){
-        noam_token_info* op = noam_get_token_info(parser, -1);
-        noam_expression* rhs_expression = noam_parse_atomic(parser, symbol_table, current_scope);
-        //TODO: Generalize op type to string
-        return noam_op_expression_create(lhs_expression, op->name, rhs_expression);
+    while(lhs_expression && noam_get_token_info(parser, 0)->token == NOAM_OP_TOKEN){
+        noam_token_info* op = noam_get_token_info(parser, 0);
+        int op_precedence = noam_op_precedence(op->name);
+
+        if(op_precedence < precedence){
+            break;
+        }
+
+        ++parser->index;
+
+        /* operators of the same precedence associate to the left */
+        noam_expression* rhs_expression = noam_parse_binary(parser, symbol_table, current_scope, op_precedence + 1);
+
+        if(!rhs_expression){
+            noam_vm_syntax_error(parser->vm, "expected an expression after %s", (const char*)op->name->data);
+        }
+
+        lhs_expression = noam_op_expression_create(lhs_expression, op->name, rhs_expression);
     }
 
     return lhs_expression;
 }
 
+noam_expression* noam_parse_op(noam_parser* parser, noam_symbol_table* symbol_table, noam_scope* current_scope){
+    return noam_parse_binary(parser, symbol_table, current_scope, 0);
+}
+
 noam_expression* noam_parse_expression(noam_parser* parser, noam_symbol_table* symbol_table, noam_scope* current_scope){
     return noam_parse_op(parser, symbol_table, current_scope);
 }
 
-void noam_parser_init(noam_parser* parser, const char* source){
+void noam_parser_init(noam_parser* parser, noam_vm* vm, const char* source){
     memset(parser, 0, sizeof(noam_parser));
+    parser->vm = vm;
     parser->tokens = noam_parse_tokens(source);
 
-    /*for(size_t i = 0; i < parser->tokens->length; ++i){
-        noam_token_info* info = noam_buffer_at(parser->tokens, i);
-        printf("%s %s\n", (char*)info->name->data, noam_token_to_string(info->token));
-    }*/
+    if(!parser->tokens){
+        noam_vm_syntax_error(vm, "unknown token");
+    }
+
+    if(NOAM_TRACE_ON(NOAM_TRACE_LEXER)){
+        for(size_t i = 0; i < parser->tokens->length; ++i){
+            noam_token_info* info = noam_buffer_at(parser->tokens, i);
+            noam_trace_write(NOAM_TRACE_LEXER, "%s %s\n", (char*)info->name->data, noam_token_to_string(info->token));
+        }
+    }
 }
 
 int noam_parser_end(noam_parser* parser){
-    return parser->index < parser->tokens->length;
+    return noam_get_token_info(parser, 0)->token != NOAM_EOF_TOKEN;
 }
 
 
@@ -132,10 +325,14 @@ noam_cond_statement* noam_parse_cond(noam_parser* parser, noam_symbol_table* sym
     noam_buffer* blocks = noam_buffer_createv(sizeof(noam_buffer), &noam_buffer_release);
     noam_expression* cond = noam_parse_expression(parser, symbol_table, scope);
 
+    if(!cond){
+        noam_vm_syntax_error(parser->vm, "expected a condition after if");
+    }
+
     noam_buffer_push(conds, &cond);
 
     if(!noam_match_token(parser, NOAM_LB_TOKEN)){
-        //TODO: Error
+        noam_vm_syntax_error(parser->vm, "expected { after the condition");
     }
 
     noam_buffer* block = noam_parse_block(parser, symbol_table, scope);
@@ -143,7 +340,7 @@ noam_cond_statement* noam_parse_cond(noam_parser* parser, noam_symbol_table* sym
     //noam_buffer_release(block);
 
     if(!noam_match_token(parser, NOAM_RB_TOKEN)){
-        //TODO: Error
+        noam_vm_syntax_error(parser->vm, "expected } at the end of the if");
     }
 
     int last_cond = 0;
@@ -151,7 +348,7 @@ noam_cond_statement* noam_parse_cond(noam_parser* parser, noam_symbol_table* sym
     while(noam_match_token_str(parser, NOAM_ELSE_STR)){
 
         if(last_cond){
-            //TODO: Error
+            noam_vm_syntax_error(parser->vm, "else after the last else");
         }
 
         if(noam_match_token_str(parser, NOAM_IF_STR)){
@@ -162,11 +359,16 @@ noam_cond_statement* noam_parse_cond(noam_parser* parser, noam_symbol_table* sym
 
         if(!last_cond){
             cond = noam_parse_expression(parser, symbol_table, scope);
+
+            if(!cond){
+                noam_vm_syntax_error(parser->vm, "expected a condition after else if");
+            }
+
             noam_buffer_push(conds, &cond);
         }
 
         if(!noam_match_token(parser, NOAM_LB_TOKEN)){
-            //TODO: Error
+            noam_vm_syntax_error(parser->vm, "expected { after else");
         }
 
         block = noam_parse_block(parser, symbol_table, scope);
@@ -175,13 +377,168 @@ noam_cond_statement* noam_parse_cond(noam_parser* parser, noam_symbol_table* sym
         //noam_buffer_release(block);
 
         if(!noam_match_token(parser, NOAM_RB_TOKEN)){
-            //TODO: Error
+            noam_vm_syntax_error(parser->vm, "expected } at the end of the else");
         }
     }
 
     return noam_cond_statement_create(conds, blocks, last_cond);
 }
 
+int noam_parser_mentions(noam_parser* parser, size_t begin, const noam_buffer* name){
+    for(size_t i = begin; i < parser->index; ++i){
+        noam_token_info* info = noam_buffer_at(parser->tokens, i);
+
+        if(info->token == NOAM_WORD_TOKEN && !noam_cmp_string(info->name, name)){
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int noam_parser_escapes(noam_parser* parser, size_t begin, const noam_buffer* name){
+    for(size_t i = begin; i < parser->index; ++i){
+        noam_token_info* info = noam_buffer_at(parser->tokens, i);
+
+        if(info->token != NOAM_WORD_TOKEN || noam_cmp_string(info->name, name)){
+            continue;
+        }
+
+        noam_token prev = (info - 1)->token;
+        noam_token next = (info + 1)->token;
+
+        /* an operand or a range limit is read into a new value, a component name isn't the variable */
+        if(prev == NOAM_OP_TOKEN || next == NOAM_OP_TOKEN || prev == NOAM_RANGE_TOKEN || next == NOAM_RANGE_TOKEN ||
+           prev == NOAM_DOT_TOKEN){
+            continue;
+        }
+
+        /* an index is only looked up, maps copy the keys they store */
+        if(prev == NOAM_LS_TOKEN && next == NOAM_RS_TOKEN && i - begin >= 2 &&
+           ((info - 2)->token == NOAM_WORD_TOKEN || (info - 2)->token == NOAM_RS_TOKEN ||
+            (info - 2)->token == NOAM_RP_TOKEN)){
+            continue;
+        }
+
+        /* `print i` and `print(i)` */
+        if((prev == NOAM_WORD_TOKEN && !strcmp((info - 1)->name->data, NOAM_PRINT_STR)) ||
+           (prev == NOAM_LP_TOKEN && next == NOAM_RP_TOKEN && i - begin >= 2 &&
+            (info - 2)->token == NOAM_WORD_TOKEN && !strcmp((info - 2)->name->data, NOAM_PRINT_STR))){
+            continue;
+        }
+
+        return 1;
+    }
+    return 0;
+}
+
+noam_range_statement* noam_parse_range(noam_parser* parser, noam_symbol_table* symbol_table, noam_scope* scope,
+                                       noam_token_info* key, noam_expression* from){
+    noam_expression* to = noam_parse_expression(parser, symbol_table, scope);
+
+    if(!from || !to){
+        noam_vm_syntax_error(parser->vm, "expected a range like 0..n");
+    }
+
+    /* the loop variable is local to the loop */
+    noam_scope* loop_scope = noam_scope_add_child(NULL, scope);
+    noam_buffer* name = noam_parse_name(parser, loop_scope, key->name);
+    int global = 0;
+    noam_scope_declare(loop_scope, name, &global);
+
+    if(!noam_match_token(parser, NOAM_LB_TOKEN)){
+        noam_vm_syntax_error(parser->vm, "expected { after the range");
+    }
+
+    size_t begin = parser->index;
+    noam_buffer* block = noam_parse_block(parser, symbol_table, loop_scope);
+
+    if(!noam_match_token(parser, NOAM_RB_TOKEN)){
+        noam_vm_syntax_error(parser->vm, "expected } at the end of the loop");
+    }
+
+    return noam_range_statement_create(name, from, to, block, noam_parser_mentions(parser, begin, key->name),
+                                       noam_parser_escapes(parser, begin, key->name), loop_scope);
+}
+
+noam_statement* noam_parse_for(noam_parser* parser, noam_symbol_table* symbol_table, noam_scope* scope){
+    noam_token_info* key = noam_consume_token(parser, NOAM_WORD_TOKEN);
+    noam_token_info* value = NULL;
+
+    if(!key){
+        noam_vm_syntax_error(parser->vm, "expected a loop variable");
+    }
+
+    if(noam_match_token(parser, NOAM_COMMA_TOKEN)){
+        value = noam_consume_token(parser, NOAM_WORD_TOKEN);
+
+        if(!value || noam_parse_keyword(value->name)){
+            noam_vm_syntax_error(parser->vm, "expected a loop variable after ,");
+        }
+    }
+
+    if(!noam_match_token_str(parser, NOAM_IN_STR)){
+        noam_vm_syntax_error(parser->vm, "expected in after loop variables");
+    }
+
+    noam_expression* iterable = noam_parse_expression(parser, symbol_table, scope);
+
+    if(!iterable){
+        noam_vm_syntax_error(parser->vm, "expected an expression after in");
+    }
+
+    if(!value && noam_match_token(parser, NOAM_RANGE_TOKEN)){
+        return (noam_statement*)noam_parse_range(parser, symbol_table, scope, key, iterable);
+    }
+
+    noam_buffer* key_name = noam_parse_name(parser, scope, key->name);
+    noam_buffer* value_name = value ? noam_parse_name(parser, scope, value->name) : NULL;
+    int global = 0;
+
+    /* loop variables get their slots before the body refers to them */
+    noam_scope_declare(scope, key_name, &global);
+
+    if(value){
+        noam_scope_declare(scope, value_name, &global);
+    }
+
+    if(!noam_match_token(parser, NOAM_LB_TOKEN)){
+        noam_vm_syntax_error(parser->vm, "expected { after the iterable");
+    }
+
+    noam_buffer* block = noam_parse_block(parser, symbol_table, scope);
+
+    if(!noam_match_token(parser, NOAM_RB_TOKEN)){
+        noam_vm_syntax_error(parser->vm, "expected } at the end of the loop");
+    }
+
+    return (noam_statement*)noam_for_statement_create(key_name, value_name, iterable, block, scope);
+}
+
+noam_while_statement* noam_parse_while(noam_parser* parser, noam_symbol_table* symbol_table, noam_scope* scope){
+    noam_expression* condition = noam_parse_expression(parser, symbol_table, scope);
+
+    if(!condition){
+        noam_vm_syntax_error(parser->vm, "expected a condition after while");
+    }
+
+    if(!noam_match_token(parser, NOAM_LB_TOKEN)){
+        noam_vm_syntax_error(parser->vm, "expected { after the loop condition");
+    }
+
+    noam_buffer* block = noam_parse_block(parser, symbol_table, scope);
+
+    if(!noam_match_token(parser, NOAM_RB_TOKEN)){
+        noam_vm_syntax_error(parser->vm, "expected } at the end of the loop");
+    }
+
+    return noam_while_statement_create(condition, block);
+}
+
+void noam_parse_push(noam_buffer* statements, noam_statement* statement, size_t line){
+    statement->line = line;
+    noam_buffer_push(statements, &statement);
+}
+
 noam_buffer* noam_parse_block(noam_parser* parser, noam_symbol_table* symbol_table, noam_scope* current_scope){
 
     noam_buffer* statements = noam_buffer_create(sizeof(noam_statement*));
@@ -190,37 +547,96 @@ noam_buffer* noam_parse_block(noam_parser* parser, noam_symbol_table* symbol_tab
 
         while(noam_match_token(parser, NOAM_LINE_TOKEN));
 
+        size_t line = noam_get_token_info(parser, 0)->line;
+
+        /* function definitions are handled by noam_parse_statements */
+        if(noam_match_token_str(parser, NOAM_FUNC_STR)){
+            --parser->index;
+            break;
+        }
+
+        /* the imported modules are loaded by noam_module_import before the script is parsed */
+        if(noam_match_token_str(parser, NOAM_IMPORT_STR)){
+            if(current_scope != symbol_table->head){
+                noam_vm_syntax_error(parser->vm, "import outside of the top level");
+            }
+
+            if(!noam_consume_token(parser, NOAM_STRING_TOKEN)){
+                noam_vm_syntax_error(parser->vm, "expected a path after import");
+            }
+            continue;
+        }
+
         if(noam_match_tokens(parser, NOAM_WORD_TOKEN, NOAM_EQ_TOKEN)){
             noam_token_info* info = noam_get_token_info(parser, -2);
             noam_expression* expression = noam_parse_expression(parser, symbol_table, current_scope);
+
+            if(!expression){
+                noam_vm_syntax_error(parser->vm, "expected an expression after =");
+            }
+
             void* assigment_statement = noam_assignment_statement_create(
-                    info->name, expression, current_scope
+                    noam_parse_name(parser, current_scope, info->name), expression, current_scope
             );
-            noam_buffer_push(statements, &assigment_statement);
+            noam_parse_push(statements, assigment_statement, line);
+        } else if(noam_match_tokens(parser, NOAM_WORD_TOKEN, NOAM_OP_EQ_TOKEN)){
+            noam_token_info* info = noam_get_token_info(parser, -2);
+            noam_token_info* op = noam_get_token_info(parser, -1);
+            noam_expression* expression = noam_parse_expression(parser, symbol_table, current_scope);
+
+            if(!expression){
+                noam_vm_syntax_error(parser->vm, "expected an expression after %s", (const char*)op->name->data);
+            }
+
+            void* compound_statement = noam_compound_assignment_statement_create(
+                    noam_parse_name(parser, current_scope, info->name), *(const char*)op->name->data, expression,
+                    current_scope
+            );
+            noam_parse_push(statements, compound_statement, line);
         } else if (noam_match_token_str(parser, NOAM_PRINT_STR)){
             void* print_statement = noam_print_statement_create(
                     noam_parse_expression(parser, symbol_table, current_scope)
             );
-            noam_buffer_push(statements, &print_statement);
+            noam_parse_push(statements, print_statement, line);
         } else if(noam_match_token_str(parser, NOAM_IF_STR)){
             void* cond_statement = noam_parse_cond(parser, symbol_table, current_scope);
-            noam_buffer_push(statements, &cond_statement);
+            noam_parse_push(statements, cond_statement, line);
+        } else if(noam_match_token_str(parser, NOAM_FOR_STR)){
+            void* for_statement = noam_parse_for(parser, symbol_table, current_scope);
+            noam_parse_push(statements, for_statement, line);
+        } else if(noam_match_token_str(parser, NOAM_WHILE_STR)){
+            void* while_statement = noam_parse_while(parser, symbol_table, current_scope);
+            noam_parse_push(statements, while_statement, line);
         } else if(noam_match_token(parser, NOAM_LB_TOKEN)) {
             noam_buffer* block = noam_parse_block(parser, symbol_table, noam_scope_add_child(NULL, current_scope));
 
             if (!noam_match_token(parser, NOAM_RB_TOKEN)) {
-                //TODO: Error
-            }
-
-            if(!noam_buffer_empty(block)){
-                noam_buffer_merge(statements, block);
+                noam_vm_syntax_error(parser->vm, "expected } at the end of the block");
             }
 
-            //noam_buffer_release(block);
+            /* the statements are copied, the block buffer doesn't release them */
+            noam_buffer_merge(statements, block);
+            noam_buffer_release(block);
         } else if(noam_match_token_str(parser, NOAM_RETURN_STR)){
             noam_expression* expression = noam_parse_expression(parser, symbol_table, current_scope);
+
+            /* only calls returned from a function have a frame to reuse */
+            if(expression && noam_expression_is_func_call(expression) && noam_scope_frame(current_scope)->parent){
+                noam_func_call_expression_tail((noam_func_call_expression*)expression);
+            }
+
             void* return_statement = noam_return_statement_create(expression);
-            noam_buffer_push(statements, &return_statement);
+            noam_parse_push(statements, return_statement, line);
+        } else if(noam_match_token_str(parser, NOAM_YIELD_STR)){
+            if(!noam_scope_frame(current_scope)->parent){
+                noam_vm_syntax_error(parser->vm, "yield outside of a function");
+            }
+
+            parser->yields = 1;
+            void* yield_statement = noam_yield_statement_create(
+                    noam_parse_expression(parser, symbol_table, current_scope)
+            );
+            noam_parse_push(statements, yield_statement, line);
         } else {
             noam_expression* expression = noam_parse_expression(parser, symbol_table, current_scope);
 
@@ -228,8 +644,21 @@ noam_buffer* noam_parse_block(noam_parser* parser, noam_symbol_table* symbol_tab
                 break;
             }
 
-            void* statement = noam_expression_statement_create(expression);
-            noam_buffer_push(statements, &statement);
+            void* statement = NULL;
+
+            if(noam_match_token(parser, NOAM_EQ_TOKEN)){
+                if(!noam_expression_is_index(expression)){
+                    noam_vm_syntax_error(parser->vm, "cannot assign to an expression");
+                }
+                noam_expression* value = noam_parse_expression(parser, symbol_table, current_scope);
+                statement = noam_index_assignment_statement_create((noam_index_expression*)expression, value);
+            } else if(noam_get_token_info(parser, 0)->token == NOAM_OP_EQ_TOKEN){
+                noam_vm_syntax_error(parser->vm, "cannot assign to an expression");
+            } else {
+                statement = noam_expression_statement_create(expression);
+            }
+
+            noam_parse_push(statements, statement, line);
         }
 
     }
@@ -237,24 +666,234 @@ noam_buffer* noam_parse_block(noam_parser* parser, noam_symbol_table* symbol_tab
     return statements;
 }
 
+/* noam_parse_unexpected: reports a token no statement starts with, called when a block consumes nothing */
+void noam_parse_unexpected(noam_parser* parser){
+    noam_vm_syntax_error(parser->vm, "unexpected token %s", (const char*)noam_get_token_info(parser, 0)->name->data);
+}
+
+/* noam_parse_body: parses statements of a function body up to its closing } */
+void noam_parse_body(noam_parser* parser, noam_symbol_table* symbol_table, noam_scope* scope, noam_func* func){
+    parser->yields = 0;
+
+    noam_buffer* body = noam_buffer_createv(sizeof(noam_statement*), &noam_statement_release);
+
+    while(!noam_match_token(parser, NOAM_RB_TOKEN)){
+        if(!noam_parser_end(parser)){
+            noam_vm_syntax_error(parser->vm, "expected } at the end of %s", (const char*)func->name->data);
+        }
+
+        size_t index = parser->index;
+        noam_buffer* block = noam_parse_block(parser, symbol_table, scope);
+
+        if(parser->index == index){
+            noam_parse_unexpected(parser);
+        }
+
+        /* the statements are copied, the block buffer doesn't release them */
+        noam_buffer_merge(body, block);
+        noam_buffer_release(block);
+    }
+
+    func->body = body;
+    func->slots = scope->slots;
+    func->coroutine = parser->yields;
+}
+
+/* noam_parse_keyword: words which never name a variable */
+int noam_parse_keyword(const noam_buffer* name){
+    static const char* keywords[] = {NOAM_IF_STR, NOAM_ELSE_STR, NOAM_PRINT_STR, NOAM_FUNC_STR, NOAM_RETURN_STR,
+                                     NOAM_FOR_STR, NOAM_IN_STR, NOAM_WHILE_STR, NOAM_YIELD_STR,
+                                     NOAM_IMPORT_STR};
+
+    for(size_t i = 0; i < sizeof(keywords) / sizeof(const char*); ++i){
+        if(!strcmp(name->data, keywords[i])){
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void noam_parse_skip(noam_parser* parser, noam_symbol_table* symbol_table, noam_scope* scope, noam_func* func){
+    size_t begin = parser->index;
+    size_t depth = 1;
+
+    while(depth){
+        noam_token_info* info = noam_get_token_info(parser, 0);
+
+        if(info->token == NOAM_EOF_TOKEN){
+            noam_vm_syntax_error(parser->vm, "expected } at the end of %s", (const char*)func->name->data);
+        }
+
+        depth += info->token == NOAM_LB_TOKEN;
+        depth -= info->token == NOAM_RB_TOKEN;
+        ++parser->index;
+    }
+
+    /* the body and a trailing EOF token, allocated once */
+    noam_buffer* tokens = noam_buffer_create(sizeof(noam_token_info));
+    noam_buffer_grow(tokens, parser->index - begin + 1);
+
+    for(size_t i = begin; i < parser->index; ++i){
+        noam_token_info* info = noam_buffer_at(parser->tokens, i);
+
+        /* a read of a name unknown to the function declares a global like noam_scope_lookup does,
+         * a name assigned in the body is declared as well, which only costs an unused slot */
+        if(info->token == NOAM_WORD_TOKEN && !noam_parse_keyword(info->name) &&
+           (i == begin || (info - 1)->token != NOAM_DOT_TOKEN) && (info + 1)->token != NOAM_LP_TOKEN){
+            noam_module* module = (info + 1)->token == NOAM_DOT_TOKEN && (info + 2)->token == NOAM_WORD_TOKEN ?
+                                  noam_module_find(symbol_table, info->name) : NULL;
+            int global = 0;
+
+            if(!module){
+                noam_scope_lookup(scope, noam_parse_name(parser, scope, info->name), &global);
+            } else if((info + 3)->token != NOAM_LP_TOKEN){
+                noam_scope_lookup(scope, noam_module_qualify(module, (info + 2)->name), &global);
+            }
+        }
+
+        func->coroutine |= info->token == NOAM_WORD_TOKEN && !strcmp(info->name->data, NOAM_YIELD_STR);
+        NOAM_ALLOC_STAT("token", sizeof(noam_token_info));
+        noam_buffer_push(tokens, info);
+
+        /* names of literals are released with the tokens, the body tokens own them now */
+        if(info->token != NOAM_WORD_TOKEN && info->token != NOAM_OP_TOKEN){
+            info->name = NULL;
+        }
+    }
+
+    noam_buffer* eof = noam_buffer_create(1);
+    noam_token_push(tokens, eof, NOAM_EOF_TOKEN, noam_get_token_info(parser, -1)->line);
+    noam_buffer_release(eof);
+
+    func->tokens = tokens;
+    func->scope = scope;
+}
+
+void noam_func_compile(noam_func* func, noam_vm* vm){
+    noam_parser parser;
+
+    if(vm->shared){
+        noam_vm_syntax_error(vm, "%s is not parsed, a shared vm cannot parse", (const char*)func->name->data);
+    }
+
+    NOAM_TRACE(NOAM_TRACE_PARSER, "noam_func_compile: %s\n", (const char*)func->name->data);
+    memset(&parser, 0, sizeof(noam_parser));
+    parser.tokens = func->tokens;
+    parser.vm = vm;
+    parser.module = func->module;
+
+    noam_parse_body(&parser, vm->symbol_table, func->scope, func);
+    noam_tokens_release(func->tokens);
+    func->tokens = NULL;
+    noam_func_call_expression_link(vm->symbol_table);
+}
+
+void noam_parse_pending(noam_vm* vm){
+    noam_dict* funcs = vm->symbol_table->funcs;
+
+    for(size_t i = 0; i < funcs->size; ++i){
+        noam_dict_node* node = noam_dict_node_at(funcs, i);
+
+        if(node->probe && (*(noam_func**)noam_dict_value(funcs, node))->tokens){
+            noam_func_compile(*(noam_func**)noam_dict_value(funcs, node), vm);
+        }
+    }
+}
+
+size_t noam_parse_hash(noam_parser* parser, size_t begin, size_t* end){
+    size_t hash = 5381;
+    size_t depth = 0;
+    size_t i = begin;
+
+    for(;; ++i){
+        noam_token_info* info = noam_buffer_at(parser->tokens, i);
+
+        if(info->token == NOAM_EOF_TOKEN){
+            break;
+        }
+
+        hash = ((hash << 5) + hash) + (size_t)info->token;
+
+        for(size_t j = 0; info->name && j < info->name->length; ++j){
+            hash = ((hash << 5) + hash) + ((const unsigned char*)info->name->data)[j];
+        }
+
+        depth += info->token == NOAM_LB_TOKEN;
+
+        if(info->token == NOAM_RB_TOKEN && !--depth){
+            ++i;
+            break;
+        }
+    }
+
+    *end = i;
+    return hash;
+}
+
+void noam_parse_define(noam_symbol_table* symbol_table, noam_func* func){
+    noam_dict_node* node = noam_dict_find(symbol_table->funcs, func->name);
+
+    /* calls keep a pointer to the function, so a redefinition is done in place */
+    if(node){
+        **(noam_func**)noam_dict_value(symbol_table->funcs, node) = *func;
+        free(func);
+    } else {
+        noam_dict_insert(symbol_table->funcs, func->name, &func);
+    }
+}
+
+void noam_parse_skip_statements(noam_parser* parser){
+    size_t depth = 0;
+
+    for(;;){
+        noam_token_info* info = noam_get_token_info(parser, 0);
+
+        if(info->token == NOAM_EOF_TOKEN || (!depth && info->token == NOAM_WORD_TOKEN &&
+                                              !strcmp(info->name->data, NOAM_FUNC_STR))){
+            return;
+        }
+
+        depth += info->token == NOAM_LB_TOKEN || info->token == NOAM_LS_TOKEN || info->token == NOAM_LP_TOKEN;
+        depth -= depth && (info->token == NOAM_RB_TOKEN || info->token == NOAM_RS_TOKEN ||
+                           info->token == NOAM_RP_TOKEN);
+        ++parser->index;
+    }
+}
+
 void noam_parse_func(noam_parser* parser, noam_symbol_table* symbol_table, noam_scope** scope){
     noam_token_info* func_name = noam_consume_token(parser, NOAM_WORD_TOKEN);
 
     if(!func_name){
-        //TODO: Error
+        noam_vm_syntax_error(parser->vm, "expected a function name");
+    }
+
+    size_t end = 0;
+    size_t hash = noam_parse_hash(parser, parser->index - 1, &end);
+    noam_buffer* name = parser->module ? noam_module_qualify(parser->module, func_name->name) : func_name->name;
+
+    /* a reload keeps the functions whose tokens didn't change */
+    if(parser->reload){
+        noam_dict_node* node = noam_dict_find(symbol_table->funcs, name);
+
+        if(node && (*(noam_func**)noam_dict_value(symbol_table->funcs, node))->hash == hash){
+            parser->index = end;
+            return;
+        }
     }
 
     if(!noam_match_token(parser, NOAM_LP_TOKEN)){
-        //TODO: Error
+        noam_vm_syntax_error(parser->vm, "expected (");
     }
 
-    noam_buffer* params = noam_buffer_createv(sizeof(noam_buffer), &noam_buffer_release);
+    /* the names belong to the tokens, so the list doesn't release them */
+    noam_buffer* params = noam_buffer_create(sizeof(noam_buffer));
 
     if(!noam_match_token(parser, NOAM_RP_TOKEN)){
         noam_token_info* param = noam_consume_token(parser, NOAM_WORD_TOKEN);
 
         if(!param){
-            //TODO: Error
+            noam_buffer_release(params);
+            noam_vm_syntax_error(parser->vm, "expected a param");
         }
 
         noam_buffer_push(params, param->name);
@@ -262,13 +901,15 @@ void noam_parse_func(noam_parser* parser, noam_symbol_table* symbol_table, noam_
         while(!noam_match_token(parser, NOAM_RP_TOKEN)){
 
             if(!noam_match_token(parser, NOAM_COMMA_TOKEN)){
-                //TODO: Error
+                noam_buffer_release(params);
+                noam_vm_syntax_error(parser->vm, "expected , or )");
             }
 
             param = noam_consume_token(parser, NOAM_WORD_TOKEN);
 
             if(!param){
-                //TODO: Error
+                noam_buffer_release(params);
+                noam_vm_syntax_error(parser->vm, "expected a param");
             }
 
             noam_buffer_push(params, param->name);
@@ -276,47 +917,71 @@ void noam_parse_func(noam_parser* parser, noam_symbol_table* symbol_table, noam_
     }
 
     if(!noam_match_token(parser, NOAM_LB_TOKEN)){
-        //TODO: Error
+        noam_buffer_release(params);
+        noam_vm_syntax_error(parser->vm, "expected {");
     }
 
     if(!*scope){
-        *scope = noam_scope_add_child(func_name->name, symbol_table->head);
+        *scope = noam_scope_add_child(name, symbol_table->head);
     } else {
-        *scope = noam_scope_add_sibling(func_name->name, *scope);
+        *scope = noam_scope_add_sibling(name, *scope);
     }
 
-    //TODO: Check that releases
-    noam_buffer* body = noam_buffer_createv(sizeof(noam_statement*), &noam_statement_release);
-
-    while(!noam_match_token(parser, NOAM_RB_TOKEN)){
-        noam_buffer* block = noam_parse_block(parser, symbol_table, *scope);
+    /* params take the first slots of the frame in order */
+    for(size_t i = 0; i < params->length; ++i){
+        int global = 0;
+        noam_scope_declare(*scope, noam_buffer_at(params, i), &global);
+    }
 
-        if(!noam_buffer_empty(block)){
-            noam_buffer_merge(body, block);
-        }
+    noam_func* func = noam_func_create(name, params, NULL);
+    func->module = parser->module;
+    func->hash = hash;
 
-        //noam_buffer_release(block);
+    if(parser->vm->lazy){
+        noam_parse_skip(parser, symbol_table, *scope, func);
+    } else {
+        noam_parse_body(parser, symbol_table, *scope, func);
     }
 
-    noam_func* func = noam_func_create(func_name->name, params, body);
-    noam_dict_insert(symbol_table->funcs, func_name->name, func);
+    if(parser->reload){
+        noam_buffer_push(parser->reload, &func);
+    } else {
+        noam_parse_define(symbol_table, func);
+    }
 }
 
 noam_buffer* noam_parse_statements(noam_parser* parser, noam_symbol_table* symbol_table){
     noam_buffer* statements = noam_buffer_create(sizeof(noam_statement*));
-    noam_scope* last_scope = NULL;
+
+    /* keys are names of the tokens, which outlive the parse */
+    if(!parser->module){
+        parser->funcs = noam_dict_createv(sizeof(noam_buffer), 0, &noam_hash_string, &noam_cmp_string, NULL);
+        noam_module_scan(parser->tokens, NULL, NULL, parser->funcs, parser->vm->error);
+    }
 
     while(noam_parser_end(parser)){
         if(noam_match_token_str(parser, NOAM_FUNC_STR)){
-            noam_parse_func(parser, symbol_table, &last_scope);
+            noam_parse_func(parser, symbol_table, &symbol_table->last);
+        } else if(parser->reload){
+            noam_parse_skip_statements(parser);
         } else {
+            size_t index = parser->index;
             noam_buffer* block = noam_parse_block(parser, symbol_table, symbol_table->head);
-            if(noam_buffer_empty(block))
-                continue;
+
+            if(parser->index == index){
+                noam_parse_unexpected(parser);
+            }
+
             noam_buffer_merge(statements, block);
-            //noam_buffer_release(block);
+            noam_buffer_release(block);
         }
     }
 
+    if(parser->funcs){
+        noam_dict_release(parser->funcs);
+        parser->funcs = NULL;
+    }
+
+    noam_func_call_expression_link(symbol_table);
     return statements;
 }
\ No newline at end of file
@@ -0,0 +1,373 @@
+#include "noam_pool.h"
+#include "noam_parser.h"
+#include "noam_map.h"
+
+#include <signal.h>
+#include <unistd.h>
+
+/* noam_pool_take: takes a chunk from the front of the worker range, returns 0 if it's empty */
+int noam_pool_take(noam_pool_worker* worker, size_t* begin, size_t* end){
+    pthread_mutex_lock(&worker->lock);
+
+    size_t left = worker->end - worker->begin;
+    size_t chunk = (left + 3) / 4;
+
+    *begin = worker->begin;
+    *end = worker->begin + chunk;
+    worker->begin += chunk;
+
+    pthread_mutex_unlock(&worker->lock);
+    return chunk != 0;
+}
+
+/* noam_pool_steal: moves the back half of the range of another worker to `worker`, returns 0 if all are empty */
+int noam_pool_steal(noam_pool_worker* worker){
+    noam_pool* pool = worker->pool;
+    size_t self = (size_t)(worker - pool->workers);
+
+    for(size_t i = 1; i < pool->length; ++i){
+        noam_pool_worker* victim = &pool->workers[(self + i) % pool->length];
+        size_t begin = 0;
+        size_t end = 0;
+
+        pthread_mutex_lock(&victim->lock);
+
+        if(victim->end > victim->begin){
+            end = victim->end;
+            begin = victim->end - (victim->end - victim->begin + 1) / 2;
+            victim->end = begin;
+        }
+
+        pthread_mutex_unlock(&victim->lock);
+
+        if(end > begin){
+            pthread_mutex_lock(&worker->lock);
+            worker->begin = begin;
+            worker->end = end;
+            pthread_mutex_unlock(&worker->lock);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/* noam_pool_fail: keeps the first error, returns 1 if the job has failed */
+int noam_pool_fail(noam_pool* pool, noam_vm* vm){
+    pthread_mutex_lock(&pool->lock);
+
+    if(vm && !pool->job->failed){
+        pool->job->failed = 1;
+        memcpy(pool->job->error, vm->error, NOAM_VM_ERROR_LENGTH);
+    }
+
+    int failed = pool->job->failed;
+    pthread_mutex_unlock(&pool->lock);
+    return failed;
+}
+
+/* noam_pool_map: maps the elements from `begin` to `end`, returns 0 on an error left in the vm */
+int noam_pool_map(noam_vm* vm, noam_pool_job* job, size_t begin, size_t end){
+    noam_array_value* array = job->array;
+    int indexed = job->func->params->length == 2;
+
+    for(size_t i = begin; i < end; ++i){
+        noam_value* args[2];
+        noam_value* element = array->elem == NOAM_INT_TOKEN ?
+                              (noam_value*)noam_int_value_create(*(int*)noam_array_value_at(array, i)) :
+                              (noam_value*)noam_float_value_create(*(float*)noam_array_value_at(array, i));
+
+        args[0] = indexed ? (noam_value*)noam_int_value_create((int)i) : element;
+        args[1] = element;
+
+        if(noam_vm_call_func(vm, job->func, args, indexed ? 2 : 1, &job->results[i]) != NOAM_OK){
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+/* noam_pool_work: maps chunks of the job until no worker has any left or one of them fails */
+void noam_pool_work(noam_pool_worker* worker, noam_vm* vm){
+    noam_pool* pool = worker->pool;
+    size_t begin = 0;
+    size_t end = 0;
+
+    while(noam_pool_take(worker, &begin, &end) || (noam_pool_steal(worker) && noam_pool_take(worker, &begin, &end))){
+        if(noam_pool_fail(pool, noam_pool_map(vm, pool->job, begin, end) ? NULL : vm)){
+            return;
+        }
+    }
+}
+
+void* noam_pool_thread(void* data){
+    noam_pool_worker* worker = data;
+    noam_pool* pool = worker->pool;
+    size_t generation = 0;
+
+    for(;;){
+        pthread_mutex_lock(&pool->lock);
+
+        while(pool->generation == generation && !pool->quit){
+            pthread_cond_wait(&pool->start, &pool->lock);
+        }
+
+        generation = pool->generation;
+        int quit = pool->quit;
+        pthread_mutex_unlock(&pool->lock);
+
+        if(quit){
+            return NULL;
+        }
+
+        noam_pool_job* job = pool->job;
+        noam_stack* stack = worker->vm->stack;
+
+        noam_stack_globals(stack, job->globals_length);
+        memcpy(stack->slots, job->globals, job->globals_length * sizeof(noam_value*));
+        noam_pool_work(worker, worker->vm);
+
+        pthread_mutex_lock(&pool->lock);
+
+        if(!--pool->active){
+            pthread_cond_signal(&pool->finish);
+        }
+
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+noam_pool* noam_pool_create(noam_vm* vm){
+    NOAM_TRACE(NOAM_TRACE_EXEC, "noam_pool_create\n");
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    noam_pool* pool = malloc(sizeof(noam_pool));
+    sigset_t mask;
+    sigset_t previous;
+    memset(pool, 0, sizeof(noam_pool));
+    pool->length = cpus > 0 ? (size_t)cpus : 1;
+    pool->workers = malloc(pool->length * sizeof(noam_pool_worker));
+    memset(pool->workers, 0, pool->length * sizeof(noam_pool_worker));
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->start, NULL);
+    pthread_cond_init(&pool->finish, NULL);
+
+    /* the threads inherit the mask, so profiler samples land on the thread of the sampled vm */
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGPROF);
+    pthread_sigmask(SIG_BLOCK, &mask, &previous);
+
+    for(size_t i = 0; i < pool->length; ++i){
+        noam_pool_worker* worker = &pool->workers[i];
+        pthread_mutex_init(&worker->lock, NULL);
+        worker->pool = pool;
+
+        if(i){
+            worker->vm = noam_vm_share(vm);
+            worker->vm->worker = 1;
+            pthread_create(&worker->thread, NULL, &noam_pool_thread, worker);
+        }
+    }
+
+    pthread_sigmask(SIG_SETMASK, &previous, NULL);
+    return pool;
+}
+
+void noam_pool_destroy(noam_pool* pool){
+    pthread_mutex_lock(&pool->lock);
+    pool->quit = 1;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+
+    for(size_t i = 0; i < pool->length; ++i){
+        noam_pool_worker* worker = &pool->workers[i];
+
+        if(i){
+            pthread_join(worker->thread, NULL);
+            noam_vm_destroy(worker->vm);
+        }
+        pthread_mutex_destroy(&worker->lock);
+    }
+
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->start);
+    pthread_cond_destroy(&pool->finish);
+    free(pool->workers);
+    free(pool);
+}
+
+void noam_pool_run(noam_pool* pool, noam_vm* vm, noam_pool_job* job){
+    size_t length = job->array->data->length;
+    pool->running = 1;
+
+    /* even ranges to begin with, stealing evens out the rest */
+    for(size_t i = 0; i < pool->length; ++i){
+        pool->workers[i].begin = length * i / pool->length;
+        pool->workers[i].end = length * (i + 1) / pool->length;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->job = job;
+    pool->active = pool->length - 1;
+    ++pool->generation;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+
+    noam_pool_work(&pool->workers[0], vm);
+
+    pthread_mutex_lock(&pool->lock);
+
+    while(pool->active){
+        pthread_cond_wait(&pool->finish, &pool->lock);
+    }
+
+    pool->job = NULL;
+    pthread_mutex_unlock(&pool->lock);
+    pool->running = 0;
+}
+
+/* noam_pool_freeze: freezes the maps and arrays reachable from `value`, pushes the ones it froze to `frozen` */
+void noam_pool_freeze(noam_value* value, noam_buffer* frozen){
+    if(noam_value_is_instance(value, NOAM_ARRAY_TOKEN)){
+        noam_array_value* array = (noam_array_value*)value;
+
+        if(!array->frozen){
+            array->frozen = 1;
+            noam_buffer_push(frozen, &value);
+        }
+    } else if(noam_value_is_instance(value, NOAM_MAP_TOKEN)){
+        noam_map_value* map = (noam_map_value*)value;
+
+        if(map->frozen){
+            return;
+        }
+
+        map->frozen = 1;
+        noam_buffer_push(frozen, &value);
+
+        for(size_t i = 0; i < map->dict->size; ++i){
+            noam_dict_node* node = noam_dict_node_at(map->dict, i);
+
+            if(node->probe){
+                noam_pool_freeze(*(noam_value**)noam_dict_value(map->dict, node), frozen);
+            }
+        }
+    }
+}
+
+/* noam_pool_thaw: unfreezes the maps and arrays frozen by noam_pool_freeze and releases `frozen` */
+void noam_pool_thaw(noam_buffer* frozen){
+    for(size_t i = 0; i < frozen->length; ++i){
+        noam_value* value = *(noam_value**)noam_buffer_at(frozen, i);
+
+        if(noam_value_is_instance(value, NOAM_ARRAY_TOKEN)){
+            ((noam_array_value*)value)->frozen = 0;
+        } else {
+            ((noam_map_value*)value)->frozen = 0;
+        }
+    }
+
+    noam_buffer_release(frozen);
+}
+
+noam_value* noam_builtin_pmap(noam_vm* vm, noam_value** args, size_t argc){
+    if(!noam_value_is_instance(args[0], NOAM_STRING_TOKEN)){
+        noam_vm_error(vm, "argument is not a function name");
+    }
+
+    if(!noam_value_is_instance(args[1], NOAM_ARRAY_TOKEN)){
+        noam_vm_error(vm, "argument is not an array");
+    }
+
+    noam_buffer* name = ((noam_string_value*)args[0])->str;
+    noam_dict_node* node = noam_dict_find(vm->symbol_table->funcs, name);
+
+    if(!node){
+        noam_vm_error(vm, "unknown function %s", (const char*)name->data);
+    }
+
+    noam_pool_job job;
+    memset(&job, 0, sizeof(noam_pool_job));
+    job.func = *(noam_func**)noam_dict_value(vm->symbol_table->funcs, node);
+    job.array = (noam_array_value*)args[1];
+
+    if(job.func->params->length != 1 && job.func->params->length != 2){
+        noam_vm_error(vm, "%s must take an element or an index and an element", (const char*)name->data);
+    }
+
+    /* the workers share the code and cannot parse, so a lazy vm parses every pending body first */
+    if(!vm->worker){
+        noam_parse_pending(vm);
+    }
+
+    size_t length = job.array->data->length;
+    job.results = malloc((length ? length : 1) * sizeof(noam_value*));
+    job.globals_length = vm->symbol_table->head->slots;
+    job.globals = malloc((job.globals_length ? job.globals_length : 1) * sizeof(noam_value*));
+    memcpy(job.globals, vm->stack->slots, job.globals_length * sizeof(noam_value*));
+
+    /* the workers read the same values, so none of them may be updated in place,
+     * and the maps and arrays among them may not be changed at all */
+    noam_buffer* frozen = noam_buffer_create(sizeof(noam_value*));
+    noam_pool_freeze((noam_value*)job.array, frozen);
+
+    for(size_t i = 0; i < job.globals_length; ++i){
+        if(job.globals[i]){
+            noam_value_share(job.globals[i]);
+            noam_pool_freeze(job.globals[i], frozen);
+        }
+    }
+
+    /* workers don't start pools of their own */
+    if(!vm->pool && !vm->worker){
+        vm->pool = noam_pool_create(vm);
+    }
+
+    /* the workers and their ranges belong to the running job, a nested pmap maps serially like a worker does */
+    if(vm->pool && !vm->pool->running){
+        noam_pool_run(vm->pool, vm, &job);
+    } else if(!noam_pool_map(vm, &job, 0, length)){
+        job.failed = 1;
+        memcpy(job.error, vm->error, NOAM_VM_ERROR_LENGTH);
+    }
+
+    /* the calling thread maps on the stack of the caller, its assignments to the globals are undone */
+    memcpy(vm->stack->slots, job.globals, job.globals_length * sizeof(noam_value*));
+    free(job.globals);
+    noam_pool_thaw(frozen);
+
+    if(job.failed){
+        free(job.results);
+        noam_vm_error(vm, "%s", job.error);
+    }
+
+    noam_token elem = NOAM_INT_TOKEN;
+
+    for(size_t i = 0; i < length; ++i){
+        if(!job.results[i] || (!noam_value_is_instance(job.results[i], NOAM_INT_TOKEN) &&
+                               !noam_value_is_instance(job.results[i], NOAM_FLOAT_TOKEN))){
+            free(job.results);
+            noam_vm_error(vm, "%s must return an int or a float", (const char*)name->data);
+        }
+
+        if(noam_value_is_instance(job.results[i], NOAM_FLOAT_TOKEN)){
+            elem = NOAM_FLOAT_TOKEN;
+        }
+    }
+
+    noam_array_value* array = noam_array_value_create(elem, length);
+
+    for(size_t i = 0; i < length; ++i){
+        if(elem == NOAM_INT_TOKEN){
+            *(int*)noam_array_value_at(array, i) = ((noam_int_value*)job.results[i])->value;
+        } else if(noam_value_is_instance(job.results[i], NOAM_INT_TOKEN)){
+            *(float*)noam_array_value_at(array, i) = (float)((noam_int_value*)job.results[i])->value;
+        } else {
+            *(float*)noam_array_value_at(array, i) = ((noam_float_value*)job.results[i])->value;
+        }
+    }
+
+    free(job.results);
+    return (noam_value*)array;
+}
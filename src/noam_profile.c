@@ -0,0 +1,258 @@
+#include "noam_profile.h"
+
+#include <signal.h>
+#include <sys/time.h>
+
+#define NOAM_PROFILE_PROBES 64
+#define NOAM_PROFILE_LINES 20
+#define NOAM_PROFILE_FRAME_LENGTH 128
+
+static noam_profile noam_profile_state;
+static struct sigaction noam_profile_previous;
+
+/* noam_profile_row struct: a row of a report table */
+typedef struct {
+    const char* name;
+    size_t      self;
+    size_t      total;
+} noam_profile_row;
+
+int noam_profile_equal(const noam_call_site* lhs, const noam_call_site* rhs, size_t length){
+    for(size_t i = 0; i < length; ++i){
+        if(lhs[i].func != rhs[i].func || lhs[i].line != rhs[i].line){
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* noam_profile_sample: SIGPROF handler, counts the current stack of the vm */
+void noam_profile_sample(int signal){
+    noam_profile* profile = &noam_profile_state;
+    noam_stack* stack = profile->vm->stack;
+    const noam_call_site* sites = stack->calls;
+    size_t length = (stack->depth < NOAM_STACK_CALLS ? stack->depth : NOAM_STACK_CALLS - 1) + 1;
+    size_t hash = 14695981039346656037u;
+
+    ++profile->samples;
+
+    for(size_t i = 0; i < length; ++i){
+        hash = (hash ^ (size_t)sites[i].func) * 1099511628211u;
+        hash = (hash ^ sites[i].line) * 1099511628211u;
+    }
+
+    for(size_t probe = 0; probe < NOAM_PROFILE_PROBES; ++probe){
+        noam_profile_stack* entry = &profile->stacks[(hash + probe) & (NOAM_PROFILE_STACKS - 1)];
+
+        if(!entry->count){
+            if(profile->used + length > NOAM_PROFILE_SITES){
+                break;
+            }
+
+            for(size_t i = 0; i < length; ++i){
+                profile->sites[profile->used + i] = sites[i];
+            }
+
+            entry->hash = hash;
+            entry->offset = profile->used;
+            entry->length = length;
+            entry->count = 1;
+            profile->used += length;
+            return;
+        }
+
+        if(entry->hash == hash && entry->length == length &&
+           noam_profile_equal(profile->sites + entry->offset, sites, length)){
+            ++entry->count;
+            return;
+        }
+    }
+
+    ++profile->dropped;
+}
+
+int noam_profile_start(noam_vm* vm, unsigned hz){
+    noam_profile* profile = &noam_profile_state;
+    struct sigaction action;
+    struct itimerval timer;
+
+    if(!profile->stacks){
+        profile->stacks = calloc(NOAM_PROFILE_STACKS, sizeof(noam_profile_stack));
+        profile->sites = malloc(NOAM_PROFILE_SITES * sizeof(noam_call_site));
+    }
+
+    profile->vm = vm;
+    profile->hz = hz ? hz : NOAM_PROFILE_HZ;
+
+    memset(&action, 0, sizeof(struct sigaction));
+    action.sa_handler = &noam_profile_sample;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+
+    if(sigaction(SIGPROF, &action, &noam_profile_previous)){
+        return 0;
+    }
+
+    memset(&timer, 0, sizeof(struct itimerval));
+    timer.it_interval.tv_sec = 0;
+    timer.it_interval.tv_usec = profile->hz > 1 ? 1000000 / profile->hz : 999999;
+    timer.it_value = timer.it_interval;
+    return !setitimer(ITIMER_PROF, &timer, NULL);
+}
+
+void noam_profile_stop(){
+    struct itimerval timer;
+
+    if(!noam_profile_state.vm){
+        return;
+    }
+
+    memset(&timer, 0, sizeof(struct itimerval));
+    setitimer(ITIMER_PROF, &timer, NULL);
+    sigaction(SIGPROF, &noam_profile_previous, NULL);
+    noam_profile_state.vm = NULL;
+}
+
+const char* noam_profile_frame(const noam_call_site* site, char* frame){
+    snprintf(frame, NOAM_PROFILE_FRAME_LENGTH, "%s:%lu", site->func ? (const char*)site->func->name->data : "main",
+             (unsigned long)site->line);
+    return frame;
+}
+
+/* noam_profile_count: adds to the counters of `name` in a table of names to pairs of counters */
+void noam_profile_count(noam_dict* table, const char* name, size_t self, size_t total){
+    noam_buffer* key = noam_buffer_create(1);
+    noam_buffer_append(key, name, strlen(name));
+    noam_buffer_terminate(key);
+
+    noam_dict_node* node = noam_dict_find(table, key);
+
+    if(node){
+        size_t* counters = noam_dict_value(table, node);
+        counters[0] += self;
+        counters[1] += total;
+        noam_buffer_release(key);
+    } else {
+        size_t counters[2] = {self, total};
+        /* the key is stored inline, the table owns its data */
+        noam_dict_insert(table, key, counters);
+        free(key);
+    }
+}
+
+int noam_profile_row_cmp(const void* lhs, const void* rhs){
+    const noam_profile_row* l = lhs;
+    const noam_profile_row* r = rhs;
+
+    if(l->self != r->self){
+        return l->self < r->self ? 1 : -1;
+    }
+    if(l->total != r->total){
+        return l->total < r->total ? 1 : -1;
+    }
+    return strcmp(l->name, r->name);
+}
+
+/* noam_profile_rows: rows of a table sorted by self time */
+noam_profile_row* noam_profile_rows(noam_dict* table){
+    noam_profile_row* rows = malloc((table->length ? table->length : 1) * sizeof(noam_profile_row));
+    size_t length = 0;
+
+    for(size_t i = 0; i < table->size; ++i){
+        noam_dict_node* node = noam_dict_node_at(table, i);
+
+        if(node->probe){
+            size_t* counters = noam_dict_value(table, node);
+            rows[length].name = ((noam_buffer*)noam_dict_key(node))->data;
+            rows[length].self = counters[0];
+            rows[length].total = counters[1];
+            ++length;
+        }
+    }
+
+    qsort(rows, length, sizeof(noam_profile_row), &noam_profile_row_cmp);
+    return rows;
+}
+
+void noam_profile_report(FILE* folded, FILE* table){
+    noam_profile* profile = &noam_profile_state;
+    noam_dict* funcs = noam_dict_createv(sizeof(noam_buffer), 2 * sizeof(size_t), &noam_hash_string,
+                                         &noam_cmp_string, &noam_scope_vars_release);
+    noam_dict* lines = noam_dict_createv(sizeof(noam_buffer), 2 * sizeof(size_t), &noam_hash_string,
+                                         &noam_cmp_string, &noam_scope_vars_release);
+    char frame[NOAM_PROFILE_FRAME_LENGTH];
+    size_t counted = 0;
+
+    for(size_t i = 0; profile->stacks && i < NOAM_PROFILE_STACKS; ++i){
+        noam_profile_stack* entry = &profile->stacks[i];
+        const noam_call_site* sites = profile->sites + entry->offset;
+
+        if(!entry->count){
+            continue;
+        }
+
+        counted += entry->count;
+
+        for(size_t j = 0; folded && j < entry->length; ++j){
+            fprintf(folded, j ? ";%s" : "%s", noam_profile_frame(&sites[j], frame));
+        }
+
+        if(folded){
+            fprintf(folded, " %lu\n", (unsigned long)entry->count);
+        }
+
+        /* recursive calls count once to the total time of a function */
+        for(size_t j = 0; j < entry->length; ++j){
+            size_t k = 0;
+
+            while(k < j && sites[k].func != sites[j].func){
+                ++k;
+            }
+
+            if(k == j){
+                const char* name = sites[j].func ? (const char*)sites[j].func->name->data : "main";
+                noam_profile_count(funcs, name, j + 1 == entry->length ? entry->count : 0, entry->count);
+            } else if(j + 1 == entry->length){
+                const char* name = sites[j].func ? (const char*)sites[j].func->name->data : "main";
+                noam_profile_count(funcs, name, entry->count, 0);
+            }
+        }
+
+        noam_profile_count(lines, noam_profile_frame(&sites[entry->length - 1], frame), entry->count, 0);
+    }
+
+    if(table){
+        double ms = profile->hz ? 1000.0 / profile->hz : 0;
+        double percent = counted ? 100.0 / counted : 0;
+        noam_profile_row* rows = noam_profile_rows(funcs);
+
+        fprintf(table, "noam profile: %lu samples at %u Hz, %lu dropped\n\n",
+                (unsigned long)profile->samples, profile->hz, (unsigned long)profile->dropped);
+        fprintf(table, "%10s %7s %10s %7s  %s\n", "self ms", "self %", "total ms", "total %", "function");
+
+        for(size_t i = 0; i < funcs->length; ++i){
+            fprintf(table, "%10.1f %6.1f%% %10.1f %6.1f%%  %s\n", rows[i].self * ms, rows[i].self * percent,
+                    rows[i].total * ms, rows[i].total * percent, rows[i].name);
+        }
+
+        free(rows);
+        rows = noam_profile_rows(lines);
+        fprintf(table, "\n%10s %7s  %s\n", "self ms", "self %", "line");
+
+        for(size_t i = 0; i < lines->length && i < NOAM_PROFILE_LINES; ++i){
+            fprintf(table, "%10.1f %6.1f%%  %s\n", rows[i].self * ms, rows[i].self * percent, rows[i].name);
+        }
+
+        free(rows);
+    }
+
+    noam_dict_release(funcs);
+    noam_dict_release(lines);
+}
+
+void noam_profile_release(){
+    noam_profile_stop();
+    free(noam_profile_state.stacks);
+    free(noam_profile_state.sites);
+    memset(&noam_profile_state, 0, sizeof(noam_profile));
+}
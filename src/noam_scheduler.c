@@ -0,0 +1,180 @@
+#include "noam_scheduler.h"
+
+#include <time.h>
+
+uint64_t noam_scheduler_now(){
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (uint64_t)time.tv_sec * 1000000000u + (uint64_t)time.tv_nsec;
+}
+
+uint64_t noam_scheduler_cpu_now(){
+    struct timespec time;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+    return (uint64_t)time.tv_sec * 1000000000u + (uint64_t)time.tv_nsec;
+}
+
+/* noam_scheduler_first: index of the lowest set bit, i.e. the highest ready priority */
+unsigned noam_scheduler_first(uint32_t mask){
+#if defined(__GNUC__)
+    return (unsigned)__builtin_ctz(mask);
+#else
+    unsigned index = 0;
+
+    while(!(mask & 1u)){
+        mask >>= 1;
+        ++index;
+    }
+    return index;
+#endif
+}
+
+void noam_scheduler_link(noam_scheduler* scheduler, noam_task* task){
+    unsigned priority = task->priority;
+
+    task->next = NULL;
+    task->prev = scheduler->tails[priority];
+
+    if(task->prev){
+        task->prev->next = task;
+    } else {
+        scheduler->heads[priority] = task;
+    }
+
+    scheduler->tails[priority] = task;
+    scheduler->ready |= 1u << priority;
+}
+
+void noam_scheduler_unlink(noam_scheduler* scheduler, noam_task* task){
+    unsigned priority = task->priority;
+
+    if(task->prev){
+        task->prev->next = task->next;
+    } else {
+        scheduler->heads[priority] = task->next;
+    }
+
+    if(task->next){
+        task->next->prev = task->prev;
+    } else {
+        scheduler->tails[priority] = task->prev;
+    }
+
+    if(!scheduler->heads[priority]){
+        scheduler->ready &= ~(1u << priority);
+    }
+
+    task->prev = task->next = NULL;
+}
+
+noam_scheduler* noam_scheduler_create(noam_vm* vm){
+    NOAM_TRACE(NOAM_TRACE_EXEC, "noam_scheduler_create\n");
+    noam_scheduler* scheduler = malloc(sizeof(noam_scheduler));
+    memset(scheduler, 0, sizeof(noam_scheduler));
+    scheduler->vm = vm;
+    return scheduler;
+}
+
+void noam_scheduler_destroy(noam_scheduler* scheduler){
+    for(unsigned priority = 0; priority < NOAM_TASK_PRIORITIES; ++priority){
+        while(scheduler->heads[priority]){
+            noam_scheduler_cancel(scheduler, scheduler->heads[priority]);
+        }
+    }
+    free(scheduler);
+}
+
+noam_task* noam_scheduler_add(noam_scheduler* scheduler, noam_coroutine_value* coroutine, unsigned priority){
+    noam_task* task = malloc(sizeof(noam_task));
+    memset(task, 0, sizeof(noam_task));
+    task->coroutine = coroutine;
+    task->priority = priority < NOAM_TASK_PRIORITIES ? priority : NOAM_TASK_PRIORITIES - 1;
+    task->state = NOAM_TASK_READY;
+
+    noam_scheduler_link(scheduler, task);
+    ++scheduler->length;
+    return task;
+}
+
+noam_task* noam_scheduler_spawn(noam_scheduler* scheduler, const char* name, noam_value** args, size_t argc,
+                                unsigned priority){
+    noam_vm* vm = scheduler->vm;
+    noam_value* result = NULL;
+
+    if(noam_vm_call(vm, name, args, argc, &result) != NOAM_OK){
+        return NULL;
+    }
+
+    if(!result || !noam_value_is_instance(result, NOAM_COROUTINE_TOKEN)){
+        snprintf(vm->error, NOAM_VM_ERROR_LENGTH, "%s has no yield statement", name);
+        vm->status = NOAM_RUNTIME_ERROR;
+        return NULL;
+    }
+
+    return noam_scheduler_add(scheduler, (noam_coroutine_value*)result, priority);
+}
+
+void noam_scheduler_cancel(noam_scheduler* scheduler, noam_task* task){
+    noam_scheduler_unlink(scheduler, task);
+    --scheduler->length;
+    free(task);
+}
+
+void noam_scheduler_set_priority(noam_scheduler* scheduler, noam_task* task, unsigned priority){
+    noam_scheduler_unlink(scheduler, task);
+    task->priority = priority < NOAM_TASK_PRIORITIES ? priority : NOAM_TASK_PRIORITIES - 1;
+    noam_scheduler_link(scheduler, task);
+}
+
+size_t noam_scheduler_tick(noam_scheduler* scheduler, uint64_t budget_ns){
+    uint64_t now = noam_scheduler_now();
+    uint64_t deadline = now + budget_ns;
+    /* priorities which may still have a task that hasn't run this tick */
+    uint32_t pending = scheduler->ready;
+    size_t resumes = 0;
+
+    ++scheduler->tick;
+    scheduler->cpu_ns = 0;
+
+    while((pending & scheduler->ready) && now < deadline){
+        unsigned priority = noam_scheduler_first(pending & scheduler->ready);
+        noam_task* task = scheduler->heads[priority];
+
+        /* tasks are queued in the order they ran, so the rest of the queue has run this tick too */
+        if(task->tick == scheduler->tick){
+            pending &= ~(1u << priority);
+            continue;
+        }
+
+        noam_scheduler_unlink(scheduler, task);
+        task->tick = scheduler->tick;
+
+        /* the deadline is wall time, the time charged to the task is what its thread actually ran */
+        noam_value* result = NULL;
+        uint64_t cpu = noam_scheduler_cpu_now();
+        noam_status status = noam_vm_resume(scheduler->vm, (noam_value*)task->coroutine, &result);
+        cpu = noam_scheduler_cpu_now() - cpu;
+
+        task->cpu_ns += cpu;
+        scheduler->cpu_ns += cpu;
+        ++task->resumes;
+        ++resumes;
+        now = noam_scheduler_now();
+
+        if(status == NOAM_OK && !task->coroutine->done){
+            noam_scheduler_link(scheduler, task);
+            continue;
+        }
+
+        task->state = status == NOAM_OK ? NOAM_TASK_DONE : NOAM_TASK_FAILED;
+
+        if(scheduler->finish){
+            scheduler->finish(scheduler, task, status);
+        }
+
+        --scheduler->length;
+        free(task);
+    }
+
+    return resumes;
+}
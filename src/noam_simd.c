@@ -0,0 +1,482 @@
+#include <stdint.h>
+
+#include "noam_simd.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define NOAM_SIMD_AVX2
+#endif
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define NOAM_SIMD_AVX
+#endif
+
+#if defined(__SSE4_1__)
+#include <smmintrin.h>
+#define NOAM_SIMD_SSE4
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define NOAM_SIMD_SSE2
+#endif
+
+#define NOAM_RADIX_BITS 8
+#define NOAM_RADIX_SIZE (1 << NOAM_RADIX_BITS)
+
+#ifdef NOAM_SIMD_SSE2
+float noam_simd_hsum_ps(__m128 v){
+    float lanes[4];
+    _mm_storeu_ps(lanes, v);
+    return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+}
+
+int noam_simd_hsum_epi32(__m128i v){
+    int lanes[4];
+    _mm_storeu_si128((__m128i*)lanes, v);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3];
+}
+
+/* noam_simd_select_epi32: SSE2 has no integer min/max, so blend by a comparison mask */
+__m128i noam_simd_select_epi32(__m128i mask, __m128i a, __m128i b){
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+#endif
+
+int noam_simd_sum_int(const int* data, size_t length){
+    size_t i = 0;
+    int sum = 0;
+#if defined(NOAM_SIMD_AVX2)
+    __m256i acc = _mm256_setzero_si256();
+    for(; i + 8 <= length; i += 8){
+        acc = _mm256_add_epi32(acc, _mm256_loadu_si256((const __m256i*)(data + i)));
+    }
+    sum = noam_simd_hsum_epi32(_mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1)));
+#elif defined(NOAM_SIMD_SSE2)
+    __m128i acc = _mm_setzero_si128();
+    for(; i + 4 <= length; i += 4){
+        acc = _mm_add_epi32(acc, _mm_loadu_si128((const __m128i*)(data + i)));
+    }
+    sum = noam_simd_hsum_epi32(acc);
+#endif
+    for(; i < length; ++i){
+        sum += data[i];
+    }
+    return sum;
+}
+
+float noam_simd_sum_float(const float* data, size_t length){
+    size_t i = 0;
+    float sum = 0;
+#if defined(NOAM_SIMD_AVX)
+    __m256 acc = _mm256_setzero_ps();
+    for(; i + 8 <= length; i += 8){
+        acc = _mm256_add_ps(acc, _mm256_loadu_ps(data + i));
+    }
+    sum = noam_simd_hsum_ps(_mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1)));
+#elif defined(NOAM_SIMD_SSE2)
+    __m128 acc = _mm_setzero_ps();
+    for(; i + 4 <= length; i += 4){
+        acc = _mm_add_ps(acc, _mm_loadu_ps(data + i));
+    }
+    sum = noam_simd_hsum_ps(acc);
+#endif
+    for(; i < length; ++i){
+        sum += data[i];
+    }
+    return sum;
+}
+
+int noam_simd_min_int(const int* data, size_t length){
+    size_t i = 0;
+    int result = data[0];
+#if defined(NOAM_SIMD_SSE2)
+    if(length >= 4){
+        __m128i acc = _mm_loadu_si128((const __m128i*)data);
+        for(i = 4; i + 4 <= length; i += 4){
+            __m128i v = _mm_loadu_si128((const __m128i*)(data + i));
+#if defined(NOAM_SIMD_SSE4)
+            acc = _mm_min_epi32(acc, v);
+#else
+            acc = noam_simd_select_epi32(_mm_cmplt_epi32(v, acc), v, acc);
+#endif
+        }
+        int lanes[4];
+        _mm_storeu_si128((__m128i*)lanes, acc);
+        for(size_t j = 0; j < 4; ++j){
+            result = lanes[j] < result ? lanes[j] : result;
+        }
+    }
+#endif
+    for(; i < length; ++i){
+        result = data[i] < result ? data[i] : result;
+    }
+    return result;
+}
+
+int noam_simd_max_int(const int* data, size_t length){
+    size_t i = 0;
+    int result = data[0];
+#if defined(NOAM_SIMD_SSE2)
+    if(length >= 4){
+        __m128i acc = _mm_loadu_si128((const __m128i*)data);
+        for(i = 4; i + 4 <= length; i += 4){
+            __m128i v = _mm_loadu_si128((const __m128i*)(data + i));
+#if defined(NOAM_SIMD_SSE4)
+            acc = _mm_max_epi32(acc, v);
+#else
+            acc = noam_simd_select_epi32(_mm_cmpgt_epi32(v, acc), v, acc);
+#endif
+        }
+        int lanes[4];
+        _mm_storeu_si128((__m128i*)lanes, acc);
+        for(size_t j = 0; j < 4; ++j){
+            result = lanes[j] > result ? lanes[j] : result;
+        }
+    }
+#endif
+    for(; i < length; ++i){
+        result = data[i] > result ? data[i] : result;
+    }
+    return result;
+}
+
+float noam_simd_min_float(const float* data, size_t length){
+    size_t i = 0;
+    float result = data[0];
+#if defined(NOAM_SIMD_SSE2)
+    if(length >= 4){
+        __m128 acc = _mm_loadu_ps(data);
+        for(i = 4; i + 4 <= length; i += 4){
+            acc = _mm_min_ps(acc, _mm_loadu_ps(data + i));
+        }
+        float lanes[4];
+        _mm_storeu_ps(lanes, acc);
+        for(size_t j = 0; j < 4; ++j){
+            result = lanes[j] < result ? lanes[j] : result;
+        }
+    }
+#endif
+    for(; i < length; ++i){
+        result = data[i] < result ? data[i] : result;
+    }
+    return result;
+}
+
+float noam_simd_max_float(const float* data, size_t length){
+    size_t i = 0;
+    float result = data[0];
+#if defined(NOAM_SIMD_SSE2)
+    if(length >= 4){
+        __m128 acc = _mm_loadu_ps(data);
+        for(i = 4; i + 4 <= length; i += 4){
+            acc = _mm_max_ps(acc, _mm_loadu_ps(data + i));
+        }
+        float lanes[4];
+        _mm_storeu_ps(lanes, acc);
+        for(size_t j = 0; j < 4; ++j){
+            result = lanes[j] > result ? lanes[j] : result;
+        }
+    }
+#endif
+    for(; i < length; ++i){
+        result = data[i] > result ? data[i] : result;
+    }
+    return result;
+}
+
+void noam_simd_scale_int(int* data, size_t length, int factor){
+    size_t i = 0;
+#if defined(NOAM_SIMD_AVX2)
+    __m256i k = _mm256_set1_epi32(factor);
+    for(; i + 8 <= length; i += 8){
+        __m256i v = _mm256_loadu_si256((const __m256i*)(data + i));
+        _mm256_storeu_si256((__m256i*)(data + i), _mm256_mullo_epi32(v, k));
+    }
+#elif defined(NOAM_SIMD_SSE4)
+    __m128i k = _mm_set1_epi32(factor);
+    for(; i + 4 <= length; i += 4){
+        __m128i v = _mm_loadu_si128((const __m128i*)(data + i));
+        _mm_storeu_si128((__m128i*)(data + i), _mm_mullo_epi32(v, k));
+    }
+#endif
+    for(; i < length; ++i){
+        data[i] *= factor;
+    }
+}
+
+void noam_simd_scale_float(float* data, size_t length, float factor){
+    size_t i = 0;
+#if defined(NOAM_SIMD_AVX)
+    __m256 k = _mm256_set1_ps(factor);
+    for(; i + 8 <= length; i += 8){
+        _mm256_storeu_ps(data + i, _mm256_mul_ps(_mm256_loadu_ps(data + i), k));
+    }
+#elif defined(NOAM_SIMD_SSE2)
+    __m128 k = _mm_set1_ps(factor);
+    for(; i + 4 <= length; i += 4){
+        _mm_storeu_ps(data + i, _mm_mul_ps(_mm_loadu_ps(data + i), k));
+    }
+#endif
+    for(; i < length; ++i){
+        data[i] *= factor;
+    }
+}
+
+void noam_simd_add_int(int* data, const int* other, size_t length){
+    size_t i = 0;
+#if defined(NOAM_SIMD_AVX2)
+    for(; i + 8 <= length; i += 8){
+        __m256i v = _mm256_loadu_si256((const __m256i*)(data + i));
+        __m256i w = _mm256_loadu_si256((const __m256i*)(other + i));
+        _mm256_storeu_si256((__m256i*)(data + i), _mm256_add_epi32(v, w));
+    }
+#elif defined(NOAM_SIMD_SSE2)
+    for(; i + 4 <= length; i += 4){
+        __m128i v = _mm_loadu_si128((const __m128i*)(data + i));
+        __m128i w = _mm_loadu_si128((const __m128i*)(other + i));
+        _mm_storeu_si128((__m128i*)(data + i), _mm_add_epi32(v, w));
+    }
+#endif
+    for(; i < length; ++i){
+        data[i] += other[i];
+    }
+}
+
+void noam_simd_add_float(float* data, const float* other, size_t length){
+    size_t i = 0;
+#if defined(NOAM_SIMD_AVX)
+    for(; i + 8 <= length; i += 8){
+        _mm256_storeu_ps(data + i, _mm256_add_ps(_mm256_loadu_ps(data + i), _mm256_loadu_ps(other + i)));
+    }
+#elif defined(NOAM_SIMD_SSE2)
+    for(; i + 4 <= length; i += 4){
+        _mm_storeu_ps(data + i, _mm_add_ps(_mm_loadu_ps(data + i), _mm_loadu_ps(other + i)));
+    }
+#endif
+    for(; i < length; ++i){
+        data[i] += other[i];
+    }
+}
+
+int noam_simd_dot_int(const int* lhs, const int* rhs, size_t length){
+    size_t i = 0;
+    int dot = 0;
+#if defined(NOAM_SIMD_AVX2)
+    __m256i acc = _mm256_setzero_si256();
+    for(; i + 8 <= length; i += 8){
+        __m256i v = _mm256_loadu_si256((const __m256i*)(lhs + i));
+        __m256i w = _mm256_loadu_si256((const __m256i*)(rhs + i));
+        acc = _mm256_add_epi32(acc, _mm256_mullo_epi32(v, w));
+    }
+    dot = noam_simd_hsum_epi32(_mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1)));
+#elif defined(NOAM_SIMD_SSE4)
+    __m128i acc = _mm_setzero_si128();
+    for(; i + 4 <= length; i += 4){
+        __m128i v = _mm_loadu_si128((const __m128i*)(lhs + i));
+        __m128i w = _mm_loadu_si128((const __m128i*)(rhs + i));
+        acc = _mm_add_epi32(acc, _mm_mullo_epi32(v, w));
+    }
+    dot = noam_simd_hsum_epi32(acc);
+#endif
+    for(; i < length; ++i){
+        dot += lhs[i] * rhs[i];
+    }
+    return dot;
+}
+
+float noam_simd_dot_float(const float* lhs, const float* rhs, size_t length){
+    size_t i = 0;
+    float dot = 0;
+#if defined(NOAM_SIMD_AVX)
+    __m256 acc = _mm256_setzero_ps();
+    for(; i + 8 <= length; i += 8){
+        acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_loadu_ps(lhs + i), _mm256_loadu_ps(rhs + i)));
+    }
+    dot = noam_simd_hsum_ps(_mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1)));
+#elif defined(NOAM_SIMD_SSE2)
+    __m128 acc = _mm_setzero_ps();
+    for(; i + 4 <= length; i += 4){
+        acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(lhs + i), _mm_loadu_ps(rhs + i)));
+    }
+    dot = noam_simd_hsum_ps(acc);
+#endif
+    for(; i < length; ++i){
+        dot += lhs[i] * rhs[i];
+    }
+    return dot;
+}
+
+void noam_simd_fill_int(int* data, size_t length, int value){
+    size_t i = 0;
+#if defined(NOAM_SIMD_AVX)
+    __m256i v = _mm256_set1_epi32(value);
+    for(; i + 8 <= length; i += 8){
+        _mm256_storeu_si256((__m256i*)(data + i), v);
+    }
+#elif defined(NOAM_SIMD_SSE2)
+    __m128i v = _mm_set1_epi32(value);
+    for(; i + 4 <= length; i += 4){
+        _mm_storeu_si128((__m128i*)(data + i), v);
+    }
+#endif
+    for(; i < length; ++i){
+        data[i] = value;
+    }
+}
+
+void noam_simd_fill_float(float* data, size_t length, float value){
+    size_t i = 0;
+#if defined(NOAM_SIMD_AVX)
+    __m256 v = _mm256_set1_ps(value);
+    for(; i + 8 <= length; i += 8){
+        _mm256_storeu_ps(data + i, v);
+    }
+#elif defined(NOAM_SIMD_SSE2)
+    __m128 v = _mm_set1_ps(value);
+    for(; i + 4 <= length; i += 4){
+        _mm_storeu_ps(data + i, v);
+    }
+#endif
+    for(; i < length; ++i){
+        data[i] = value;
+    }
+}
+
+/* noam_radix_sort: sorts 32-bit keys, `data` is expected to hold order-preserving unsigned keys */
+void noam_radix_sort(uint32_t* data, size_t length){
+    uint32_t* temp = malloc(length * sizeof(uint32_t));
+    uint32_t* src = data;
+    uint32_t* dst = temp;
+
+    for(unsigned shift = 0; shift < 32; shift += NOAM_RADIX_BITS){
+        size_t counts[NOAM_RADIX_SIZE] = {0};
+
+        for(size_t i = 0; i < length; ++i){
+            ++counts[(src[i] >> shift) & (NOAM_RADIX_SIZE - 1)];
+        }
+
+        size_t offset = 0;
+        for(size_t i = 0; i < NOAM_RADIX_SIZE; ++i){
+            size_t count = counts[i];
+            counts[i] = offset;
+            offset += count;
+        }
+
+        for(size_t i = 0; i < length; ++i){
+            dst[counts[(src[i] >> shift) & (NOAM_RADIX_SIZE - 1)]++] = src[i];
+        }
+
+        uint32_t* swap = src;
+        src = dst;
+        dst = swap;
+    }
+
+    /* an even number of passes leaves the result in `data` */
+    free(temp);
+}
+
+void noam_simd_sort_int(int* data, size_t length){
+    uint32_t* keys = (uint32_t*)data;
+
+    for(size_t i = 0; i < length; ++i){
+        keys[i] ^= 0x80000000u;
+    }
+
+    noam_radix_sort(keys, length);
+
+    for(size_t i = 0; i < length; ++i){
+        keys[i] ^= 0x80000000u;
+    }
+}
+
+void noam_simd_sort_float(float* data, size_t length){
+    uint32_t* keys = (uint32_t*)data;
+
+    /* negative floats are flipped entirely, positive ones only get the sign bit set */
+    for(size_t i = 0; i < length; ++i){
+        keys[i] ^= (keys[i] & 0x80000000u) ? 0xffffffffu : 0x80000000u;
+    }
+
+    noam_radix_sort(keys, length);
+
+    for(size_t i = 0; i < length; ++i){
+        keys[i] ^= (keys[i] & 0x80000000u) ? 0x80000000u : 0xffffffffu;
+    }
+}
+
+void noam_simd_vec4_add(float* out, const float* lhs, const float* rhs){
+#if defined(NOAM_SIMD_SSE2)
+    _mm_storeu_ps(out, _mm_add_ps(_mm_loadu_ps(lhs), _mm_loadu_ps(rhs)));
+#else
+    for(size_t i = 0; i < 4; ++i){
+        out[i] = lhs[i] + rhs[i];
+    }
+#endif
+}
+
+void noam_simd_vec4_sub(float* out, const float* lhs, const float* rhs){
+#if defined(NOAM_SIMD_SSE2)
+    _mm_storeu_ps(out, _mm_sub_ps(_mm_loadu_ps(lhs), _mm_loadu_ps(rhs)));
+#else
+    for(size_t i = 0; i < 4; ++i){
+        out[i] = lhs[i] - rhs[i];
+    }
+#endif
+}
+
+void noam_simd_vec4_mul(float* out, const float* lhs, const float* rhs){
+#if defined(NOAM_SIMD_SSE2)
+    _mm_storeu_ps(out, _mm_mul_ps(_mm_loadu_ps(lhs), _mm_loadu_ps(rhs)));
+#else
+    for(size_t i = 0; i < 4; ++i){
+        out[i] = lhs[i] * rhs[i];
+    }
+#endif
+}
+
+void noam_simd_vec4_scale(float* out, const float* vec, float factor){
+#if defined(NOAM_SIMD_SSE2)
+    _mm_storeu_ps(out, _mm_mul_ps(_mm_loadu_ps(vec), _mm_set1_ps(factor)));
+#else
+    for(size_t i = 0; i < 4; ++i){
+        out[i] = vec[i] * factor;
+    }
+#endif
+}
+
+float noam_simd_vec4_dot(const float* lhs, const float* rhs){
+#if defined(NOAM_SIMD_SSE2)
+    return noam_simd_hsum_ps(_mm_mul_ps(_mm_loadu_ps(lhs), _mm_loadu_ps(rhs)));
+#else
+    return (lhs[0] * rhs[0] + lhs[1] * rhs[1]) + (lhs[2] * rhs[2] + lhs[3] * rhs[3]);
+#endif
+}
+
+void noam_simd_mat4_mul_vec4(float* out, const float* mat, const float* vec){
+#if defined(NOAM_SIMD_SSE2)
+    __m128 result = _mm_mul_ps(_mm_loadu_ps(mat), _mm_set1_ps(vec[0]));
+    result = _mm_add_ps(result, _mm_mul_ps(_mm_loadu_ps(mat + 4), _mm_set1_ps(vec[1])));
+    result = _mm_add_ps(result, _mm_mul_ps(_mm_loadu_ps(mat + 8), _mm_set1_ps(vec[2])));
+    result = _mm_add_ps(result, _mm_mul_ps(_mm_loadu_ps(mat + 12), _mm_set1_ps(vec[3])));
+    _mm_storeu_ps(out, result);
+#else
+    float result[4];
+    for(size_t i = 0; i < 4; ++i){
+        result[i] = mat[i] * vec[0] + mat[4 + i] * vec[1] + mat[8 + i] * vec[2] + mat[12 + i] * vec[3];
+    }
+    memcpy(out, result, sizeof(result));
+#endif
+}
+
+void noam_simd_mat4_mul(float* out, const float* lhs, const float* rhs){
+    float result[16];
+
+    /* each column of the product is the left matrix applied to a column of the right one */
+    for(size_t j = 0; j < 4; ++j){
+        noam_simd_mat4_mul_vec4(result + 4 * j, lhs, rhs + 4 * j);
+    }
+
+    memcpy(out, result, sizeof(result));
+}
@@ -1,7 +1,9 @@
 #include "noam_statement.h"
+#include "noam_map.h"
+#include "noam_coroutine.h"
 
-noam_value* noam_statement_run(noam_statement* statement){
-    return statement->vtable_->run(statement);
+noam_value* noam_statement_run(noam_statement* statement, noam_vm* vm){
+    return statement->vtable_->run(statement, vm);
 }
 
 void noam_statement_release(noam_statement* statement){
@@ -10,9 +12,11 @@ void noam_statement_release(noam_statement* statement){
     }
 }
 
-noam_value* noam_print_statement_run(noam_print_statement* statement){
-    noam_value* value = noam_expression_get(statement->expr);
-    printf("%s\n", noam_value_to_string(value));
+noam_value* noam_print_statement_run(noam_print_statement* statement, noam_vm* vm){
+    noam_value* value = noam_expression_get(statement->expr, vm);
+    const char* str = noam_value_to_string(value, vm);
+    noam_vm_write(vm, str, strlen(str));
+    noam_vm_write(vm, "\n", 1);
     return value;
 }
 
@@ -22,20 +26,20 @@ void noam_print_statement_release(noam_print_statement* statement){
 
 noam_print_statement* noam_print_statement_create(noam_expression* expression){
     static noam_statement_vtable_ noam_print_statement_vtable[] = {{&noam_print_statement_run,
-                                                                    &noam_print_statement_is_returned,
                                                                     &noam_print_statement_release}};
-#ifdef NOAM_DEBUG
-    printf("noam_print_statement_create\n");
-#endif
+    NOAM_TRACE(NOAM_TRACE_PARSER, "noam_print_statement_create\n");
     noam_print_statement* statement = malloc(sizeof(noam_print_statement));
+    NOAM_ALLOC_STAT("noam_print_statement", sizeof(noam_print_statement));
     statement->vtable_ = noam_print_statement_vtable;
     statement->expr = expression;
     return statement;
 }
 
-noam_value* noam_assignment_statement_run(noam_assignment_statement* statement){
-    noam_dict_insert(statement->scope->vars, statement->name, &statement->expr);
-    return noam_expression_get(statement->expr);
+noam_value* noam_assignment_statement_run(noam_assignment_statement* statement, noam_vm* vm){
+    noam_stack* stack = vm->stack;
+    noam_value* value = noam_expression_get(statement->expr, vm);
+    stack->slots[(statement->global ? 0 : stack->base) + statement->slot] = value;
+    return value;
 }
 
 void noam_assignment_statement_release(noam_assignment_statement* statement){
@@ -43,61 +47,188 @@ void noam_assignment_statement_release(noam_assignment_statement* statement){
     noam_buffer_release(statement->name);
 }
 
-noam_value* noam_expression_statement_run(noam_expression_statement* statement){
-    return noam_expression_get(statement->expression);
+/* noam_compound_int, noam_compound_float: apply the operator of a compound assignment */
+int noam_compound_int(noam_vm* vm, char op, int lhs, int rhs){
+    switch(op){
+        case '+':
+            return lhs + rhs;
+        case '-':
+            return lhs - rhs;
+        case '*':
+            return lhs * rhs;
+        default:
+            if(!rhs){
+                noam_vm_error(vm, "division by zero");
+            }
+            return lhs / rhs;
+    }
+}
+
+float noam_compound_float(char op, float lhs, float rhs){
+    switch(op){
+        case '+':
+            return lhs + rhs;
+        case '-':
+            return lhs - rhs;
+        case '*':
+            return lhs * rhs;
+        default:
+            return lhs / rhs;
+    }
+}
+
+noam_value* noam_compound_assignment_statement_run(noam_compound_assignment_statement* statement, noam_vm* vm){
+    noam_stack* stack = vm->stack;
+    /* the right hand side may call functions which grow the stack, so the slot is taken afterwards */
+    noam_value* rhs = noam_expression_get(statement->expr, vm);
+    noam_value** slot = stack->slots + (statement->global ? 0 : stack->base) + statement->slot;
+    noam_value* lhs = *slot;
+
+    if(!lhs){
+        noam_vm_error(vm, "unknown variable %s", (const char*)statement->name->data);
+    }
+
+    if(noam_values_equal_type(lhs, rhs, NOAM_INT_TOKEN)){
+        int value = noam_compound_int(vm, statement->op, ((noam_int_value*)lhs)->value, ((noam_int_value*)rhs)->value);
+
+        if(((noam_int_value*)lhs)->owned){
+            ((noam_int_value*)lhs)->value = value;
+            return lhs;
+        }
+
+        noam_int_value* result = noam_int_value_create(value);
+        result->owned = 1;
+        *slot = (noam_value*)result;
+        return *slot;
+    }
+
+    if(noam_values_equal_type(lhs, rhs, NOAM_FLOAT_TOKEN)){
+        float value = noam_compound_float(statement->op, ((noam_float_value*)lhs)->value,
+                                          ((noam_float_value*)rhs)->value);
+
+        if(((noam_float_value*)lhs)->owned){
+            ((noam_float_value*)lhs)->value = value;
+            return lhs;
+        }
+
+        noam_float_value* result = noam_float_value_create(value);
+        result->owned = 1;
+        *slot = (noam_value*)result;
+        return *slot;
+    }
+
+    if(statement->op == '+' && noam_values_equal_type(lhs, rhs, NOAM_STRING_TOKEN)){
+        noam_string_value* string = (noam_string_value*)lhs;
+
+        /* the copy is owned, so a string built in a loop grows its buffer geometrically instead of being copied */
+        if(!string->owned){
+            string = noam_string_value_create(string->str);
+            string->owned = 1;
+            *slot = (noam_value*)string;
+        }
+
+        noam_buffer_merge(string->str, ((noam_string_value*)rhs)->str);
+        noam_buffer_terminate(string->str);
+        string->hashed = 0;
+        return *slot;
+    }
+
+    char op[2] = {statement->op, '\0'};
+    *slot = noam_op_values(vm, op, lhs, rhs);
+    return *slot;
+}
+
+void noam_compound_assignment_statement_release(noam_compound_assignment_statement* statement){
+    noam_expression_release(statement->expr);
+    noam_buffer_release(statement->name);
+}
+
+noam_value* noam_index_assignment_statement_run(noam_index_assignment_statement* statement, noam_vm* vm){
+    noam_value* target = noam_expression_get(statement->target->target, vm);
+    noam_value* index_value = noam_expression_get(statement->target->index, vm);
+    noam_value* value = noam_expression_get(statement->expr, vm);
+
+    if(noam_value_is_instance(target, NOAM_MAP_TOKEN)){
+        noam_map_value_write((noam_map_value*)target, vm);
+        noam_map_set((noam_map_value*)target, index_value, value);
+        return value;
+    }
+
+    noam_array_value* array = NULL;
+    size_t index = noam_array_index(vm, target, index_value, &array);
+    noam_array_value_write(array, vm);
+
+    if(noam_value_is_instance(value, NOAM_INT_TOKEN)){
+        if(array->elem == NOAM_INT_TOKEN){
+            *(int*)noam_array_value_at(array, index) = ((noam_int_value*)value)->value;
+        } else {
+            *(float*)noam_array_value_at(array, index) = (float)((noam_int_value*)value)->value;
+        }
+    } else if(noam_value_is_instance(value, NOAM_FLOAT_TOKEN) && array->elem == NOAM_FLOAT_TOKEN){
+        *(float*)noam_array_value_at(array, index) = ((noam_float_value*)value)->value;
+    } else {
+        noam_vm_error(vm, "value does not match the array type");
+    }
+
+    return value;
+}
+
+void noam_index_assignment_statement_release(noam_index_assignment_statement* statement){
+    noam_expression_release((noam_expression*)statement->target);
+    noam_expression_release(statement->expr);
+}
+
+noam_value* noam_expression_statement_run(noam_expression_statement* statement, noam_vm* vm){
+    return noam_expression_get(statement->expression, vm);
 }
 
 void noam_expression_statement_release(noam_expression_statement* statement){
     noam_expression_release(statement->expression);
 }
 
-noam_value* noam_return_statement_run(noam_return_statement* statement){
-    return noam_expression_get(statement->expression);
+noam_value* noam_return_statement_run(noam_return_statement* statement, noam_vm* vm){
+    noam_value* value = noam_expression_get(statement->expression, vm);
+    vm->stack->returning = 1;
+    return value;
 }
 
 void noam_return_statement_release(noam_return_statement* statement){
     noam_expression_release(statement->expression);
 }
 
-noam_value* noam_cond_statement_run(noam_cond_statement* statement){
+noam_value* noam_cond_statement_run(noam_cond_statement* statement, noam_vm* vm){
     size_t i = 0;
 
-    while(i < statement->conditions->length){
-        noam_expression** expression = noam_buffer_at(statement->conditions, i);
-        noam_value* value = noam_expression_get(*expression);
-
-        if(value->vtable_->type != NOAM_BOOL_TOKEN){
-            //TODO: Error
-            fprintf(stderr, "noam: condition is not a boolean type");
-            exit(-1);
-        }
+    /* a resumed coroutine enters the branch it was suspended in without checking the conditions */
+    if(vm->stack->resuming){
+        i = noam_coroutine_point(vm).index;
+    } else {
+        while(i < statement->conditions->length){
+            noam_expression** expression = noam_buffer_at(statement->conditions, i);
+            noam_value* value = noam_expression_get(*expression, vm);
 
-        noam_bool_value* cond = (noam_bool_value*)value;
-
-        if(cond->value){
-            noam_buffer* block = noam_buffer_at(statement->blocks, i);
-            noam_value* result = noam_statements_run(block);
+            if(value->vtable_->type != NOAM_BOOL_TOKEN){
+                noam_vm_error(vm, "condition is not a boolean type");
+            }
 
-            if(result){
-                statement->is_returned = 1;
-                return result;
+            if(((noam_bool_value*)value)->value){
+                break;
             }
+
+            ++i;
         }
 
-        ++i;
+        if(i == statement->conditions->length && !statement->with_else){
+            return NULL;
+        }
     }
 
-    if(statement->with_else){
-        noam_buffer* block = noam_buffer_last(statement->blocks);
-        noam_value* result = noam_statements_run(block);
+    noam_value* result = noam_statements_run(noam_buffer_at(statement->blocks, i), vm);
 
-        if(result){
-            statement->is_returned = 1;
-            return result;
-        }
+    if(vm->stack->yielding){
+        noam_coroutine_suspend(vm, i, NULL, NULL);
     }
-
-    return NULL;
+    return result;
 }
 
 void noam_cond_statement_release(noam_cond_statement* statement){
@@ -108,27 +239,52 @@ noam_assignment_statement* noam_assignment_statement_create(noam_buffer* name,
                                                             noam_expression* expression,
                                                             noam_scope* scope){
     static noam_statement_vtable_ noam_assignment_statement_vtable[] = {{&noam_assignment_statement_run,
-                                                                         &noam_assignment_statement_is_returned,
                                                                          &noam_assignment_statement_release}};
-#ifdef NOAM_DEBUG
-    printf("noam_assignment_statement_create: %s\n", (char*)name->data);
-#endif
+    NOAM_TRACE(NOAM_TRACE_PARSER, "noam_assignment_statement_create: %s\n", (char*)name->data);
     noam_assignment_statement* statement = malloc(sizeof(noam_assignment_statement));
+    NOAM_ALLOC_STAT("noam_assignment_statement", sizeof(noam_assignment_statement));
     statement->vtable_ = noam_assignment_statement_vtable;
     statement->name = name;
     statement->expr = expression;
-    statement->scope = scope;
+    statement->slot = noam_scope_declare(scope, name, &statement->global);
+    return statement;
+}
+
+noam_compound_assignment_statement* noam_compound_assignment_statement_create(noam_buffer* name, char op,
+                                                                              noam_expression* expression,
+                                                                              noam_scope* scope){
+    static noam_statement_vtable_ noam_compound_assignment_statement_vtable[] = {
+            {&noam_compound_assignment_statement_run, &noam_compound_assignment_statement_release}};
+    NOAM_TRACE(NOAM_TRACE_PARSER, "noam_compound_assignment_statement_create: %s %c=\n", (char*)name->data, op);
+    noam_compound_assignment_statement* statement = malloc(sizeof(noam_compound_assignment_statement));
+    NOAM_ALLOC_STAT("noam_compound_assignment_statement", sizeof(noam_compound_assignment_statement));
+    statement->vtable_ = noam_compound_assignment_statement_vtable;
+    statement->name = name;
+    statement->op = op;
+    statement->expr = expression;
+    statement->slot = noam_scope_lookup(scope, name, &statement->global);
+    return statement;
+}
+
+noam_index_assignment_statement* noam_index_assignment_statement_create(noam_index_expression* target,
+                                                                        noam_expression* expression){
+    static noam_statement_vtable_ noam_index_assignment_statement_vtable[] = {{&noam_index_assignment_statement_run,
+                                                                               &noam_index_assignment_statement_release}};
+    NOAM_TRACE(NOAM_TRACE_PARSER, "noam_index_assignment_statement_create\n");
+    noam_index_assignment_statement* statement = malloc(sizeof(noam_index_assignment_statement));
+    NOAM_ALLOC_STAT("noam_index_assignment_statement", sizeof(noam_index_assignment_statement));
+    statement->vtable_ = noam_index_assignment_statement_vtable;
+    statement->target = target;
+    statement->expr = expression;
     return statement;
 }
 
 noam_expression_statement* noam_expression_statement_create(noam_expression* expression){
     static noam_statement_vtable_ noam_expression_statement_vtable[] = {{&noam_expression_statement_run,
-                                                                         &noam_expression_statement_is_returned,
                                                                          &noam_expression_statement_release}};
-#ifdef NOAM_DEBUG
-    printf("noam_expression_statement_create\n");
-#endif
+    NOAM_TRACE(NOAM_TRACE_PARSER, "noam_expression_statement_create\n");
     noam_expression_statement* statement = malloc(sizeof(noam_expression_statement));
+    NOAM_ALLOC_STAT("noam_expression_statement", sizeof(noam_expression_statement));
     statement->vtable_ = noam_expression_statement_vtable;
     statement->expression = expression;
     return statement;
@@ -136,12 +292,10 @@ noam_expression_statement* noam_expression_statement_create(noam_expression* exp
 
 noam_return_statement* noam_return_statement_create(noam_expression* expression){
     static noam_statement_vtable_ noam_return_statement_vtable[] = {{&noam_return_statement_run,
-                                                                     &noam_return_statement_is_returned,
                                                                      &noam_return_statement_release}};
-#ifdef NOAM_DEBUG
-    printf("noam_return_statement_create\n");
-#endif
+    NOAM_TRACE(NOAM_TRACE_PARSER, "noam_return_statement_create\n");
     noam_return_statement* statement = malloc(sizeof(noam_return_statement));
+    NOAM_ALLOC_STAT("noam_return_statement", sizeof(noam_return_statement));
     statement->vtable_ = noam_return_statement_vtable;
     statement->expression = expression;
     return statement;
@@ -149,57 +303,286 @@ noam_return_statement* noam_return_statement_create(noam_expression* expression)
 
 noam_cond_statement* noam_cond_statement_create(noam_buffer* conditions, noam_buffer* blocks, int with_else){
     static noam_statement_vtable_ noam_cond_statement_vtable[] = {{&noam_cond_statement_run,
-                                                                  &noam_cond_statement_is_returned,
                                                                   &noam_cond_statement_release}};
-#ifdef NOAM_DEBUG
-    printf("noam_cond_statement_create\n");
-#endif
+    NOAM_TRACE(NOAM_TRACE_PARSER, "noam_cond_statement_create\n");
     noam_cond_statement* statement = malloc(sizeof(noam_cond_statement));
+    NOAM_ALLOC_STAT("noam_cond_statement", sizeof(noam_cond_statement));
     statement->vtable_ = noam_cond_statement_vtable;
     statement->conditions = conditions;
     statement->blocks = blocks;
     statement->with_else = with_else;
-    statement->is_returned = 0;
     return statement;
 }
 
-noam_value* noam_statements_run(noam_buffer* statements){
-    size_t current = 0;
-#ifdef NOAM_DEBUG
-    printf("noam_statements_run\n");
-#endif
-    while(current < statements->length){
-        noam_statement** statement = noam_buffer_at(statements, current++);
-        noam_value* result = noam_statement_run(*statement);
+/* noam_for_statement_bind: binds loop variables to the element at `index`, returns 0 past the last element */
+int noam_for_statement_bind(noam_vm* vm, noam_for_statement* statement, noam_value* iterable, noam_buffer* pairs,
+                            size_t index){
+    noam_value* key = NULL;
+    noam_value* value = NULL;
 
-        if(noam_statement_is_returned(*statement)){
-            return result;
+    if(pairs){
+        if(index >= pairs->length){
+            return 0;
+        }
+
+        noam_value** pair = noam_buffer_at(pairs, index);
+        key = pair[0];
+        value = pair[1];
+    } else if(noam_value_is_instance(iterable, NOAM_ARRAY_TOKEN)){
+        noam_array_value* array = (noam_array_value*)iterable;
+
+        if(index >= array->data->length){
+            return 0;
+        }
+
+        value = array->elem == NOAM_INT_TOKEN ?
+                (noam_value*)noam_int_value_create(*(int*)noam_array_value_at(array, index)) :
+                (noam_value*)noam_float_value_create(*(float*)noam_array_value_at(array, index));
+    } else {
+        noam_coroutine_value* coroutine = (noam_coroutine_value*)iterable;
+        value = noam_coroutine_resume(coroutine, vm);
+
+        if(coroutine->done){
+            return 0;
         }
     }
 
-    return NULL;
+    /* arrays and coroutines bind an index and an element, or the element alone */
+    if(!pairs){
+        key = statement->value ? (noam_value*)noam_int_value_create((int)index) : value;
+    }
+
+    noam_stack* stack = vm->stack;
+    noam_value** slots = stack->slots + (statement->global ? 0 : stack->base);
+
+    slots[statement->key_slot] = key;
+
+    if(statement->value){
+        slots[statement->value_slot] = value;
+    }
+    return 1;
 }
 
-int noam_statement_is_returned(noam_statement* statement){
-    return statement->vtable_->is_returned(statement);
+noam_value* noam_for_statement_run(noam_for_statement* statement, noam_vm* vm){
+    noam_stack* stack = vm->stack;
+    noam_value* iterable = NULL;
+    noam_buffer* pairs = NULL;
+    noam_value* result = NULL;
+    size_t index = 0;
+    int resumed = stack->resuming;
+
+    if(resumed){
+        /* the body of the element at `index` was suspended, the loop variables are kept in the frame */
+        noam_resume_point point = noam_coroutine_point(vm);
+        index = point.index;
+        iterable = point.iterable;
+        pairs = point.pairs;
+    } else {
+        iterable = noam_expression_get(statement->iterable, vm);
+
+        if(noam_value_is_instance(iterable, NOAM_MAP_TOKEN)){
+            noam_dict* dict = ((noam_map_value*)iterable)->dict;
+            pairs = noam_buffer_create(2 * sizeof(noam_value*));
+
+            for(size_t i = 0; i < dict->size; ++i){
+                noam_dict_node* node = noam_dict_node_at(dict, i);
+
+                if(node->probe){
+                    noam_buffer_push(pairs, node->data);
+                }
+            }
+        } else if(!noam_value_is_instance(iterable, NOAM_ARRAY_TOKEN) &&
+                  !noam_value_is_instance(iterable, NOAM_COROUTINE_TOKEN)){
+            noam_vm_error(vm, "value is not iterable");
+        }
+    }
+
+    while(!stack->returning && (resumed || noam_for_statement_bind(vm, statement, iterable, pairs, index))){
+        resumed = 0;
+        result = noam_statements_run(statement->block, vm);
+
+        if(!stack->returning){
+            ++index;
+        }
+    }
+
+    if(stack->yielding){
+        noam_coroutine_suspend(vm, index, iterable, pairs);
+    } else if(pairs){
+        noam_buffer_release(pairs);
+    }
+
+    return result;
 }
 
-int noam_print_statement_is_returned(noam_print_statement* statement){
-    return 0;
+void noam_for_statement_release(noam_for_statement* statement){
+    noam_expression_release(statement->iterable);
 }
 
-int noam_assignment_statement_is_returned(noam_assignment_statement* statement){
-    return 0;
+noam_for_statement* noam_for_statement_create(noam_buffer* key, noam_buffer* value, noam_expression* iterable,
+                                              noam_buffer* block, noam_scope* scope){
+    static noam_statement_vtable_ noam_for_statement_vtable[] = {{&noam_for_statement_run,
+                                                                 &noam_for_statement_release}};
+    NOAM_TRACE(NOAM_TRACE_PARSER, "noam_for_statement_create: %s\n", (char*)key->data);
+    noam_for_statement* statement = malloc(sizeof(noam_for_statement));
+    NOAM_ALLOC_STAT("noam_for_statement", sizeof(noam_for_statement));
+    statement->vtable_ = noam_for_statement_vtable;
+    statement->key = key;
+    statement->value = value;
+    statement->iterable = iterable;
+    statement->key_slot = noam_scope_declare(scope, key, &statement->global);
+    statement->value_slot = value ? noam_scope_declare(scope, value, &statement->global) : 0;
+    statement->block = block;
+    return statement;
 }
 
-int noam_expression_statement_is_returned(noam_expression_statement* statement){
-    return 0;
+/* noam_while_statement_test: evaluates the condition of the loop */
+int noam_while_statement_test(noam_while_statement* statement, noam_vm* vm){
+    noam_value* value = noam_expression_get(statement->condition, vm);
+
+    if(value->vtable_->type != NOAM_BOOL_TOKEN){
+        noam_vm_error(vm, "condition is not a boolean type");
+    }
+    return ((noam_bool_value*)value)->value;
 }
 
-int noam_return_statement_is_returned(noam_return_statement* statement){
-    return 1;
+noam_value* noam_while_statement_run(noam_while_statement* statement, noam_vm* vm){
+    noam_stack* stack = vm->stack;
+    noam_value* result = NULL;
+    int resumed = stack->resuming;
+
+    /* a resumed coroutine enters the body it was suspended in without checking the condition */
+    if(resumed){
+        noam_coroutine_point(vm);
+    }
+
+    while(!stack->returning && (resumed || noam_while_statement_test(statement, vm))){
+        resumed = 0;
+        result = noam_statements_run(statement->block, vm);
+    }
+
+    if(stack->yielding){
+        noam_coroutine_suspend(vm, 0, NULL, NULL);
+    }
+    return result;
+}
+
+void noam_while_statement_release(noam_while_statement* statement){
+    noam_expression_release(statement->condition);
+}
+
+noam_while_statement* noam_while_statement_create(noam_expression* condition, noam_buffer* block){
+    static noam_statement_vtable_ noam_while_statement_vtable[] = {{&noam_while_statement_run,
+                                                                    &noam_while_statement_release}};
+    NOAM_TRACE(NOAM_TRACE_PARSER, "noam_while_statement_create\n");
+    noam_while_statement* statement = malloc(sizeof(noam_while_statement));
+    NOAM_ALLOC_STAT("noam_while_statement", sizeof(noam_while_statement));
+    statement->vtable_ = noam_while_statement_vtable;
+    statement->condition = condition;
+    statement->block = block;
+    return statement;
 }
 
-int noam_cond_statement_is_returned(noam_cond_statement* statement){
-    return statement->is_returned;
-}
\ No newline at end of file
+/* noam_range_statement_limit: evaluates a bound of the range */
+int noam_range_statement_limit(noam_expression* expression, noam_vm* vm){
+    noam_value* value = noam_expression_get(expression, vm);
+
+    if(!noam_value_is_instance(value, NOAM_INT_TOKEN)){
+        noam_vm_error(vm, "range bounds are not ints");
+    }
+    return ((noam_int_value*)value)->value;
+}
+
+noam_value* noam_range_statement_run(noam_range_statement* statement, noam_vm* vm){
+    noam_stack* stack = vm->stack;
+    noam_value* result = NULL;
+    size_t frame = statement->global ? 0 : stack->base;
+    int resumed = stack->resuming;
+    int counter = 0;
+    int to = 0;
+    /* the value of the loop variable, updated in place while the slot still has it and the variable doesn't escape */
+    noam_int_value* boxed = NULL;
+
+    if(resumed){
+        /* the counter is kept in the resume point, the loop variable in the frame */
+        noam_resume_point point = noam_coroutine_point(vm);
+        counter = (int)(unsigned)point.index;
+        to = ((noam_int_value*)point.iterable)->value;
+    } else {
+        counter = noam_range_statement_limit(statement->from, vm);
+        to = noam_range_statement_limit(statement->to, vm);
+    }
+
+    while(resumed || counter < to){
+        if(!resumed && statement->bound){
+            /* the body may call functions which grow the stack, so the slot is found every iteration */
+            noam_value** slot = stack->slots + frame + statement->slot;
+
+            if(boxed && !statement->escapes && *slot == (noam_value*)boxed){
+                boxed->value = counter;
+            } else {
+                boxed = noam_int_value_create(counter);
+                *slot = (noam_value*)boxed;
+            }
+        }
+
+        resumed = 0;
+        result = noam_statements_run(statement->block, vm);
+
+        if(stack->returning){
+            break;
+        }
+        ++counter;
+    }
+
+    if(stack->yielding){
+        noam_coroutine_suspend(vm, (size_t)(unsigned)counter, (noam_value*)noam_int_value_create(to), NULL);
+    }
+    return result;
+}
+
+void noam_range_statement_release(noam_range_statement* statement){
+    noam_expression_release(statement->from);
+    noam_expression_release(statement->to);
+}
+
+noam_range_statement* noam_range_statement_create(noam_buffer* key, noam_expression* from, noam_expression* to,
+                                                  noam_buffer* block, int bound, int escapes, noam_scope* scope){
+    static noam_statement_vtable_ noam_range_statement_vtable[] = {{&noam_range_statement_run,
+                                                                    &noam_range_statement_release}};
+    NOAM_TRACE(NOAM_TRACE_PARSER, "noam_range_statement_create: %s\n", (char*)key->data);
+    noam_range_statement* statement = malloc(sizeof(noam_range_statement));
+    NOAM_ALLOC_STAT("noam_range_statement", sizeof(noam_range_statement));
+    statement->vtable_ = noam_range_statement_vtable;
+    statement->key = key;
+    statement->slot = noam_scope_declare(scope, key, &statement->global);
+    statement->from = from;
+    statement->to = to;
+    statement->block = block;
+    statement->bound = bound;
+    statement->escapes = escapes;
+    return statement;
+}
+
+noam_value* noam_statements_run(noam_buffer* statements, noam_vm* vm){
+    size_t current = vm->stack->resuming ? noam_coroutine_point(vm).index : 0;
+    NOAM_TRACE(NOAM_TRACE_EXEC, "noam_statements_run\n");
+    while(current < statements->length){
+        noam_statement** statement = noam_buffer_at(statements, current++);
+
+        if(vm->stack->depth < NOAM_STACK_CALLS){
+            vm->stack->calls[vm->stack->depth].line = (*statement)->line;
+        }
+
+        noam_value* result = noam_statement_run(*statement, vm);
+
+        if(vm->stack->returning){
+            if(vm->stack->yielding){
+                noam_coroutine_suspend(vm, current - 1, NULL, NULL);
+            }
+            return result;
+        }
+    }
+
+    return NULL;
+}
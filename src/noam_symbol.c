@@ -2,14 +2,14 @@
 #include "noam_expression.h"
 
 void noam_scope_vars_release(void* data){
-    noam_buffer_release(data);
-    noam_expression_release(*(noam_expression**)((char*)data + sizeof(noam_buffer)));
+    /* keys are stored inline, so only the string data is owned by the dictionary */
+    free(((noam_buffer*)data)->data);
 }
 
 noam_scope* noam_scope_create(noam_buffer* name){
     noam_scope* scope = malloc(sizeof(noam_scope));
     memset(scope, 0, sizeof(noam_scope));
-    scope->vars = noam_dict_createv(sizeof(noam_buffer), sizeof(noam_value*),
+    scope->vars = noam_dict_createv(sizeof(noam_buffer), sizeof(size_t),
                                     &noam_hash_string, &noam_cmp_string,
                                     &noam_scope_vars_release);
     scope->name = name;
@@ -37,20 +37,77 @@ noam_scope* noam_scope_add_sibling(noam_buffer* name, noam_scope* prev){
 void noam_scope_release(noam_scope* head){
     while(head){
         noam_scope* node = head;
-        noam_dict_release(head->vars);
-        free(head);
         head = node->next;
+        noam_dict_release(node->vars);
+        free(node);
     }
 }
 
+noam_scope* noam_scope_frame(noam_scope* scope){
+    while(!scope->name && scope->parent){
+        scope = scope->parent;
+    }
+    return scope;
+}
+
+int noam_scope_find(noam_scope* scope, noam_buffer* name, size_t* slot){
+    noam_scope* frame = noam_scope_frame(scope);
+
+    for(;;){
+        noam_dict_node* node = noam_dict_find(scope->vars, name);
+
+        if(node){
+            *slot = *(size_t*)noam_dict_value(scope->vars, node);
+            return 1;
+        }
+
+        if(scope == frame){
+            return 0;
+        }
+        scope = scope->parent;
+    }
+}
+
+size_t noam_scope_declare(noam_scope* scope, noam_buffer* name, int* global){
+    noam_scope* frame = noam_scope_frame(scope);
+    size_t slot = 0;
+
+    *global = !frame->parent;
+
+    if(!noam_scope_find(scope, name, &slot)){
+        slot = frame->slots++;
+        noam_dict_insert(scope->vars, name, &slot);
+    }
+    return slot;
+}
+
+size_t noam_scope_lookup(noam_scope* scope, noam_buffer* name, int* global){
+    noam_scope* frame = noam_scope_frame(scope);
+    size_t slot = 0;
+
+    if(noam_scope_find(scope, name, &slot)){
+        *global = !frame->parent;
+        return slot;
+    }
+
+    while(frame->parent){
+        frame = frame->parent;
+    }
+    return noam_scope_declare(frame, name, global);
+}
+
 noam_func* noam_func_create(noam_buffer* name, noam_buffer* params, noam_buffer* body){
-#ifdef NOAM_DEBUG
-    printf("noam_func_create: %s\n", (char*)name->data);
-#endif
+    NOAM_TRACE(NOAM_TRACE_PARSER, "noam_func_create: %s\n", (char*)name->data);
     noam_func* func = malloc(sizeof(noam_func));
     func->name = name;
     func->params = params;
     func->body = body;
+    func->slots = 0;
+    func->coroutine = 0;
+    func->tokens = NULL;
+    func->scope = NULL;
+    func->module = NULL;
+    func->hash = 0;
     return func;
 }
 
@@ -62,21 +119,101 @@ void noam_func_release(noam_func* func){
 }
 
 void noam_symbol_table_funcs_release(void* data){
-    noam_buffer_release(data);
-    noam_func_release((noam_func*)((char*)data + sizeof(noam_buffer)));
+    free(((noam_buffer*)data)->data);
+    noam_func_release(*(noam_func**)((char*)data + sizeof(noam_buffer)));
+}
+
+/* the statements themselves stay like function bodies do, their nodes share names with the tokens and each other */
+void noam_symbol_table_main_release(void* data){
+    noam_buffer_release(*(noam_buffer**)data);
+}
+
+void noam_symbol_table_natives_release(void* data){
+    free(((noam_buffer*)data)->data);
+    free(*(void**)((char*)data + sizeof(noam_buffer)));
+}
+
+noam_stack* noam_stack_create(){
+    noam_stack* stack = malloc(sizeof(noam_stack));
+    memset(stack, 0, sizeof(noam_stack));
+    return stack;
+}
+
+void noam_stack_release(noam_stack* stack){
+    free(stack->slots);
+    free(stack);
+}
+
+size_t noam_stack_push(noam_stack* stack, size_t size){
+    size_t frame = stack->length;
+
+    if(frame + size > stack->size){
+        size_t new_size = stack->size ? stack->size : 64;
+
+        while(new_size < frame + size){
+            new_size *= 2;
+        }
+
+        stack->slots = realloc(stack->slots, new_size * sizeof(struct noam_value*));
+        stack->size = new_size;
+    }
+
+    memset(stack->slots + frame, 0, size * sizeof(struct noam_value*));
+    stack->length += size;
+    return frame;
+}
+
+void noam_stack_pop(noam_stack* stack, size_t frame){
+    stack->length = frame;
+}
+
+void noam_stack_enter(noam_stack* stack, noam_func* func){
+    size_t depth = stack->depth + 1;
+
+    if(depth < NOAM_STACK_CALLS){
+        stack->calls[depth].func = func;
+        stack->calls[depth].line = 0;
+    }
+
+    /* the site is complete before it becomes visible */
+    NOAM_BARRIER();
+    stack->depth = depth;
+}
+
+void noam_stack_leave(noam_stack* stack){
+    --stack->depth;
+}
+
+void noam_stack_globals(noam_stack* stack, size_t size){
+    if(size > stack->length){
+        noam_stack_push(stack, size - stack->length);
+    }
 }
 
 noam_symbol_table* noam_symbol_table_create(){
     noam_symbol_table* symbol_table = malloc(sizeof(noam_symbol_table));
     symbol_table->head = noam_scope_create(NULL);
-    symbol_table->funcs = noam_dict_createv(sizeof(noam_buffer), sizeof(noam_func),
+    symbol_table->funcs = noam_dict_createv(sizeof(noam_buffer), sizeof(noam_func*),
                                             &noam_hash_string, &noam_cmp_string,
                                             &noam_symbol_table_funcs_release);
+    symbol_table->natives = noam_dict_createv(sizeof(noam_buffer), sizeof(void*),
+                                              &noam_hash_string, &noam_cmp_string,
+                                              &noam_symbol_table_natives_release);
+    symbol_table->main = noam_buffer_createv(sizeof(noam_buffer*), &noam_symbol_table_main_release);
+    symbol_table->calls = noam_buffer_create(sizeof(void*));
+    symbol_table->last = NULL;
+    symbol_table->modules = noam_dict_createv(sizeof(noam_buffer), sizeof(void*),
+                                              &noam_hash_string, &noam_cmp_string,
+                                              &noam_symbol_table_modules_release);
     return symbol_table;
 }
 
 void noam_symbol_table_release(noam_symbol_table* symbol_table){
     noam_dict_release(symbol_table->funcs);
+    noam_dict_release(symbol_table->natives);
+    noam_dict_release(symbol_table->modules);
+    noam_buffer_release(symbol_table->calls);
+    noam_buffer_release(symbol_table->main);
     //TODO: Traverse tree
     //noam_scope_release(symbol_table->head);
 }
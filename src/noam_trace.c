@@ -0,0 +1,73 @@
+#include "noam_trace.h"
+
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+unsigned noam_trace_mask = 0;
+
+static FILE* noam_trace_stream = NULL;
+
+static const char* noam_trace_names[] = {"lexer", "parser", "alloc", "exec", "calls"};
+
+int noam_trace_enable(const char* categories){
+    const char* name = categories;
+
+    while(*name){
+        size_t length = strcspn(name, ",");
+        unsigned mask = 0;
+
+        if(length == 3 && !strncmp(name, "all", 3)){
+            mask = NOAM_TRACE_ALL;
+        }
+
+        for(unsigned i = 0; !mask && i < sizeof(noam_trace_names) / sizeof(const char*); ++i){
+            if(strlen(noam_trace_names[i]) == length && !strncmp(name, noam_trace_names[i], length)){
+                mask = 1u << i;
+            }
+        }
+
+        if(!mask && length){
+            return 0;
+        }
+
+        noam_trace_mask |= mask;
+        name += name[length] ? length + 1 : length;
+    }
+
+    return 1;
+}
+
+int noam_trace_init(){
+    const char* categories = getenv("NOAM_TRACE");
+    const char* path = getenv("NOAM_TRACE_FILE");
+
+    if(path && *path){
+        FILE* sink = fopen(path, "a");
+
+        if(sink){
+            noam_trace_sink(sink);
+        }
+    }
+
+    return categories ? noam_trace_enable(categories) : 1;
+}
+
+void noam_trace_sink(FILE* sink){
+    noam_trace_stream = sink;
+}
+
+void noam_trace_write(unsigned category, const char* format, ...){
+    FILE* stream = noam_trace_stream ? noam_trace_stream : stderr;
+    unsigned index = 0;
+    va_list args;
+
+    while(index + 1 < sizeof(noam_trace_names) / sizeof(const char*) && !(category & (1u << index))){
+        ++index;
+    }
+
+    fprintf(stream, "[%s] ", noam_trace_names[index]);
+    va_start(args, format);
+    vfprintf(stream, format, args);
+    va_end(args);
+}
@@ -0,0 +1,376 @@
+#include "noam_vm.h"
+#include "noam_parser.h"
+#include "noam_coroutine.h"
+#include "noam_pool.h"
+#include "noam_module.h"
+
+void noam_vm_stdout(const char* str, size_t length, void* data){
+    fwrite(str, 1, length, stdout);
+}
+
+noam_vm* noam_vm_create(){
+    NOAM_TRACE(NOAM_TRACE_EXEC, "noam_vm_create\n");
+    noam_vm* vm = malloc(sizeof(noam_vm));
+    memset(vm, 0, sizeof(noam_vm));
+    vm->symbol_table = noam_symbol_table_create();
+    vm->stack = noam_stack_create();
+    vm->output = &noam_vm_stdout;
+    vm->status = NOAM_OK;
+    return vm;
+}
+
+noam_vm* noam_vm_share(noam_vm* vm){
+    NOAM_TRACE(NOAM_TRACE_EXEC, "noam_vm_share\n");
+    noam_vm_compile(vm);
+
+    noam_vm* shared = malloc(sizeof(noam_vm));
+    memset(shared, 0, sizeof(noam_vm));
+    shared->symbol_table = vm->symbol_table;
+    shared->stack = noam_stack_create();
+    shared->shared = 1;
+    shared->output = vm->output;
+    shared->output_data = vm->output_data;
+    shared->status = NOAM_OK;
+    noam_stack_globals(shared->stack, vm->symbol_table->head->slots);
+    return shared;
+}
+
+void noam_vm_destroy(noam_vm* vm){
+    if(vm->pool){
+        noam_pool_destroy(vm->pool);
+    }
+    if(!vm->shared){
+        noam_symbol_table_release(vm->symbol_table);
+    }
+    noam_stack_release(vm->stack);
+    free(vm);
+}
+
+void noam_vm_set_output(noam_vm* vm, noam_output_func output, void* data){
+    vm->output = output;
+    vm->output_data = data;
+}
+
+void noam_vm_set_lazy(noam_vm* vm, int lazy){
+    vm->lazy = lazy;
+}
+
+noam_status noam_vm_compile(noam_vm* vm){
+    jmp_buf* prev = vm->recover;
+    jmp_buf recover;
+
+    vm->status = NOAM_OK;
+    vm->recover = &recover;
+
+    if(!setjmp(recover)){
+        noam_parse_pending(vm);
+    }
+
+    vm->recover = prev;
+    return vm->status;
+}
+
+void noam_vm_raise(noam_vm* vm, noam_status status, const char* format, va_list args){
+    vsnprintf(vm->error, NOAM_VM_ERROR_LENGTH, format, args);
+    vm->status = status;
+
+    if(!vm->recover){
+        fprintf(stderr, "noam: %s\n", vm->error);
+        exit(-1);
+    }
+
+    longjmp(*vm->recover, 1);
+}
+
+void noam_vm_error(noam_vm* vm, const char* format, ...){
+    va_list args;
+    va_start(args, format);
+    noam_vm_raise(vm, NOAM_RUNTIME_ERROR, format, args);
+    va_end(args);
+}
+
+void noam_vm_syntax_error(noam_vm* vm, const char* format, ...){
+    va_list args;
+    va_start(args, format);
+    noam_vm_raise(vm, NOAM_SYNTAX_ERROR, format, args);
+    va_end(args);
+}
+
+const char* noam_vm_error_message(noam_vm* vm){
+    return vm->status == NOAM_OK ? "" : vm->error;
+}
+
+void noam_vm_write(noam_vm* vm, const char* str, size_t length){
+    vm->output(str, length, vm->output_data);
+}
+
+/* noam_vm_unwind: drops the frames above `length` after an error, `base` is the frame and `depth` the call
+ * to go on with, interrupted coroutines are finished since their resume points are lost */
+void noam_vm_unwind(noam_vm* vm, size_t base, size_t length, size_t depth){
+    while(vm->stack->coroutine && vm->stack->coroutine->frame >= length){
+        vm->stack->coroutine->running = 0;
+        vm->stack->coroutine->done = 1;
+        vm->stack->coroutine->value = (noam_value*)noam_nil_value_create();
+        vm->stack->coroutine = vm->stack->coroutine->caller;
+    }
+
+    vm->stack->base = base;
+    vm->stack->tail = NULL;
+    vm->stack->returning = 0;
+    vm->stack->resuming = 0;
+    vm->stack->yielding = 0;
+    vm->stack->depth = depth;
+    noam_stack_pop(vm->stack, length < vm->stack->length ? length : vm->stack->length);
+}
+
+noam_status noam_vm_load(noam_vm* vm, const char* source){
+    return noam_vm_load_path(vm, source, NULL);
+}
+
+noam_status noam_vm_load_path(noam_vm* vm, const char* source, const char* path){
+    jmp_buf recover;
+
+    if(vm->recover || vm->shared){
+        snprintf(vm->error, NOAM_VM_ERROR_LENGTH, vm->shared ? "a shared vm cannot load scripts" :
+                                                  "cannot load a script while another one is running");
+        return vm->status = NOAM_RUNTIME_ERROR;
+    }
+
+    vm->status = NOAM_OK;
+    vm->recover = &recover;
+
+    if(!setjmp(recover)){
+        noam_buffer* main = vm->symbol_table->main;
+        size_t first = main->length;
+        noam_parser parser;
+        noam_parser_init(&parser, vm, source);
+        noam_module_import(vm, parser.tokens, path);
+
+        noam_buffer* statements = noam_parse_statements(&parser, vm->symbol_table);
+        noam_tokens_release(parser.tokens);
+        noam_buffer_push(main, &statements);
+        noam_stack_globals(vm->stack, vm->symbol_table->head->slots);
+
+        /* the top-level statements of the newly imported modules run before the ones of the script */
+        for(size_t i = first; i < main->length; ++i){
+            noam_statements_run(*(noam_buffer**)noam_buffer_at(main, i), vm);
+            vm->stack->returning = 0;
+        }
+    } else {
+        /* frames of the interrupted calls are dropped, the global frame is kept */
+        noam_vm_unwind(vm, 0, vm->symbol_table->head->slots, 0);
+    }
+
+    vm->recover = NULL;
+    return vm->status;
+}
+
+noam_status noam_vm_load_file(noam_vm* vm, const char* filename){
+    FILE* file = fopen(filename, "r");
+
+    if(!file){
+        snprintf(vm->error, NOAM_VM_ERROR_LENGTH, "cannot open the file %s", filename);
+        return vm->status = NOAM_IO_ERROR;
+    }
+
+    const size_t chunk_size = 1024;
+    char file_buffer[chunk_size];
+    noam_buffer* file_source = noam_buffer_create(1);
+    size_t bytes_read = 0;
+
+    while((bytes_read = fread(file_buffer, 1, chunk_size, file)) > 0){
+        noam_buffer_append(file_source, file_buffer, bytes_read);
+    }
+
+    fclose(file);
+
+    char eof = ' ';
+    noam_buffer_push(file_source, &eof);
+    noam_buffer_terminate(file_source);
+
+    noam_status status = noam_vm_load_path(vm, file_source->data, filename);
+    noam_buffer_release(file_source);
+    return status;
+}
+
+noam_status noam_vm_reload(noam_vm* vm, const char* filename, size_t* changed){
+    jmp_buf recover;
+
+    if(changed){
+        *changed = 0;
+    }
+
+    if(vm->recover || vm->shared){
+        snprintf(vm->error, NOAM_VM_ERROR_LENGTH, vm->shared ? "a shared vm cannot reload scripts" :
+                                                  "cannot reload a script while another one is running");
+        return vm->status = NOAM_RUNTIME_ERROR;
+    }
+
+    char* path = realpath(filename, NULL);
+    char* source = path ? noam_module_read(path) : NULL;
+
+    if(!source){
+        free(path);
+        snprintf(vm->error, NOAM_VM_ERROR_LENGTH, "cannot open the file %s", filename);
+        return vm->status = NOAM_IO_ERROR;
+    }
+
+    vm->status = NOAM_OK;
+    vm->recover = &recover;
+
+    if(!setjmp(recover)){
+        noam_symbol_table* symbol_table = vm->symbol_table;
+        size_t first = symbol_table->main->length;
+        noam_parser parser;
+        noam_parser_init(&parser, vm, source);
+        parser.module = noam_module_at(symbol_table, path);
+        parser.reload = noam_buffer_create(sizeof(noam_func*));
+
+        /* functions added to a module are called from it by their names */
+        if(parser.module){
+            noam_module_scan(parser.tokens, path, NULL, parser.module->funcs, vm->error);
+        }
+
+        noam_module_import(vm, parser.tokens, path);
+        noam_buffer_release(noam_parse_statements(&parser, symbol_table));
+        noam_tokens_release(parser.tokens);
+
+        /* the changed functions are swapped in once the whole file is parsed, so a syntax error changes nothing */
+        for(size_t i = 0; i < parser.reload->length; ++i){
+            noam_parse_define(symbol_table, *(noam_func**)noam_buffer_at(parser.reload, i));
+        }
+
+        NOAM_TRACE(NOAM_TRACE_PARSER, "noam_vm_reload: %s, %lu functions changed\n", path,
+                   (unsigned long)parser.reload->length);
+
+        if(changed){
+            *changed = parser.reload->length;
+        }
+
+        noam_buffer_release(parser.reload);
+        noam_func_call_expression_link(symbol_table);
+        noam_stack_globals(vm->stack, symbol_table->head->slots);
+
+        /* only the modules imported for the first time run their top-level statements */
+        for(size_t i = first; i < symbol_table->main->length; ++i){
+            noam_statements_run(*(noam_buffer**)noam_buffer_at(symbol_table->main, i), vm);
+            vm->stack->returning = 0;
+        }
+    } else {
+        noam_vm_unwind(vm, 0, vm->symbol_table->head->slots, 0);
+    }
+
+    vm->recover = NULL;
+    free(source);
+    free(path);
+    return vm->status;
+}
+
+noam_status noam_vm_run(noam_vm* vm){
+    jmp_buf recover;
+
+    if(vm->recover){
+        snprintf(vm->error, NOAM_VM_ERROR_LENGTH, "cannot run a script while another one is running");
+        return vm->status = NOAM_RUNTIME_ERROR;
+    }
+
+    vm->status = NOAM_OK;
+    vm->recover = &recover;
+
+    if(!setjmp(recover)){
+        noam_stack_globals(vm->stack, vm->symbol_table->head->slots);
+
+        for(size_t i = 0; i < vm->symbol_table->main->length; ++i){
+            noam_statements_run(*(noam_buffer**)noam_buffer_at(vm->symbol_table->main, i), vm);
+            vm->stack->returning = 0;
+        }
+    } else {
+        noam_vm_unwind(vm, 0, vm->symbol_table->head->slots, 0);
+    }
+
+    vm->recover = NULL;
+    return vm->status;
+}
+
+noam_status noam_vm_call(noam_vm* vm, const char* name, struct noam_value** args, size_t argc,
+                         struct noam_value** result){
+    noam_buffer key;
+    memset(&key, 0, sizeof(noam_buffer));
+    key.data = (void*)name;
+    key.length = strlen(name);
+    key.chunk = 1;
+
+    noam_dict_node* node = noam_dict_find(vm->symbol_table->funcs, &key);
+
+    if(!node){
+        *result = NULL;
+        snprintf(vm->error, NOAM_VM_ERROR_LENGTH, "unknown function %s", name);
+        return vm->status = NOAM_RUNTIME_ERROR;
+    }
+
+    return noam_vm_call_func(vm, *(noam_func**)noam_dict_value(vm->symbol_table->funcs, node), args, argc, result);
+}
+
+noam_status noam_vm_call_func(noam_vm* vm, noam_func* func, struct noam_value** args, size_t argc,
+                              struct noam_value** result){
+    noam_stack* stack = vm->stack;
+    jmp_buf* prev = vm->recover;
+    jmp_buf recover;
+
+    /* globals declared by scripts loaded after the vm was shared */
+    if(!prev){
+        noam_stack_globals(stack, vm->symbol_table->head->slots);
+    }
+
+    size_t base = stack->base;
+    size_t length = stack->length;
+    size_t depth = stack->depth;
+
+    *result = NULL;
+    vm->status = NOAM_OK;
+    vm->recover = &recover;
+
+    if(!setjmp(recover)){
+        if(argc != func->params->length){
+            noam_vm_error(vm, "function params mismatch: args=%lu params=%lu", argc, func->params->length);
+        }
+
+        if(func->tokens){
+            noam_func_compile(func, vm);
+        }
+
+        size_t frame = noam_stack_push(stack, func->slots);
+        memcpy(stack->slots + frame, args, argc * sizeof(noam_value*));
+        *result = noam_func_call(func, frame, vm);
+    } else {
+        noam_vm_unwind(vm, base, length, depth);
+    }
+
+    vm->recover = prev;
+    return vm->status;
+}
+
+noam_status noam_vm_resume(noam_vm* vm, struct noam_value* coroutine, struct noam_value** result){
+    noam_stack* stack = vm->stack;
+    jmp_buf* prev = vm->recover;
+    size_t base = stack->base;
+    size_t length = stack->length;
+    size_t depth = stack->depth;
+    jmp_buf recover;
+
+    *result = NULL;
+    vm->status = NOAM_OK;
+    vm->recover = &recover;
+
+    if(!setjmp(recover)){
+        if(!noam_value_is_instance(coroutine, NOAM_COROUTINE_TOKEN)){
+            noam_vm_error(vm, "value is not a coroutine");
+        }
+        *result = noam_coroutine_resume((noam_coroutine_value*)coroutine, vm);
+    } else {
+        noam_vm_unwind(vm, base, length, depth);
+    }
+
+    vm->recover = prev;
+    return vm->status;
+}
@@ -0,0 +1,152 @@
+#include "noam_watch.h"
+#include "noam_module.h"
+
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#define NOAM_WATCH_EVENTS 4096
+
+void noam_watch_file_release(void* data){
+    free(((noam_watch_file*)data)->path);
+}
+
+noam_watch* noam_watch_create(noam_vm* vm, noam_watch_func func, void* data){
+    NOAM_TRACE(NOAM_TRACE_EXEC, "noam_watch_create\n");
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+    if(fd < 0){
+        return NULL;
+    }
+
+    noam_watch* watch = malloc(sizeof(noam_watch));
+    NOAM_ALLOC_STAT("watch", sizeof(noam_watch));
+    watch->vm = vm;
+    watch->fd = fd;
+    watch->files = noam_buffer_createv(sizeof(noam_watch_file), &noam_watch_file_release);
+    watch->func = func;
+    watch->data = data;
+    return watch;
+}
+
+void noam_watch_destroy(noam_watch* watch){
+    close(watch->fd);
+    noam_buffer_release(watch->files);
+    free(watch);
+}
+
+/* noam_watch_path: watches a resolved path, returns 0 if its directory cannot be watched */
+int noam_watch_path(noam_watch* watch, const char* path){
+    for(size_t i = 0; i < watch->files->length; ++i){
+        if(!strcmp(((noam_watch_file*)noam_buffer_at(watch->files, i))->path, path)){
+            return 1;
+        }
+    }
+
+    const char* slash = strrchr(path, '/');
+    size_t length = slash > path ? (size_t)(slash - path) : 1;
+    char* dir = malloc(length + 1);
+    memcpy(dir, path, length);
+    dir[length] = '\0';
+
+    /* a directory added again gets the descriptor it already has */
+    int wd = inotify_add_watch(watch->fd, dir, IN_CLOSE_WRITE | IN_MOVED_TO);
+    free(dir);
+
+    if(wd < 0){
+        return 0;
+    }
+
+    noam_watch_file file;
+    file.wd = wd;
+    file.path = malloc(strlen(path) + 1);
+    strcpy(file.path, path);
+    noam_buffer_push(watch->files, &file);
+    return 1;
+}
+
+/* noam_watch_modules: watches the modules imported since the last call */
+void noam_watch_modules(noam_watch* watch){
+    noam_dict* modules = watch->vm->symbol_table->modules;
+
+    for(size_t i = 0; i < modules->size; ++i){
+        noam_dict_node* node = noam_dict_node_at(modules, i);
+
+        if(node->probe && (*(noam_module**)noam_dict_value(modules, node))->state == NOAM_MODULE_PARSED){
+            noam_watch_path(watch, (*(noam_module**)noam_dict_value(modules, node))->path);
+        }
+    }
+}
+
+int noam_watch_add(noam_watch* watch, const char* path){
+    char* resolved = realpath(path, NULL);
+    int watched = resolved && noam_watch_path(watch, resolved);
+
+    free(resolved);
+    noam_watch_modules(watch);
+    return watched;
+}
+
+/* noam_watch_match: the watched file an event is about, NULL if it is about another file */
+const char* noam_watch_match(noam_watch* watch, const struct inotify_event* event){
+    for(size_t i = 0; event->len && i < watch->files->length; ++i){
+        noam_watch_file* file = noam_buffer_at(watch->files, i);
+
+        if(file->wd == event->wd && !strcmp(strrchr(file->path, '/') + 1, event->name)){
+            return file->path;
+        }
+    }
+    return NULL;
+}
+
+size_t noam_watch_poll(noam_watch* watch, int timeout){
+    struct pollfd pollfd;
+    char events[NOAM_WATCH_EVENTS] __attribute__((aligned(__alignof__(struct inotify_event))));
+    size_t reloads = 0;
+
+    pollfd.fd = watch->fd;
+    pollfd.events = POLLIN;
+    pollfd.revents = 0;
+
+    if(poll(&pollfd, 1, timeout) <= 0){
+        return 0;
+    }
+
+    /* an editor may write a file a few times in a row, it's reloaded once */
+    noam_buffer* changed = noam_buffer_create(sizeof(const char*));
+    ssize_t length = 0;
+
+    while((length = read(watch->fd, events, sizeof(events))) > 0){
+        for(char* event = events; event < events + length;
+            event += sizeof(struct inotify_event) + ((struct inotify_event*)event)->len){
+            const char* path = noam_watch_match(watch, (struct inotify_event*)event);
+            size_t i = 0;
+
+            while(i < changed->length && *(const char**)noam_buffer_at(changed, i) != path){
+                ++i;
+            }
+
+            if(path && i == changed->length){
+                noam_buffer_push(changed, &path);
+            }
+        }
+    }
+
+    for(size_t i = 0; i < changed->length; ++i){
+        const char* path = *(const char**)noam_buffer_at(changed, i);
+        size_t functions = 0;
+        noam_status status = noam_vm_reload(watch->vm, path, &functions);
+
+        NOAM_TRACE(NOAM_TRACE_EXEC, "noam_watch_poll: %s reloaded\n", path);
+
+        if(watch->func){
+            watch->func(watch->vm, path, status, functions, watch->data);
+        }
+
+        ++reloads;
+    }
+
+    noam_buffer_release(changed);
+    noam_watch_modules(watch);
+    return reloads;
+}